@@ -33,12 +33,67 @@ SOURCES += \
     framerange.cpp \
     canconfigloader.cpp \
     canobject.cpp \
+    framecomposer.cpp \
+    framesnapshottable.cpp \
+    framedispatcher.cpp \
+    sharedsignalwriter.cpp \
+    signalregistry.cpp \
+    signaldecoder.cpp \
+    signalaggregator.cpp \
+    signalruleengine.cpp \
+    busloadestimator.cpp \
+    latencyhistogram.cpp \
+    latencyprobe.cpp \
+    timestampingcansocket.cpp \
+    columnarexporter.cpp \
+    columnarreader.cpp \
+    asyncsignalbus.cpp \
+    e2eprotection.cpp \
+    decodepool.cpp \
+    cangateway.cpp \
+    isotptransport.cpp \
+    frameindex.cpp \
+    framebatch.cpp \
+    framesupervisor.cpp \
+    flightrecorder.cpp \
+    txvaluemodel.cpp \
+    canbusengine.cpp \
 
 HEADERS += \
         canbase_global.hpp \ 
     framerange.hpp \
     canconfigloader.hpp \
     canobject.hpp \
+    framecomposer.hpp \
+    framesnapshottable.hpp \
+    framedispatcher.hpp \
+    sharedsignallayout.hpp \
+    sharedsignalreader.hpp \
+    sharedsignalwriter.hpp \
+    signalregistry.hpp \
+    signaldecoder.hpp \
+    signalaggregator.hpp \
+    signalruleengine.hpp \
+    busloadestimator.hpp \
+    latencyhistogram.hpp \
+    latencyprobe.hpp \
+    timestampingcansocket.hpp \
+    columnarformat.hpp \
+    columnarexporter.hpp \
+    columnarreader.hpp \
+    asyncsignalbus.hpp \
+    e2eprotection.hpp \
+    decodepool.hpp \
+    cangateway.hpp \
+    isotptransport.hpp \
+    frameindex.hpp \
+    framebatch.hpp \
+    framesupervisor.hpp \
+    flightrecorder.hpp \
+    txvaluemodel.hpp \
+    canbusengine.hpp \
+
+unix: LIBS += -lrt
 
 unix {
     target.path = /home/pi/CanBase
@@ -0,0 +1,167 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "asyncsignalbus.hpp"
+
+#include <chrono>
+
+CANObjects::AsyncSignalBus::AsyncSignalBus(int signalCount) :
+    m_waiters(signalCount)
+{
+
+}
+
+quint64 CANObjects::AsyncSignalBus::wait(int signal, Predicate predicate, qint64 deadlineMs, Callback done)
+{
+    if (signal < 0 || signal >= m_waiters.size())
+    {
+        return 0;
+    }
+
+    Waiter waiter;
+    waiter.id = m_nextID++;
+    waiter.deadlineMs = deadlineMs;
+    waiter.predicate = std::move(predicate);
+    waiter.done = std::move(done);
+
+    if (deadlineMs >= 0)
+    {
+        m_deadlines.push({deadlineMs, waiter.id});
+    }
+
+    m_signalOf.insert(waiter.id, signal);
+    m_waiters[signal].push_back(std::move(waiter));
+
+    return m_waiters[signal].last().id;
+}
+
+bool CANObjects::AsyncSignalBus::cancel(quint64 id)
+{
+    Waiter waiter;
+
+    //stale heap entry is dropped by expire()
+    return take(id, waiter);
+}
+
+void CANObjects::AsyncSignalBus::onSignal(const DecodedSignal &signal)
+{
+    if (signal.signal < 0 || signal.signal >= m_waiters.size() || m_waiters[signal.signal].isEmpty())
+    {
+        return;
+    }
+
+    QVector<Waiter> &waiters = m_waiters[signal.signal];
+
+    //callbacks may add waiters, fire only after the list is settled
+    m_fired.clear();
+
+    for (int i = 0; i < waiters.size();)
+    {
+        if (!waiters[i].predicate || waiters[i].predicate(signal))
+        {
+            m_signalOf.remove(waiters[i].id);
+            m_fired.push_back(std::move(waiters[i]));
+            waiters.remove(i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    QVector<Waiter> fired;
+    fired.swap(m_fired);
+
+    for (const Waiter &waiter : fired)
+    {
+        waiter.done(true, signal);
+    }
+
+    fired.clear();
+    m_fired.swap(fired);
+}
+
+void CANObjects::AsyncSignalBus::expire(qint64 timeMs)
+{
+    while (!m_deadlines.empty() && m_deadlines.top().first <= timeMs)
+    {
+        const quint64 id = m_deadlines.top().second;
+        m_deadlines.pop();
+
+        const int signal = m_signalOf.value(id, -1);
+        Waiter waiter;
+
+        if (take(id, waiter))
+        {
+            DecodedSignal timedOut;
+            timedOut.signal = signal;
+            waiter.done(false, timedOut);
+        }
+    }
+}
+
+qint64 CANObjects::AsyncSignalBus::nextDeadline()
+{
+    //drop entries of waiters already woken or cancelled
+    while (!m_deadlines.empty() && !m_signalOf.contains(m_deadlines.top().second))
+    {
+        m_deadlines.pop();
+    }
+
+    return m_deadlines.empty() ? -1 : m_deadlines.top().first;
+}
+
+int CANObjects::AsyncSignalBus::pending() const
+{
+    return m_signalOf.size();
+}
+
+qint64 CANObjects::AsyncSignalBus::nowMs()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+bool CANObjects::AsyncSignalBus::take(quint64 id, Waiter &waiter)
+{
+    const auto it = m_signalOf.find(id);
+
+    if (it == m_signalOf.end())
+    {
+        return false;
+    }
+
+    QVector<Waiter> &waiters = m_waiters[it.value()];
+    m_signalOf.erase(it);
+
+    for (int i = 0; i < waiters.size(); ++i)
+    {
+        if (waiters[i].id == id)
+        {
+            waiter = std::move(waiters[i]);
+            waiters.remove(i);
+            return true;
+        }
+    }
+
+    return false;
+}
@@ -0,0 +1,173 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include "canbase_global.hpp"
+
+#include "signaldecoder.hpp"
+
+#include <QHash>
+#include <QVector>
+
+#include <functional>
+#include <queue>
+#include <vector>
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define CANBASE_HAS_COROUTINES
+#include <coroutine>
+#include <exception>
+#include <optional>
+#endif
+
+namespace CANObjects {
+
+/*
+ * Waiting for decoded signal values without polling.
+ *
+ * Sits behind a SignalDecoder, which only passes signals of arrived frames,
+ * so a waiter costs nothing until a frame carrying its signal is received.
+ * Waiters are kept per signal, timeouts in a deadline heap which the owner
+ * drives by calling expire() from a timer armed to nextDeadline().
+ *
+ * With C++20 coroutines next() and until() can be awaited directly:
+ *
+ *   const auto blinker = co_await bus.until(index, [](const DecodedSignal &s){ return s.value != 0.0; }, 500);
+ *
+ * Coroutines are resumed on the decoding thread, from decode() or expire().
+ * Waiters still pending when the bus is destroyed are never resumed.
+ */
+class CANBASESHARED_EXPORT AsyncSignalBus : public SignalSink
+{
+public:
+    using Predicate = std::function<bool(const DecodedSignal&)>;
+    //matched is false on timeout, signal then holds only the index
+    using Callback = std::function<void(bool matched, const DecodedSignal &signal)>;
+
+    explicit AsyncSignalBus(int signalCount);
+
+    //deadlineMs on the nowMs() clock, negative waits forever
+    quint64 wait(int signal, Predicate predicate, qint64 deadlineMs, Callback done);
+    bool cancel(quint64 id);
+
+    void onSignal(const DecodedSignal &signal) override;
+
+    //times out waiters with deadline up to timeMs
+    void expire(qint64 timeMs = nowMs());
+    //earliest pending deadline, -1 without one
+    qint64 nextDeadline();
+
+    int pending() const;
+
+    static qint64 nowMs();
+
+#ifdef CANBASE_HAS_COROUTINES
+    class Awaiter
+    {
+    public:
+        Awaiter(AsyncSignalBus &bus, int signal, Predicate predicate, qint64 timeoutMs) :
+            m_bus(bus)
+          , m_signal(signal)
+          , m_predicate(std::move(predicate))
+          , m_deadlineMs(timeoutMs < 0 ? -1 : nowMs() + timeoutMs)
+        {
+
+        }
+
+        bool await_ready() const noexcept
+        {
+            return false;
+        }
+
+        void await_suspend(std::coroutine_handle<> handle)
+        {
+            m_bus.wait(m_signal, std::move(m_predicate), m_deadlineMs, [this, handle](bool matched, const DecodedSignal &signal) {
+                if (matched)
+                {
+                    m_result = signal;
+                }
+
+                handle.resume();
+            });
+        }
+
+        //empty on timeout
+        std::optional<DecodedSignal> await_resume()
+        {
+            return m_result;
+        }
+
+    private:
+        AsyncSignalBus &m_bus;
+        int m_signal = -1;
+        Predicate m_predicate;
+        qint64 m_deadlineMs = -1;
+        std::optional<DecodedSignal> m_result;
+    };
+
+    //eagerly started coroutine without result, for test scripts
+    struct Task
+    {
+        struct promise_type
+        {
+            Task get_return_object() { return {}; }
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            std::suspend_never final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+        };
+    };
+
+    Awaiter next(int signal, qint64 timeoutMs = -1)
+    {
+        return Awaiter(*this, signal, Predicate(), timeoutMs);
+    }
+
+    Awaiter until(int signal, Predicate predicate, qint64 timeoutMs = -1)
+    {
+        return Awaiter(*this, signal, std::move(predicate), timeoutMs);
+    }
+#endif
+
+private:
+    struct Waiter
+    {
+        quint64 id = 0;
+        qint64 deadlineMs = -1;
+        Predicate predicate;
+        Callback done;
+    };
+
+    using Deadline = std::pair<qint64, quint64>;
+
+    QVector<QVector<Waiter>> m_waiters;     //per signal
+    QHash<quint64, int> m_signalOf;         //pending waiter id to signal
+    std::priority_queue<Deadline, std::vector<Deadline>, std::greater<Deadline>> m_deadlines;
+    quint64 m_nextID = 1;
+
+    QVector<Waiter> m_fired;
+
+    bool take(quint64 id, Waiter &waiter);
+};
+
+}
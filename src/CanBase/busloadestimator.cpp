@@ -0,0 +1,293 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "busloadestimator.hpp"
+
+#include "framesnapshottable.hpp"
+
+#include <algorithm>
+
+namespace {
+
+//bits after the CRC sequence: CRC delimiter, ACK slot and delimiter, EOF, interframe space
+constexpr int TrailerBits = 1 + 2 + 7 + 3;
+
+//FD payloads longer than 8 bytes are padded to the next DLC size
+int fdPayloadBytes(int bytes)
+{
+    static constexpr int Sizes[] = {12, 16, 20, 24, 32, 48, 64};
+
+    if (bytes <= 8)
+    {
+        return std::max(0, bytes);
+    }
+
+    for (const int size : Sizes)
+    {
+        if (bytes <= size)
+        {
+            return size;
+        }
+    }
+
+    return 64;
+}
+
+class StuffCounter
+{
+public:
+    inline void push(int bit)
+    {
+        if (bit == m_last)
+        {
+            if (++m_run == 5)
+            {
+                //stuff bit of opposite level starts the next run
+                ++m_stuffed;
+                m_last = !bit;
+                m_run = 1;
+            }
+        }
+        else
+        {
+            m_last = bit;
+            m_run = 1;
+        }
+    }
+
+    int stuffed() const { return m_stuffed; }
+
+private:
+    int m_last = -1;
+    int m_run = 0;
+    int m_stuffed = 0;
+};
+
+class Crc15
+{
+public:
+    inline void push(int bit)
+    {
+        const int next = bit ^ ((m_crc >> 14) & 1);
+        m_crc = static_cast<quint16>((m_crc << 1) & 0x7FFF);
+
+        if (next)
+        {
+            m_crc ^= 0x4599;
+        }
+    }
+
+    quint16 value() const { return m_crc; }
+
+private:
+    quint16 m_crc = 0;
+};
+
+}
+
+CANObjects::BusLoadEstimator::BusLoadEstimator(int bitrate, int dataBitrate, qint64 windowUs, int buckets) :
+    m_bitrate(bitrate)
+  , m_dataBitrate(dataBitrate)
+  , m_bucketUs(std::max<qint64>(1, windowUs / std::max(1, buckets)))
+  , m_buckets(std::max(1, buckets))
+{
+
+}
+
+double CANObjects::BusLoadEstimator::frameBits(const QCanBusFrame &frame, Stuffing stuffing) const
+{
+    if (frame.hasFlexibleDataRateFormat())
+    {
+        const double ratio = frame.hasBitrateSwitch() ? static_cast<double>(m_bitrate) / m_dataBitrate : 1.0;
+
+        return fdFrameBits(frame.hasExtendedFrameFormat(), frame.payload().size(), ratio,
+                           stuffing == Stuffing::Actual ? Stuffing::WorstCase : stuffing);
+    }
+
+    return classicFrameBits(frame.frameId(), frame.hasExtendedFrameFormat(), frame.payload(),
+                            frame.frameType() == QCanBusFrame::RemoteRequestFrame, stuffing);
+}
+
+int CANObjects::BusLoadEstimator::classicFrameBits(quint32 frameID, bool extended, const QByteArray &payload, bool remote, Stuffing stuffing)
+{
+    const int dataBytes = std::min(payload.size(), 8);
+    const int dataBits = remote ? 0 : dataBytes * 8;
+
+    //SOF up to the end of CRC, the part subject to bit stuffing
+    const int stuffedRegion = (extended ? 54 : 34) + dataBits;
+
+    switch (stuffing) {
+    case Stuffing::None:
+        return stuffedRegion + TrailerBits;
+    case Stuffing::WorstCase:
+        return stuffedRegion + (stuffedRegion - 1) / 4 + TrailerBits;
+    case Stuffing::Actual:
+        break;
+    }
+
+    StuffCounter stuff;
+    Crc15 crc;
+
+    auto push = [&stuff, &crc](int bit)
+    {
+        stuff.push(bit);
+        crc.push(bit);
+    };
+
+    auto pushBits = [&push](quint32 value, int count)
+    {
+        for (int i = count - 1; i >= 0; --i)
+        {
+            push((value >> i) & 1u);
+        }
+    };
+
+    push(0); //SOF
+
+    if (extended)
+    {
+        pushBits(frameID >> 18, 11);
+        push(1); //SRR
+        push(1); //IDE
+        pushBits(frameID & 0x3FFFF, 18);
+        push(remote ? 1 : 0);
+        push(0); //r1
+        push(0); //r0
+    }
+    else
+    {
+        pushBits(frameID & 0x7FF, 11);
+        push(remote ? 1 : 0);
+        push(0); //IDE
+        push(0); //r0
+    }
+
+    pushBits(static_cast<quint32>(dataBytes), 4);
+
+    for (int i = 0; i < dataBits / 8; ++i)
+    {
+        pushBits(static_cast<quint8>(payload.at(i)), 8);
+    }
+
+    const quint16 sequence = crc.value();
+
+    for (int i = 14; i >= 0; --i)
+    {
+        stuff.push((sequence >> i) & 1);
+    }
+
+    return stuffedRegion + stuff.stuffed() + TrailerBits;
+}
+
+double CANObjects::BusLoadEstimator::fdFrameBits(bool extended, int payloadBytes, double dataPhaseRatio, Stuffing stuffing)
+{
+    payloadBytes = fdPayloadBytes(payloadBytes);
+
+    //nominal rate: SOF, identifier, control bits up to BRS
+    const int arbitration = extended ? 36 : 17;
+
+    //data rate: ESI, DLC, data, stuff count, CRC with its fixed stuff bits
+    const int crcBits = payloadBytes > 16 ? 21 : 17;
+    const int fixedStuff = 1 + (4 + crcBits) / 4;
+    const int dataBits = 1 + 4 + payloadBytes * 8;
+
+    double arbitrationBits = arbitration;
+    double dataPhaseBits = dataBits + 4 + crcBits + fixedStuff;
+
+    if (stuffing != Stuffing::None)
+    {
+        arbitrationBits += (arbitration - 1) / 4;
+        dataPhaseBits += dataBits / 4;
+    }
+
+    return arbitrationBits + dataPhaseBits * dataPhaseRatio + TrailerBits;
+}
+
+void CANObjects::BusLoadEstimator::addFrame(const QCanBusFrame &frame)
+{
+    addFrame(frame, FrameSnapshotTable::timestampUs(frame));
+}
+
+void CANObjects::BusLoadEstimator::addFrame(const QCanBusFrame &frame, qint64 timestampUs)
+{
+    const qint64 index = timestampUs / m_bucketUs;
+    Bucket &bucket = m_buckets[static_cast<int>(index % m_buckets.size())];
+
+    if (bucket.index != index)
+    {
+        bucket.index = index;
+        bucket.bits = 0.0;
+    }
+
+    bucket.bits += frameBits(frame, Stuffing::Actual);
+    m_lastUs = std::max(m_lastUs, timestampUs);
+}
+
+void CANObjects::BusLoadEstimator::reset()
+{
+    std::fill(m_buckets.begin(), m_buckets.end(), Bucket());
+    m_lastUs = 0;
+}
+
+double CANObjects::BusLoadEstimator::load() const
+{
+    return load(m_lastUs);
+}
+
+double CANObjects::BusLoadEstimator::load(qint64 nowUs) const
+{
+    const qint64 nowIndex = nowUs / m_bucketUs;
+    const qint64 oldestIndex = nowIndex - m_buckets.size() + 1;
+
+    double bits = 0.0;
+
+    for (const Bucket &bucket : m_buckets)
+    {
+        if (bucket.index >= oldestIndex && bucket.index <= nowIndex)
+        {
+            bits += bucket.bits;
+        }
+    }
+
+    //current bucket is filled only up to nowUs
+    const qint64 spanUs = (m_buckets.size() - 1) * m_bucketUs + (nowUs - nowIndex * m_bucketUs) + 1;
+
+    return bits / (static_cast<double>(m_bitrate) * spanUs / 1000000.0);
+}
+
+double CANObjects::BusLoadEstimator::predictedLoad(const QVector<QCanBusFrame> &frames, const QVector<double> &framesPerSecond,
+                                                   Stuffing stuffing) const
+{
+    double bitsPerSecond = 0.0;
+
+    for (int i = 0; i < frames.size() && i < framesPerSecond.size(); ++i)
+    {
+        bitsPerSecond += frameBits(frames[i], stuffing) * framesPerSecond[i];
+    }
+
+    return bitsPerSecond / m_bitrate;
+}
+
+int CANObjects::BusLoadEstimator::bitrate() const
+{
+    return m_bitrate;
+}
@@ -0,0 +1,93 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include "canbase_global.hpp"
+
+#include <QByteArray>
+#include <QCanBusFrame>
+#include <QVector>
+
+namespace CANObjects {
+
+/*
+ * On-wire frame length and bus load.
+ *
+ * Frame length covers SOF up to the interframe space. Classic frames can be
+ * stuffed exactly (CRC15 and stuff bits are computed from the real bit
+ * stream) or with the worst case bound, FD frames use the worst case and
+ * count data phase bits scaled to nominal bit times. FD payloads are padded
+ * to the next DLC size (12, 16, 20, 24, 32, 48 or 64 bytes) first.
+ *
+ * Live load sums frame lengths in a ring of time buckets, adding a frame
+ * is O(1) so it can stay enabled in the RX path.
+ */
+class CANBASESHARED_EXPORT BusLoadEstimator
+{
+public:
+    enum class Stuffing
+    {
+        None,
+        WorstCase,
+        Actual,
+    };
+
+    explicit BusLoadEstimator(int bitrate = 500000, int dataBitrate = 2000000,
+                              qint64 windowUs = 1000000, int buckets = 10);
+
+    //length in nominal bit times
+    double frameBits(const QCanBusFrame &frame, Stuffing stuffing) const;
+
+    static int classicFrameBits(quint32 frameID, bool extended, const QByteArray &payload, bool remote, Stuffing stuffing);
+    static double fdFrameBits(bool extended, int payloadBytes, double dataPhaseRatio, Stuffing stuffing);
+
+    void addFrame(const QCanBusFrame &frame);
+    void addFrame(const QCanBusFrame &frame, qint64 timestampUs);
+    void reset();
+
+    //0..1 over the window ending at the last added frame or at nowUs
+    double load() const;
+    double load(qint64 nowUs) const;
+
+    //schedule prediction, framesPerSecond[i] is the rate of frames[i]
+    double predictedLoad(const QVector<QCanBusFrame> &frames, const QVector<double> &framesPerSecond,
+                         Stuffing stuffing = Stuffing::WorstCase) const;
+
+    int bitrate() const;
+
+private:
+    struct Bucket
+    {
+        qint64 index = -1;
+        double bits = 0.0;
+    };
+
+    int m_bitrate = 500000;
+    int m_dataBitrate = 2000000;
+    qint64 m_bucketUs = 100000;
+    qint64 m_lastUs = 0;
+
+    QVector<Bucket> m_buckets;
+};
+
+}
@@ -0,0 +1,412 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "canbusengine.hpp"
+
+#include "framedispatcher.hpp"
+#include "latencyprobe.hpp"
+
+#ifdef Q_OS_LINUX
+#include <net/if.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#endif
+
+CANObjects::CanBusEngine::CanBusEngine(const QVector<BusConfig> &buses)
+{
+    for (int i = 0; i < buses.size(); ++i)
+    {
+        std::unique_ptr<Bus> bus(new Bus);
+        const BusConfig &config = buses[i];
+
+        bus->config = config;
+        bus->decoder = SignalDecoder(config.canObjects);
+        bus->decoder.setBus(i);
+        bus->batch.setIndex(FrameIndex(FrameDispatcher(config.canObjects).frameIDs()));
+
+        //pointers into the bus stay valid, buses are never moved
+        if (!config.e2eProfiles.isEmpty())
+        {
+            bus->protection = E2EProtection(config.e2eProfiles);
+            bus->decoder.setProtection(&bus->protection);
+        }
+
+        if (!config.frameCycles.isEmpty())
+        {
+            bus->supervisor = FrameSupervisor(config.frameCycles);
+            bus->decoder.setSupervisor(&bus->supervisor);
+        }
+
+        m_buses.push_back(std::move(bus));
+    }
+}
+
+CANObjects::CanBusEngine::~CanBusEngine()
+{
+    stop();
+}
+
+void CANObjects::CanBusEngine::addSink(int bus, SignalSink *sink)
+{
+    m_buses[static_cast<size_t>(bus)]->decoder.addSink(sink);
+}
+
+bool CANObjects::CanBusEngine::isRunning() const
+{
+    return m_running;
+}
+
+QString CANObjects::CanBusEngine::errorString() const
+{
+    return m_errorString;
+}
+
+int CANObjects::CanBusEngine::busCount() const
+{
+    return static_cast<int>(m_buses.size());
+}
+
+int CANObjects::CanBusEngine::busIndex(const QString &name) const
+{
+    for (size_t i = 0; i < m_buses.size(); ++i)
+    {
+        if (m_buses[i]->config.name == name)
+        {
+            return static_cast<int>(i);
+        }
+    }
+
+    return -1;
+}
+
+const CANObjects::BusConfig &CANObjects::CanBusEngine::busConfig(int bus) const
+{
+    return m_buses[static_cast<size_t>(bus)]->config;
+}
+
+const CANObjects::SignalDecoder &CANObjects::CanBusEngine::decoder(int bus) const
+{
+    return m_buses[static_cast<size_t>(bus)]->decoder;
+}
+
+const CANObjects::FrameSnapshotTable &CANObjects::CanBusEngine::latestFrames(int bus) const
+{
+    return m_buses[static_cast<size_t>(bus)]->latest;
+}
+
+quint64 CANObjects::CanBusEngine::received(int bus) const
+{
+    return m_buses[static_cast<size_t>(bus)]->received.load(std::memory_order_relaxed);
+}
+
+QString CANObjects::CanBusEngine::qualifiedName(int bus, int signal) const
+{
+    const Bus &b = *m_buses[static_cast<size_t>(bus)];
+
+    return b.config.name + QLatin1Char('.') + b.config.canObjects[signal].getName();
+}
+
+bool CANObjects::CanBusEngine::find(const QString &qualifiedName, int &bus, int &signal) const
+{
+    const int dot = qualifiedName.indexOf(QLatin1Char('.'));
+
+    if (dot < 0)
+    {
+        return false;
+    }
+
+    bus = busIndex(qualifiedName.left(dot));
+
+    if (bus < 0)
+    {
+        return false;
+    }
+
+    signal = m_buses[static_cast<size_t>(bus)]->decoder.indexOf(qualifiedName.mid(dot + 1));
+
+    return signal >= 0;
+}
+
+void CANObjects::CanBusEngine::process(int bus, const QVector<QCanBusFrame> &frames)
+{
+    Bus &b = *m_buses[static_cast<size_t>(bus)];
+
+    for (const QCanBusFrame &frame : frames)
+    {
+        const QByteArray payload = frame.payload();
+        receive(b, frame.frameId(), payloadToWord(payload), static_cast<quint8>(payload.size()),
+                FrameSnapshotTable::timestampUs(frame));
+
+        if (b.batch.size() == BatchSize)
+        {
+            finishBatch(b);
+        }
+    }
+
+    finishBatch(b);
+}
+
+void CANObjects::CanBusEngine::receive(Bus &bus, quint32 frameID, quint64 payload, quint8 size, qint64 timestampUs)
+{
+    //single writer per bus, no read-modify-write needed
+    bus.received.store(bus.received.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    bus.latest.write(frameID, payload, size, timestampUs);
+    bus.batch.append(frameID, payload, size, timestampUs);
+}
+
+void CANObjects::CanBusEngine::finishBatch(Bus &bus)
+{
+    if (!bus.batch.isEmpty())
+    {
+        bus.decoder.decode(bus.batch);
+        bus.batch.clear();
+    }
+}
+
+#ifdef Q_OS_LINUX
+
+bool CANObjects::CanBusEngine::start()
+{
+    if (m_running)
+    {
+        return true;
+    }
+
+    for (const std::unique_ptr<Bus> &bus : m_buses)
+    {
+        bus->socket = ::socket(PF_CAN, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, CAN_RAW);
+
+        if (bus->socket < 0)
+        {
+            m_errorString = QStringLiteral("socket: ") + QString::fromLocal8Bit(strerror(errno));
+            closeSockets();
+            return false;
+        }
+
+        const int enable = 1;
+        ::setsockopt(bus->socket, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &enable, sizeof(enable));
+        ::setsockopt(bus->socket, SOL_SOCKET, SO_TIMESTAMP, &enable, sizeof(enable));
+
+        //every bus filters for its own frame IDs only
+        can_filter filter;
+        filter.can_id = bus->config.filter.frameId;
+        filter.can_mask = bus->config.filter.frameIdMask;
+        ::setsockopt(bus->socket, SOL_CAN_RAW, CAN_RAW_FILTER, &filter, sizeof(filter));
+
+        sockaddr_can address;
+        memset(&address, 0, sizeof(address));
+        address.can_family = AF_CAN;
+        address.can_ifindex = static_cast<int>(if_nametoindex(bus->config.canDeviceName.toLatin1().constData()));
+
+        if (address.can_ifindex == 0 || ::bind(bus->socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0)
+        {
+            m_errorString = QStringLiteral("bind ") + bus->config.canDeviceName + QStringLiteral(": ") +
+                    QString::fromLocal8Bit(strerror(errno));
+            closeSockets();
+            return false;
+        }
+    }
+
+    //never read, stays readable after stop() and wakes every thread
+    m_wakeup = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (m_wakeup < 0)
+    {
+        m_errorString = QStringLiteral("eventfd: ") + QString::fromLocal8Bit(strerror(errno));
+        closeSockets();
+        return false;
+    }
+
+    m_running = true;
+
+    //the decoder restarts deadlines with kernel receive timestamps, supervision runs on their clock
+    for (const std::unique_ptr<Bus> &bus : m_buses)
+    {
+        bus->supervisor.arm(LatencyProbe::nowUs());
+        bus->thread = std::thread(&CanBusEngine::run, this, std::ref(*bus));
+    }
+
+    return true;
+}
+
+void CANObjects::CanBusEngine::stop()
+{
+    if (!m_running)
+    {
+        return;
+    }
+
+    m_running = false;
+
+    const quint64 one = 1;
+    const ssize_t written = ::write(m_wakeup, &one, sizeof(one));
+    Q_UNUSED(written)
+
+    for (const std::unique_ptr<Bus> &bus : m_buses)
+    {
+        bus->thread.join();
+    }
+
+    closeSockets();
+}
+
+void CANObjects::CanBusEngine::closeSockets()
+{
+    for (const std::unique_ptr<Bus> &bus : m_buses)
+    {
+        if (bus->socket >= 0)
+        {
+            ::close(bus->socket);
+            bus->socket = -1;
+        }
+    }
+
+    if (m_wakeup >= 0)
+    {
+        ::close(m_wakeup);
+        m_wakeup = -1;
+    }
+}
+
+void CANObjects::CanBusEngine::run(Bus &bus)
+{
+    //touches only its own bus, buffers live on this stack
+    pollfd fds[2];
+    fds[0].fd = bus.socket;
+    fds[0].events = POLLIN;
+    fds[1].fd = m_wakeup;
+    fds[1].events = POLLIN;
+
+    canfd_frame frame;
+    char control[CMSG_SPACE(sizeof(timeval))];
+
+    iovec vector;
+    vector.iov_base = &frame;
+    vector.iov_len = sizeof(frame);
+
+    msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &vector;
+    message.msg_iovlen = 1;
+
+    //supervised buses wake up to report timeouts while nothing arrives
+    const bool supervised = !bus.config.frameCycles.isEmpty();
+    const int timeoutMs = supervised ? SupervisionTickMs : -1;
+
+    while (m_running)
+    {
+        if (::poll(fds, 2, timeoutMs) < 0 && errno != EINTR)
+        {
+            break;
+        }
+
+        if (fds[0].revents & POLLIN)
+        {
+            while (true)
+            {
+                message.msg_control = control;
+                message.msg_controllen = sizeof(control);
+
+                const ssize_t size = ::recvmsg(bus.socket, &message, MSG_DONTWAIT);
+
+                if (size != CAN_MTU && size != CANFD_MTU)
+                {
+                    break;
+                }
+
+                if (frame.can_id & CAN_ERR_FLAG)
+                {
+                    continue;
+                }
+
+                qint64 rxUs = 0;
+
+                for (cmsghdr *cmsg = CMSG_FIRSTHDR(&message); cmsg; cmsg = CMSG_NXTHDR(&message, cmsg))
+                {
+                    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_TIMESTAMP)
+                    {
+                        timeval stamp;
+                        memcpy(&stamp, CMSG_DATA(cmsg), sizeof(stamp));
+                        rxUs = static_cast<qint64>(stamp.tv_sec) * 1000000 + stamp.tv_usec;
+                    }
+                }
+
+                const quint32 frameID = frame.can_id & (frame.can_id & CAN_EFF_FLAG ? CAN_EFF_MASK : CAN_SFF_MASK);
+
+                quint64 payload = 0;
+
+                for (int i = 0; i < frame.len && i < 8; ++i)
+                {
+                    payload |= static_cast<quint64>(frame.data[i]) << (56 - 8*i);
+                }
+
+                receive(bus, frameID, payload, frame.len, rxUs);
+
+                if (bus.batch.size() == BatchSize)
+                {
+                    finishBatch(bus);
+                }
+            }
+
+            finishBatch(bus);
+        }
+
+        if (supervised)
+        {
+            bus.decoder.expire(LatencyProbe::nowUs());
+        }
+    }
+}
+
+#else
+
+bool CANObjects::CanBusEngine::start()
+{
+    m_errorString = QStringLiteral("bus engine needs SocketCAN");
+    return false;
+}
+
+void CANObjects::CanBusEngine::stop()
+{
+
+}
+
+void CANObjects::CanBusEngine::closeSockets()
+{
+
+}
+
+void CANObjects::CanBusEngine::run(Bus &bus)
+{
+    Q_UNUSED(bus)
+}
+
+#endif
@@ -0,0 +1,125 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include "canbase_global.hpp"
+
+#include "canconfigloader.hpp"
+#include "e2eprotection.hpp"
+#include "framebatch.hpp"
+#include "framesnapshottable.hpp"
+#include "framesupervisor.hpp"
+#include "signaldecoder.hpp"
+
+#include <QCanBusFrame>
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace CANObjects {
+
+/*
+ * Receives and decodes several CAN buses at once, one I/O thread per bus.
+ *
+ * Every bus has its own raw SocketCAN socket and filter, and its own
+ * frame-ID namespace: SignalDecoder, E2E state, timeout supervision and
+ * latest frame table. All of it is owned by the thread of the bus, buses
+ * share only the configuration, which is read only while running. There is
+ * no lock on the receive path, buses scale with the number of cores.
+ *
+ * Sinks are added per bus and called on the thread of their bus. Decoded
+ * signals carry the index of their bus, signal names are qualified as
+ * "bus.signal". Latest frames of a bus can be read from any thread through
+ * its FrameSnapshotTable.
+ *
+ * Linux only, start() fails elsewhere.
+ */
+class CANBASESHARED_EXPORT CanBusEngine
+{
+public:
+    explicit CanBusEngine(const QVector<BusConfig> &buses);
+    ~CanBusEngine();
+
+    CanBusEngine(const CanBusEngine&) = delete;
+    CanBusEngine &operator=(const CanBusEngine&) = delete;
+
+    //called on the thread of the bus, add before start()
+    void addSink(int bus, SignalSink *sink);
+
+    bool start();
+    void stop();
+    bool isRunning() const;
+    QString errorString() const;
+
+    int busCount() const;
+    int busIndex(const QString &name) const;
+    const BusConfig &busConfig(int bus) const;
+    const SignalDecoder &decoder(int bus) const;
+    const FrameSnapshotTable &latestFrames(int bus) const;
+    quint64 received(int bus) const;
+
+    QString qualifiedName(int bus, int signal) const;
+    //bus names end at the first dot, signal names may contain more
+    bool find(const QString &qualifiedName, int &bus, int &signal) const;
+
+    //receive path of bus for frames read elsewhere (replay, tests), only while stopped
+    void process(int bus, const QVector<QCanBusFrame> &frames);
+
+private:
+    static constexpr int BatchSize = 256;
+    static constexpr int SupervisionTickMs = 10;
+
+    //one per bus, on its own cache lines
+    struct alignas(64) Bus
+    {
+        BusConfig config;
+        SignalDecoder decoder;
+        E2EProtection protection;
+        FrameSupervisor supervisor;
+        FrameBatch batch;
+        FrameSnapshotTable latest;
+        std::atomic<quint64> received{0};
+
+        int socket = -1;
+        std::thread thread;
+    };
+
+    std::vector<std::unique_ptr<Bus>> m_buses;
+
+    int m_wakeup = -1;
+    std::atomic<bool> m_running{false};
+    QString m_errorString;
+
+    void receive(Bus &bus, quint32 frameID, quint64 payload, quint8 size, qint64 timestampUs);
+    void finishBatch(Bus &bus);
+
+    void run(Bus &bus);
+    void closeSockets();
+};
+
+}
@@ -29,6 +29,7 @@
 #include <QJsonObject>
 #include <QVariantMap>
 #include <QVariantList>
+#include <QSet>
 #include <QtDebug>
 
 CANObjects::Config CANObjects::ConfigLoader::loadConfig(const QString &path)
@@ -47,13 +48,69 @@ CANObjects::Config CANObjects::ConfigLoader::loadConfig(const QString &path)
     const QByteArray allData = file.readAll();
     const QVariantMap res = QJsonDocument::fromJson(allData).toVariant().toMap();
 
+    //buses, a file without them is a single bus
+    const QVariantList busList = res["buses"].toList();
+
+    for (const QVariant &bus : busList)
+    {
+        config.buses.push_back(loadBus(bus.toMap()));
+    }
+
+    if (busList.isEmpty())
+    {
+        config.buses.push_back(loadBus(res));
+    }
+
+    const BusConfig &first = config.buses.first();
+    config.canDeviceName = first.canDeviceName;
+    config.canDevicePlugin = first.canDevicePlugin;
+    config.filter = first.filter;
+    config.canObjects = first.canObjects;
+    config.e2eProfiles = first.e2eProfiles;
+    config.frameCycles = first.frameCycles;
+
+    //gateway
+    const QVariantMap gateway = res["gateway"].toMap();
+
+    for (const QVariant &value : gateway["routes"].toList())
+    {
+        const QVariantMap map = value.toMap();
+
+        GatewayRoute route;
+        route.from = map["from"].toString();
+        route.to = map["to"].toString();
+        route.frameID = map["frameid"].toUInt();
+        route.remap = map.value("remap", -1).toLongLong();
+        config.gateway.routes.push_back(route);
+    }
+
+    for (const QVariant &value : gateway["copies"].toList())
+    {
+        const QVariantMap map = value.toMap();
+
+        GatewaySignalCopy copy;
+        copy.from = map["from"].toString();
+        copy.to = map["to"].toString();
+        copy.source = map["source"].toString();
+        copy.target = map["target"].toString();
+        config.gateway.copies.push_back(copy);
+    }
+
+    return config;
+}
+
+CANObjects::BusConfig CANObjects::ConfigLoader::loadBus(const QVariantMap &map)
+{
+    BusConfig bus;
+
     //device
-    const QVariantMap device = res["device"].toMap();
-    config.canDeviceName = device["name"].toString();
-    config.canDevicePlugin = device["plugin"].toString();
+    const QVariantMap device = map["device"].toMap();
+    bus.canDeviceName = device["name"].toString();
+    bus.canDevicePlugin = device["plugin"].toString();
+    bus.name = map.value("name", bus.canDeviceName).toString();
 
     //canObjects
-    const QVariantList objectList = res["canobjects"].toList();
+    const QVariantList objectList = map["canobjects"].toList();
 
     quint32 filterMask = std::numeric_limits<quint32>::max();
 
@@ -62,11 +119,190 @@ CANObjects::Config CANObjects::ConfigLoader::loadConfig(const QString &path)
     {
         CanObject obj(object.toMap());
         filterMask &= obj.getFilterMask();
-        config.canObjects.push_back(obj);
+        bus.canObjects.push_back(obj);
     }
 
-    config.filter.frameIdMask = filterMask & 65535; //hax: ~ does not work
-    config.filter.frameId = 0u;
+    //multiplexed signals use the multiplexor of the frame they start in
+    QHash<quint32, int> multiplexors;
 
-    return config;
+    for (int i = 0; i < bus.canObjects.size(); ++i)
+    {
+        const CanObject &obj = bus.canObjects[i];
+
+        if (obj.isMultiplexor() && !obj.getRanges().isEmpty())
+        {
+            multiplexors.insert(obj.getRanges().first().frameID, i);
+        }
+    }
+
+    for (CanObject &obj : bus.canObjects)
+    {
+        if (!obj.isMultiplexed() || obj.getRanges().isEmpty())
+        {
+            continue;
+        }
+
+        auto it = multiplexors.find(obj.getRanges().first().frameID);
+
+        if (it == multiplexors.end())
+        {
+            qWarning() << "multiplexed signal" << obj.getName() << "has no multiplexor in its frame";
+            continue;
+        }
+
+        obj.linkMultiplexor(bus.canObjects[it.value()]);
+    }
+
+    //E2E protected frames
+    for (const QVariant &profile : map["e2e"].toList())
+    {
+        bus.e2eProfiles.push_back(E2EProfile(profile.toMap()));
+    }
+
+    //expected cycle times
+    for (const QVariant &cycle : map["cycles"].toList())
+    {
+        bus.frameCycles.push_back(FrameCycle(cycle.toMap()));
+    }
+
+    bus.filter.frameIdMask = filterMask & 65535; //hax: ~ does not work
+    bus.filter.frameId = 0u;
+
+    return bus;
+}
+
+bool CANObjects::BusConfig::operator==(const BusConfig &other) const
+{
+    return name == other.name && canDeviceName == other.canDeviceName && canDevicePlugin == other.canDevicePlugin &&
+            filter.frameId == other.filter.frameId && filter.frameIdMask == other.filter.frameIdMask &&
+            filter.type == other.filter.type && filter.format == other.filter.format &&
+            canObjects == other.canObjects && e2eProfiles == other.e2eProfiles && frameCycles == other.frameCycles;
+}
+
+bool CANObjects::BusConfig::operator!=(const BusConfig &other) const
+{
+    return !(*this == other);
+}
+
+bool CANObjects::ConfigDiff::isEmpty() const
+{
+    return addedSignals.isEmpty() && removedSignals.isEmpty() && changedSignals.isEmpty() &&
+            !deviceChanged && !filterChanged && !e2eChanged && !cyclesChanged && !gatewayChanged && !busesChanged;
+}
+
+bool CANObjects::GatewayRoute::operator==(const GatewayRoute &other) const
+{
+    return from == other.from && to == other.to && frameID == other.frameID && remap == other.remap;
+}
+
+bool CANObjects::GatewaySignalCopy::operator==(const GatewaySignalCopy &other) const
+{
+    return from == other.from && to == other.to && source == other.source && target == other.target;
+}
+
+bool CANObjects::GatewayConfig::isEmpty() const
+{
+    return routes.isEmpty() && copies.isEmpty();
+}
+
+bool CANObjects::GatewayConfig::operator==(const GatewayConfig &other) const
+{
+    return routes == other.routes && copies == other.copies;
+}
+
+bool CANObjects::GatewayConfig::operator!=(const GatewayConfig &other) const
+{
+    return !(*this == other);
+}
+
+CANObjects::ConfigDiff CANObjects::ConfigLoader::diff(const Config &oldConfig, const Config &newConfig)
+{
+    ConfigDiff diff;
+
+    diff.deviceChanged = oldConfig.canDeviceName != newConfig.canDeviceName ||
+            oldConfig.canDevicePlugin != newConfig.canDevicePlugin;
+
+    diff.filterChanged = oldConfig.filter.frameId != newConfig.filter.frameId ||
+            oldConfig.filter.frameIdMask != newConfig.filter.frameIdMask ||
+            oldConfig.filter.type != newConfig.filter.type ||
+            oldConfig.filter.format != newConfig.filter.format;
+
+    diff.e2eChanged = oldConfig.e2eProfiles != newConfig.e2eProfiles;
+    diff.cyclesChanged = oldConfig.frameCycles != newConfig.frameCycles;
+    diff.gatewayChanged = oldConfig.gateway != newConfig.gateway;
+    diff.busesChanged = oldConfig.buses != newConfig.buses;
+
+    QHash<QString, const CanObject*> oldObjects;
+    QSet<quint32> oldFrames, newFrames, touched;
+
+    for (const CanObject &obj : oldConfig.canObjects)
+    {
+        oldObjects.insert(obj.getName(), &obj);
+
+        for (const FrameRange &range : obj.getRanges())
+        {
+            oldFrames.insert(range.frameID);
+        }
+    }
+
+    auto touch = [&touched](const CanObject &obj)
+    {
+        for (const FrameRange &range : obj.getRanges())
+        {
+            touched.insert(range.frameID);
+        }
+    };
+
+    for (const CanObject &obj : newConfig.canObjects)
+    {
+        for (const FrameRange &range : obj.getRanges())
+        {
+            newFrames.insert(range.frameID);
+        }
+
+        auto it = oldObjects.find(obj.getName());
+
+        if (it == oldObjects.end())
+        {
+            diff.addedSignals.push_back(obj.getName());
+            touch(obj);
+        }
+        else
+        {
+            if (**it != obj)
+            {
+                diff.changedSignals.push_back(obj.getName());
+                touch(**it);
+                touch(obj);
+            }
+
+            oldObjects.erase(it);
+        }
+    }
+
+    for (const CanObject *obj : oldObjects)
+    {
+        diff.removedSignals.push_back(obj->getName());
+        touch(*obj);
+    }
+
+    for (const quint32 frameID : newFrames)
+    {
+        if (!oldFrames.contains(frameID))
+        {
+            diff.addedFrames.push_back(frameID);
+        }
+    }
+
+    for (const quint32 frameID : oldFrames)
+    {
+        if (!newFrames.contains(frameID))
+        {
+            diff.removedFrames.push_back(frameID);
+        }
+    }
+
+    diff.touchedFrames = touched.values().toVector();
+
+    return diff;
 }
@@ -25,18 +25,109 @@
 #include "canbase_global.hpp"
 
 #include "canobject.hpp"
+#include "e2eprotection.hpp"
+#include "framesupervisor.hpp"
 
 #include <QString>
+#include <QVariantMap>
+#include <QStringList>
 #include <QCanBusDevice>
 
 namespace CANObjects {
 
+//frame forwarded from one device to another, remap -1 keeps the ID
+struct CANBASESHARED_EXPORT GatewayRoute
+{
+    QString from;
+    QString to;
+    quint32 frameID = 0;
+    qint64 remap = -1;
+
+    bool operator==(const GatewayRoute &other) const;
+};
+
+//raw bits of source signal copied into target signal whenever the source frame arrives,
+//source is a signal of the bus on device from, target one of the bus on device to
+struct CANBASESHARED_EXPORT GatewaySignalCopy
+{
+    QString from;
+    QString to;
+    QString source;
+    QString target;
+
+    bool operator==(const GatewaySignalCopy &other) const;
+};
+
+/*
+ *   "gateway": {
+ *     "routes": [{"from": "vcan0", "to": "vcan1", "frameid": 544, "remap": 1568}],
+ *     "copies": [{"from": "vcan0", "to": "vcan1", "source": "brake pedal", "target": "body brake"}]
+ *   }
+ */
+struct CANBASESHARED_EXPORT GatewayConfig
+{
+    QVector<GatewayRoute> routes;
+    QVector<GatewaySignalCopy> copies;
+
+    bool isEmpty() const;
+    bool operator==(const GatewayConfig &other) const;
+    bool operator!=(const GatewayConfig &other) const;
+};
+
+/*
+ *   "buses": [
+ *     {"name": "powertrain", "device": {"name": "can0", "plugin": "socketcan"},
+ *      "canobjects": [...], "e2e": [...], "cycles": [...]},
+ *     {"name": "body", "device": {"name": "can1", "plugin": "socketcan"}, "canobjects": [...]}
+ *   ]
+ *
+ * Every bus has its own frame-ID namespace, the same ID may carry different
+ * signals on different buses. Files without "buses" describe one bus named
+ * after its device, with the same keys at top level.
+ */
+struct CANBASESHARED_EXPORT BusConfig
+{
+    QString name;
+    QString canDeviceName;
+    QString canDevicePlugin;
+    QCanBusDevice::Filter filter;
+    QVector<CanObject> canObjects;
+    QVector<E2EProfile> e2eProfiles;
+    QVector<FrameCycle> frameCycles;
+
+    bool operator==(const BusConfig &other) const;
+    bool operator!=(const BusConfig &other) const;
+};
+
+//top level device, filter, signals, E2E and cycles are those of the first bus
 struct CANBASESHARED_EXPORT Config
 {
     QString canDeviceName;
     QString canDevicePlugin;
     QCanBusDevice::Filter filter;
     QVector<CanObject> canObjects;
+    QVector<E2EProfile> e2eProfiles;
+    QVector<FrameCycle> frameCycles;
+    QVector<BusConfig> buses;
+    GatewayConfig gateway;
+};
+
+struct CANBASESHARED_EXPORT ConfigDiff
+{
+    QStringList addedSignals;
+    QStringList removedSignals;
+    QStringList changedSignals;
+    QVector<quint32> addedFrames;
+    QVector<quint32> removedFrames;
+    QVector<quint32> touchedFrames; //frames carrying any added, removed or changed signal
+    bool deviceChanged = false;
+    bool filterChanged = false;
+    bool e2eChanged = false;
+    bool cyclesChanged = false;
+    bool gatewayChanged = false;
+    bool busesChanged = false;      //any bus added, removed or changed, the first one is diffed in detail above
+
+    bool isEmpty() const;
 };
 
 class CANBASESHARED_EXPORT ConfigLoader
@@ -45,6 +136,12 @@ public:
     ConfigLoader() = delete;
 
     static Config loadConfig(const QString &path);
+
+    //signals are matched by name
+    static ConfigDiff diff(const Config &oldConfig, const Config &newConfig);
+
+private:
+    static BusConfig loadBus(const QVariantMap &map);
 };
 
 }
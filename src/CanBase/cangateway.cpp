@@ -0,0 +1,532 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "cangateway.hpp"
+
+#include "latencyprobe.hpp"
+
+#include <QMap>
+#include <QtDebug>
+
+#include <algorithm>
+
+#ifdef Q_OS_LINUX
+#include <net/if.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#endif
+
+CANObjects::CanGateway::CanGateway(const GatewayConfig &config, const QVector<BusConfig> &buses)
+{
+    //every device has its own frame-ID namespace, signals are looked up on the bus of their device
+    QHash<QString, QHash<QString, const CanObject*>> busObjects;
+
+    for (const BusConfig &bus : buses)
+    {
+        QHash<QString, const CanObject*> &objects = busObjects[bus.canDeviceName];
+
+        for (const CanObject &obj : bus.canObjects)
+        {
+            objects.insert(obj.getName(), &obj);
+        }
+    }
+
+    //actions grouped by receiving device and frame
+    QMap<quint64, QVector<Action>> grouped;
+
+    for (const GatewayRoute &route : config.routes)
+    {
+        Action action;
+        action.route = m_routeNames.size();
+        action.device = addDevice(route.to);
+        action.frameID = route.remap >= 0 ? static_cast<quint32>(route.remap) : route.frameID;
+
+        grouped[actionKey(addDevice(route.from), route.frameID)].push_back(action);
+        m_routeNames.push_back(QString("%1 %2 -> %3 %4").arg(route.from).arg(route.frameID).arg(route.to).arg(action.frameID));
+    }
+
+    QHash<quint64, int> targetIndex;
+
+    for (const GatewaySignalCopy &copy : config.copies)
+    {
+        const CanObject *source = busObjects.value(copy.from).value(copy.source, nullptr);
+        const CanObject *target = busObjects.value(copy.to).value(copy.target, nullptr);
+
+        if (!source || !target || source->getRanges().isEmpty() || target->getRanges().isEmpty())
+        {
+            qWarning() << "gateway copy" << copy.from << copy.source << "->" << copy.to << copy.target << "has unknown signals";
+            continue;
+        }
+
+        const CanObject &sourceObj = *source;
+        const CanObject &targetObj = *target;
+
+        Action action;
+        action.route = m_routeNames.size();
+        action.device = addDevice(copy.to);
+        action.frameID = targetObj.getRanges().first().frameID;
+
+        //target frames are kept per device, the same ID may be another frame elsewhere
+        auto it = targetIndex.find(actionKey(action.device, action.frameID));
+
+        if (it == targetIndex.end())
+        {
+            it = targetIndex.insert(actionKey(action.device, action.frameID), m_targets.size());
+            m_targets.push_back(TargetFrame());
+        }
+
+        action.target = it.value();
+        action.readBegin = m_reads.size();
+        addMoves(sourceObj, m_reads);
+        action.readEnd = m_reads.size();
+        action.writeBegin = m_writes.size();
+        addMoves(targetObj, m_writes);
+        action.writeEnd = m_writes.size();
+
+        grouped[actionKey(addDevice(copy.from), sourceObj.getRanges().first().frameID)].push_back(action);
+        m_routeNames.push_back(QString("%1 -> %2").arg(copy.source).arg(copy.target));
+    }
+
+    for (auto it = grouped.constBegin(); it != grouped.constEnd(); ++it)
+    {
+        m_actionRanges.insert(it.key(), qMakePair(m_actions.size(), m_actions.size() + it.value().size()));
+        m_actions += it.value();
+    }
+
+    m_stats.reset(new RouteStats[static_cast<size_t>(std::max(1, m_routeNames.size()))]);
+}
+
+CANObjects::CanGateway::~CanGateway()
+{
+    stop();
+}
+
+bool CANObjects::CanGateway::isRunning() const
+{
+    return m_running;
+}
+
+QString CANObjects::CanGateway::errorString() const
+{
+    return m_errorString;
+}
+
+const QStringList &CANObjects::CanGateway::devices() const
+{
+    return m_devices;
+}
+
+int CANObjects::CanGateway::deviceIndex(const QString &name) const
+{
+    return m_devices.indexOf(name);
+}
+
+int CANObjects::CanGateway::routeCount() const
+{
+    return m_routeNames.size();
+}
+
+QString CANObjects::CanGateway::routeName(int route) const
+{
+    return m_routeNames.value(route);
+}
+
+quint64 CANObjects::CanGateway::forwarded(int route) const
+{
+    return m_stats[static_cast<size_t>(route)].forwarded.load(std::memory_order_relaxed);
+}
+
+quint64 CANObjects::CanGateway::dropped(int route) const
+{
+    return m_stats[static_cast<size_t>(route)].dropped.load(std::memory_order_relaxed);
+}
+
+CANObjects::LatencyHistogram CANObjects::CanGateway::latency(int route) const
+{
+    const RouteStats &stats = m_stats[static_cast<size_t>(route)];
+    quint64 counts[LatencyHistogram::BucketCount];
+
+    //sum may hold a few samples more than the buckets while forwarding
+    for (int bucket = 0; bucket < LatencyHistogram::BucketCount; ++bucket)
+    {
+        counts[bucket] = stats.latency[bucket].load(std::memory_order_acquire);
+    }
+
+    LatencyHistogram histogram;
+    histogram.merge(counts, stats.latencyMin.load(std::memory_order_relaxed), stats.latencyMax.load(std::memory_order_relaxed),
+                    static_cast<double>(stats.latencySum.load(std::memory_order_relaxed)));
+
+    return histogram;
+}
+
+void CANObjects::CanGateway::RouteStats::record(qint64 latencyUs)
+{
+    //single writer, no read-modify-write needed
+    latencyUs = std::max<qint64>(0, latencyUs);
+    std::atomic<quint64> &bucket = latency[LatencyHistogram::bucketOf(static_cast<quint64>(latencyUs))];
+
+    latencySum.store(latencySum.load(std::memory_order_relaxed) + static_cast<quint64>(latencyUs), std::memory_order_relaxed);
+    latencyMin.store(std::min(latencyMin.load(std::memory_order_relaxed), latencyUs), std::memory_order_relaxed);
+    latencyMax.store(std::max(latencyMax.load(std::memory_order_relaxed), latencyUs), std::memory_order_relaxed);
+
+    //a reader seeing the sample in its bucket sees it in min and max as well
+    bucket.store(bucket.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+int CANObjects::CanGateway::apply(int device, quint32 frameID, quint64 payload, quint8 size, GatewayOutput *outputs, int maxOutputs)
+{
+    auto it = m_actionRanges.constFind(actionKey(device, frameID));
+
+    if (it == m_actionRanges.constEnd())
+    {
+        return 0;
+    }
+
+    int count = 0;
+
+    for (int i = it.value().first; i < it.value().second && count < maxOutputs; ++i)
+    {
+        const Action &action = m_actions.at(i);
+        GatewayOutput &output = outputs[count++];
+
+        output.device = action.device;
+        output.frameID = action.frameID;
+        output.route = action.route;
+
+        if (action.target < 0)
+        {
+            output.payload = payload;
+            output.size = size;
+            continue;
+        }
+
+        quint64 raw = 0;
+
+        for (int read = action.readBegin; read < action.readEnd; ++read)
+        {
+            const BitMove &move = m_reads.at(read);
+            raw |= ((payload & move.frameMask) >> move.frameShift) << move.valueOffset;
+        }
+
+        quint64 &target = m_targets[action.target].payload;
+
+        for (int write = action.writeBegin; write < action.writeEnd; ++write)
+        {
+            const BitMove &move = m_writes.at(write);
+            target = (target & ~move.frameMask) | (((raw >> move.valueOffset) & move.valueMask) << move.frameShift);
+        }
+
+        output.payload = target;
+        output.size = 8;
+    }
+
+    return count;
+}
+
+int CANObjects::CanGateway::addDevice(const QString &name)
+{
+    int index = m_devices.indexOf(name);
+
+    if (index < 0)
+    {
+        index = m_devices.size();
+        m_devices.push_back(name);
+    }
+
+    return index;
+}
+
+quint64 CANObjects::CanGateway::actionKey(int device, quint32 frameID)
+{
+    return static_cast<quint64>(device) << 32 | frameID;
+}
+
+void CANObjects::CanGateway::addMoves(const CanObject &obj, QVector<BitMove> &moves)
+{
+    const QVector<FrameRange> &ranges = obj.getRanges();
+    const quint32 frameID = ranges.first().frameID;
+
+    for (int i = 0; i < ranges.size(); ++i)
+    {
+        //signals are copied within the first frame of each signal
+        if (ranges[i].frameID != frameID)
+        {
+            continue;
+        }
+
+        BitMove move;
+        move.frameMask = ranges[i].mask();
+        move.frameShift = ranges[i].shift();
+        move.valueOffset = obj.getRangeOffset(i);
+        move.valueMask = ranges[i].mask() >> ranges[i].shift();
+        moves.push_back(move);
+    }
+}
+
+#ifdef Q_OS_LINUX
+
+bool CANObjects::CanGateway::start()
+{
+    if (m_running)
+    {
+        return true;
+    }
+
+    //the forwarding thread polls all devices from a fixed array
+    if (m_devices.size() > MaxDevices)
+    {
+        m_errorString = QStringLiteral("gateway supports at most %1 devices").arg(MaxDevices);
+        return false;
+    }
+
+    for (const QString &device : m_devices)
+    {
+        const int socket = ::socket(PF_CAN, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, CAN_RAW);
+        m_sockets.push_back(socket);
+
+        if (socket < 0)
+        {
+            m_errorString = QStringLiteral("socket: ") + QString::fromLocal8Bit(strerror(errno));
+            closeSockets();
+            return false;
+        }
+
+        const int enable = 1;
+        ::setsockopt(socket, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &enable, sizeof(enable));
+        ::setsockopt(socket, SOL_SOCKET, SO_TIMESTAMP, &enable, sizeof(enable));
+
+        sockaddr_can address;
+        memset(&address, 0, sizeof(address));
+        address.can_family = AF_CAN;
+        address.can_ifindex = static_cast<int>(if_nametoindex(device.toLatin1().constData()));
+
+        if (address.can_ifindex == 0 || ::bind(socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0)
+        {
+            m_errorString = QStringLiteral("bind ") + device + QStringLiteral(": ") + QString::fromLocal8Bit(strerror(errno));
+            closeSockets();
+            return false;
+        }
+    }
+
+    //without it stop() could not wake the thread on a quiet bus
+    m_wakeup = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    if (m_wakeup < 0)
+    {
+        m_errorString = QStringLiteral("eventfd: ") + QString::fromLocal8Bit(strerror(errno));
+        closeSockets();
+        return false;
+    }
+
+    m_running = true;
+    m_thread = std::thread(&CanGateway::run, this);
+
+    return true;
+}
+
+void CANObjects::CanGateway::stop()
+{
+    if (!m_running)
+    {
+        return;
+    }
+
+    m_running = false;
+
+    const quint64 one = 1;
+    const ssize_t written = ::write(m_wakeup, &one, sizeof(one));
+    Q_UNUSED(written)
+
+    m_thread.join();
+    closeSockets();
+}
+
+void CANObjects::CanGateway::closeSockets()
+{
+    for (const int socket : m_sockets)
+    {
+        if (socket >= 0)
+        {
+            ::close(socket);
+        }
+    }
+
+    m_sockets.clear();
+
+    if (m_wakeup >= 0)
+    {
+        ::close(m_wakeup);
+        m_wakeup = -1;
+    }
+}
+
+void CANObjects::CanGateway::run()
+{
+    //all buffers live on this stack, nothing is allocated per frame
+    constexpr int MaxOutputs = 64;
+
+    pollfd fds[MaxDevices + 1];
+    const int devices = m_sockets.size();
+
+    for (int i = 0; i < devices; ++i)
+    {
+        fds[i].fd = m_sockets[i];
+        fds[i].events = POLLIN;
+    }
+
+    fds[devices].fd = m_wakeup;
+    fds[devices].events = POLLIN;
+
+    GatewayOutput outputs[MaxOutputs];
+    canfd_frame frame;
+    char control[CMSG_SPACE(sizeof(timeval))];
+
+    iovec vector;
+    vector.iov_base = &frame;
+    vector.iov_len = sizeof(frame);
+
+    msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_iov = &vector;
+    message.msg_iovlen = 1;
+
+    while (m_running)
+    {
+        if (::poll(fds, static_cast<nfds_t>(devices + 1), -1) < 0 && errno != EINTR)
+        {
+            break;
+        }
+
+        for (int device = 0; device < devices; ++device)
+        {
+            if (!(fds[device].revents & POLLIN))
+            {
+                continue;
+            }
+
+            while (true)
+            {
+                message.msg_control = control;
+                message.msg_controllen = sizeof(control);
+
+                const ssize_t size = ::recvmsg(fds[device].fd, &message, MSG_DONTWAIT);
+
+                if (size != CAN_MTU && size != CANFD_MTU)
+                {
+                    break;
+                }
+
+                qint64 rxUs = 0;
+
+                for (cmsghdr *cmsg = CMSG_FIRSTHDR(&message); cmsg; cmsg = CMSG_NXTHDR(&message, cmsg))
+                {
+                    if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_TIMESTAMP)
+                    {
+                        timeval stamp;
+                        memcpy(&stamp, CMSG_DATA(cmsg), sizeof(stamp));
+                        rxUs = static_cast<qint64>(stamp.tv_sec) * 1000000 + stamp.tv_usec;
+                    }
+                }
+
+                const bool extended = frame.can_id & CAN_EFF_FLAG;
+                const quint32 frameID = frame.can_id & (extended ? CAN_EFF_MASK : CAN_SFF_MASK);
+
+                quint64 payload = 0;
+
+                for (int i = 0; i < frame.len && i < 8; ++i)
+                {
+                    payload |= static_cast<quint64>(frame.data[i]) << (56 - 8*i);
+                }
+
+                const int count = apply(device, frameID, payload, frame.len, outputs, MaxOutputs);
+
+                for (int i = 0; i < count; ++i)
+                {
+                    const GatewayOutput &output = outputs[i];
+                    RouteStats &stats = m_stats[static_cast<size_t>(output.route)];
+
+                    canfd_frame out = frame;
+                    out.can_id = (frame.can_id & ~(CAN_EFF_MASK | CAN_EFF_FLAG)) | output.frameID |
+                            (extended || output.frameID > CAN_SFF_MASK ? CAN_EFF_FLAG : 0);
+
+                    if (output.size <= 8)
+                    {
+                        out.len = output.size;
+
+                        for (int byte = 0; byte < output.size; ++byte)
+                        {
+                            out.data[byte] = static_cast<__u8>(output.payload >> (56 - 8*byte));
+                        }
+                    }
+
+                    if (::write(fds[output.device].fd, &out, static_cast<size_t>(size)) != size)
+                    {
+                        stats.dropped.fetch_add(1, std::memory_order_relaxed);
+                        continue;
+                    }
+
+                    stats.forwarded.fetch_add(1, std::memory_order_relaxed);
+
+                    //frames without a receive timestamp have no latency
+                    if (rxUs != 0)
+                    {
+                        stats.record(LatencyProbe::nowUs() - rxUs);
+                    }
+                }
+            }
+        }
+    }
+}
+
+#else
+
+bool CANObjects::CanGateway::start()
+{
+    m_errorString = QStringLiteral("gateway needs SocketCAN");
+    return false;
+}
+
+void CANObjects::CanGateway::stop()
+{
+
+}
+
+void CANObjects::CanGateway::closeSockets()
+{
+
+}
+
+void CANObjects::CanGateway::run()
+{
+
+}
+
+#endif
@@ -0,0 +1,160 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include "canbase_global.hpp"
+
+#include "canconfigloader.hpp"
+#include "latencyhistogram.hpp"
+
+#include <QHash>
+#include <QStringList>
+#include <QVector>
+
+#include <atomic>
+#include <limits>
+#include <memory>
+#include <thread>
+
+namespace CANObjects {
+
+struct CANBASESHARED_EXPORT GatewayOutput
+{
+    int device = 0;
+    quint32 frameID = 0;
+    quint64 payload = 0;
+    quint8 size = 0;
+    int route = 0;
+};
+
+/*
+ * Forwards frames between SocketCAN devices as configured in GatewayConfig.
+ *
+ * Routes forward a frame ID to another device, optionally under a new ID.
+ * Signal copies move the raw bits of a signal into a signal of a frame on the
+ * other device with masks precomputed from the FrameRanges, the target frame
+ * keeps its other content between copies. Devices are matched to buses by
+ * device name, every bus keeps its own signals and frame IDs.
+ *
+ * Forwarding runs on its own thread with raw sockets and does not allocate:
+ * every routing decision is a lookup into tables built in the constructor.
+ * Latency from kernel receive timestamp to completed write is kept per route
+ * (a route per forward and per copy) in atomic histogram buckets.
+ *
+ * Linux only, start() fails elsewhere.
+ */
+class CANBASESHARED_EXPORT CanGateway
+{
+public:
+    static constexpr int MaxDevices = 16;
+
+    //copies resolve their source signal on the bus of "from" and their target on the bus of "to"
+    CanGateway(const GatewayConfig &config, const QVector<BusConfig> &buses);
+    ~CanGateway();
+
+    CanGateway(const CanGateway&) = delete;
+    CanGateway &operator=(const CanGateway&) = delete;
+
+    bool start();
+    void stop();
+    bool isRunning() const;
+    QString errorString() const;
+
+    const QStringList &devices() const;
+    int deviceIndex(const QString &name) const;
+
+    int routeCount() const;
+    QString routeName(int route) const;
+    quint64 forwarded(int route) const;
+    quint64 dropped(int route) const;
+    LatencyHistogram latency(int route) const;
+
+    //frames to send for a frame received on device, returns their count (at most maxOutputs)
+    int apply(int device, quint32 frameID, quint64 payload, quint8 size, GatewayOutput *outputs, int maxOutputs);
+
+private:
+    struct Action
+    {
+        int route = 0;
+        int device = 0;
+        quint32 frameID = 0;
+        int target = -1;            //target frame of a signal copy, -1 forwards the frame
+        int readBegin = 0;
+        int readEnd = 0;
+        int writeBegin = 0;
+        int writeEnd = 0;
+    };
+
+    struct BitMove
+    {
+        quint64 frameMask = 0;
+        quint8 frameShift = 0;
+        quint8 valueOffset = 0;
+        quint64 valueMask = 0;
+    };
+
+    struct TargetFrame
+    {
+        quint64 payload = 0;
+    };
+
+    //written by the forwarding thread only, read from any thread without a lock
+    struct alignas(64) RouteStats
+    {
+        std::atomic<quint64> forwarded{0};
+        std::atomic<quint64> dropped{0};
+        std::atomic<qint64> latencyMin{std::numeric_limits<qint64>::max()};
+        std::atomic<qint64> latencyMax{0};
+        std::atomic<quint64> latencySum{0};
+        std::atomic<quint64> latency[LatencyHistogram::BucketCount] = {};
+
+        void record(qint64 latencyUs);
+    };
+
+    QStringList m_devices;
+    QStringList m_routeNames;
+
+    //actions of frames received on a device are m_actions[range.first] .. m_actions[range.second-1]
+    QHash<quint64, QPair<int, int>> m_actionRanges;
+    QVector<Action> m_actions;
+    QVector<BitMove> m_reads;
+    QVector<BitMove> m_writes;
+    QVector<TargetFrame> m_targets;
+
+    std::unique_ptr<RouteStats[]> m_stats;
+
+    QVector<int> m_sockets;
+    int m_wakeup = -1;
+    std::thread m_thread;
+    std::atomic<bool> m_running{false};
+    QString m_errorString;
+
+    int addDevice(const QString &name);
+    static quint64 actionKey(int device, quint32 frameID);
+    static void addMoves(const CanObject &obj, QVector<BitMove> &moves);
+
+    void run();
+    void closeSockets();
+};
+
+}
@@ -23,8 +23,10 @@
 #include "canobject.hpp"
 
 #include <assert.h>
+#include <cmath>
+#include <cstring>
+#include <limits>
 
-#include <QDataStream>
 #include <QVariantList>
 #include <QDebug>
 
@@ -49,6 +51,14 @@ CANObjects::CanObject::CanObject(const QVariantMap &map)
     m_minVal = map["minval"];
     m_maxVal = map["maxval"];
 
+    m_multiplexor = map["multiplexor"].toBool();
+
+    if (map.contains("muxvalue"))
+    {
+        m_multiplexed = true;
+        m_muxValue = map["muxvalue"].toUInt();
+    }
+
     const QVariantList ranges = map["ranges"].toList();
 
     for (const QVariant &range : ranges)
@@ -57,6 +67,18 @@ CANObjects::CanObject::CanObject(const QVariantMap &map)
     }
 
     computeSize();
+
+    setScaling(map.value("factor", 1.0).toDouble(), map.value("offset", 0.0).toDouble());
+
+    //raw value -> name, negative raw values of signed signals are allowed as keys
+    const QVariantMap names = map["values"].toMap();
+
+    for (auto it = names.constBegin(); it != names.constEnd(); ++it)
+    {
+        bool ok = false;
+        const qint64 raw = it.key().toLongLong(&ok);
+        m_valueNames.insert((ok ? static_cast<quint64>(raw) : it.key().toULongLong()) & sizeMask(), it.value().toString());
+    }
 }
 
 quint32 CANObjects::CanObject::getFilterMask() const
@@ -71,23 +93,39 @@ quint32 CANObjects::CanObject::getFilterMask() const
     return std::numeric_limits<quint32>::max() - retVal;
 }
 
-QVariant CANObjects::CanObject::readData(const QHash<quint32, QCanBusFrame> &inputFrames) const
+bool CANObjects::CanObject::operator ==(const CanObject &other) const
 {
-    QVariant retVal(static_cast<QVariant::Type>(m_type));
+    return m_name == other.m_name && m_type == other.m_type && m_minVal == other.m_minVal &&
+            m_maxVal == other.m_maxVal && m_ranges == other.m_ranges &&
+            m_multiplexor == other.m_multiplexor && m_multiplexed == other.m_multiplexed &&
+            m_muxValue == other.m_muxValue && m_muxRanges == other.m_muxRanges &&
+            m_factor == other.m_factor && m_offset == other.m_offset && m_valueNames == other.m_valueNames;
+}
 
-    QBitArray allData;
+bool CANObjects::CanObject::operator !=(const CanObject &other) const
+{
+    return !(*this == other);
+}
 
-    switch (m_type) {
-    case QMetaType::Type::Int:
-    case QMetaType::Type::UInt:
-        allData.fill(false,32-m_size);
-        break;
-    default:
-        break;
+QVariant CANObjects::CanObject::readData(const QHash<quint32, QCanBusFrame> &inputFrames) const
+{
+    //unlinked multiplexed signals are read as plain ones, like muxMatches() does
+    if (m_multiplexed && !m_muxRanges.isEmpty())
+    {
+        auto muxIt = inputFrames.find(m_muxFrameID);
+
+        if (muxIt == inputFrames.end() || !muxMatches(payloadToWord(muxIt->payload())))
+        {
+            return QVariant();
+        }
     }
 
-    for (const FrameRange& range : m_ranges)
+    quint64 raw = 0;
+
+    for (int i = 0; i < m_ranges.size(); ++i)
     {
+        const FrameRange &range = m_ranges[i];
+
         auto it = inputFrames.find(range.frameID);
 
         if (it == inputFrames.end())
@@ -95,112 +133,349 @@ QVariant CANObjects::CanObject::readData(const QHash<quint32, QCanBusFrame> &inp
             return QVariant();
         }
 
-        QBitArray data = bytesToBits(it->payload());
+        raw |= range.extract(payloadToWord(it->payload())) << m_rangeOffsets[i];
+    }
 
-        int oldSize = allData.size();
+    return decodeRaw(raw);
+}
 
-        allData.resize(oldSize + ((range.endBit - range.startBit) + 1));
+void CANObjects::CanObject::writeData(const QVariant &value, QHash<quint32, QCanBusFrame> &outputFrames) const
+{
+    assert(value.userType() == m_type || isScaled() || value.userType() == QMetaType::QString);
 
-        for (int i = 0; i < (range.endBit - range.startBit) + 1; ++i)
+    if (m_multiplexed && !m_muxRanges.isEmpty())
+    {
+        auto muxIt = outputFrames.find(m_muxFrameID);
+
+        if (muxIt == outputFrames.end())
+        {
+            muxIt = outputFrames.insert(m_muxFrameID, QCanBusFrame(m_muxFrameID,QByteArray(8,0)));
+        }
+
+        const QByteArray muxPayload = muxIt->payload();
+        muxIt->setPayload(wordToPayload(writeMux(payloadToWord(muxPayload)), muxPayload.size()));
+    }
+
+    const quint64 raw = encodeRaw(value);
+
+    for (int i = 0; i < m_ranges.size(); ++i)
+    {
+        const FrameRange &range = m_ranges[i];
+
+        auto it = outputFrames.find(range.frameID);
+
+        if (it == outputFrames.end())
         {
-            allData.setBit(oldSize + i,data.at(range.byteID.value()*8 + range.startBit + i));
+            it = outputFrames.insert(range.frameID, QCanBusFrame(range.frameID,QByteArray(8,0)));
         }
+
+        const QByteArray payload = it->payload();
+        it->setPayload(wordToPayload(range.insert(payloadToWord(payload), raw >> m_rangeOffsets[i]), payload.size()));
+    }
+}
+
+quint64 CANObjects::CanObject::encodeRaw(const QVariant &value) const
+{
+    quint64 raw = 0;
+
+    if (value.userType() == QMetaType::QString && rawOfName(value.toString(), raw))
+    {
+        return raw;
+    }
+
+    //inverse of the decode scaling
+    if (isScaled())
+    {
+        return encodeUnscaled((value.toDouble() - m_offset) / m_factor);
     }
 
     switch (m_type) {
     case QMetaType::Type::Bool:
-        assert(allData.size() == 1);
-        retVal.setValue(allData.at(0));
+        raw = value.toBool() ? 1u : 0u;
         break;
     case QMetaType::Type::Int:
-        if (allData[32 - m_size]) //sign bit
-        {
-            allData.fill(true,0,32-m_size);
-        }
-        bitsToValue<int32_t>(allData,retVal);
+        raw = static_cast<quint32>(value.toInt());
+        break;
+    case QMetaType::Type::UInt:
+        raw = value.toUInt();
         break;
-    case  QMetaType::Type::UInt:
-        bitsToValue<uint32_t>(allData,retVal);
+    case QMetaType::Type::LongLong:
+        raw = static_cast<quint64>(value.toLongLong());
         break;
-    case QMetaType::Type::Double:
-        bitsToValue<double>(allData,retVal);
+    case QMetaType::Type::ULongLong:
+        raw = value.toULongLong();
         break;
     case QMetaType::Type::Float:
-        bitsToValue<float>(allData,retVal);
+    {
+        const float val = value.toFloat();
+        quint32 bits = 0;
+        std::memcpy(&bits, &val, sizeof(bits));
+        raw = bits;
         break;
+    }
+    case QMetaType::Type::Double:
+    {
+        const double val = value.toDouble();
+        std::memcpy(&raw, &val, sizeof(raw));
+        break;
+    }
     default:
         qDebug() << "not recognized type of CanObject";
         break;
     }
 
-    return  retVal;
+    return raw & sizeMask();
 }
 
-void CANObjects::CanObject::writeData(const QVariant &value, QHash<quint32, QCanBusFrame> &outputFrames) const
+QVariant CANObjects::CanObject::decodeRaw(quint64 raw) const
 {
-    assert(value.type() == static_cast<QVariant::Type>(m_type));
-
-    int databit = 31; //default for most types
+    if (isScaled())
+    {
+        return QVariant::fromValue(decodeDouble(raw));
+    }
 
     switch (m_type) {
     case QMetaType::Type::Bool:
-        databit = 0;
-        break;
+        return QVariant::fromValue((raw & 1u) != 0);
+    case QMetaType::Type::Int:
+        return QVariant::fromValue(static_cast<qint32>(static_cast<quint32>(signExtend(raw))));
+    case QMetaType::Type::UInt:
+        return QVariant::fromValue(static_cast<quint32>(raw));
+    case QMetaType::Type::LongLong:
+        return QVariant::fromValue(static_cast<qint64>(signExtend(raw)));
+    case QMetaType::Type::ULongLong:
+        return QVariant::fromValue(static_cast<quint64>(raw));
+    case QMetaType::Type::Float:
+    {
+        const quint32 bits = static_cast<quint32>(raw);
+        float val = 0.0f;
+        std::memcpy(&val, &bits, sizeof(val));
+        return QVariant::fromValue(val);
+    }
     case QMetaType::Type::Double:
-        databit = 63;
-        break;
+    {
+        double val = 0.0;
+        std::memcpy(&val, &raw, sizeof(val));
+        return QVariant::fromValue(val);
+    }
     default:
+        qDebug() << "not recognized type of CanObject";
         break;
     }
 
-    for (int rangeID = m_ranges.size() -1; rangeID >= 0; --rangeID)
+    return QVariant();
+}
+
+bool CANObjects::CanObject::isMultiplexor() const
+{
+    return m_multiplexor;
+}
+
+bool CANObjects::CanObject::isMultiplexed() const
+{
+    return m_multiplexed;
+}
+
+quint32 CANObjects::CanObject::getMuxValue() const
+{
+    return m_muxValue;
+}
+
+quint32 CANObjects::CanObject::getMuxFrameID() const
+{
+    return m_muxFrameID;
+}
+
+const QVector<CANObjects::FrameRange> &CANObjects::CanObject::getMuxRanges() const
+{
+    return m_muxRanges;
+}
+
+quint8 CANObjects::CanObject::getMuxRangeOffset(int rangeIndex) const
+{
+    return m_muxOffsets[rangeIndex];
+}
+
+void CANObjects::CanObject::setMultiplexor(bool multiplexor)
+{
+    m_multiplexor = multiplexor;
+}
+
+void CANObjects::CanObject::setMuxValue(quint32 muxValue)
+{
+    m_multiplexed = true;
+    m_muxValue = muxValue;
+}
+
+void CANObjects::CanObject::linkMultiplexor(const CanObject &multiplexor)
+{
+    const QVector<FrameRange> &ranges = multiplexor.getRanges();
+
+    m_muxFrameID = ranges.isEmpty() ? 0 : ranges.first().frameID;
+    m_muxRanges = ranges;
+    m_muxOffsets.resize(ranges.size());
+
+    for (int i = 0; i < ranges.size(); ++i)
+    {
+        m_muxOffsets[i] = multiplexor.getRangeOffset(i);
+    }
+}
+
+bool CANObjects::CanObject::muxMatches(quint64 muxFrameWord) const
+{
+    //not linked to any multiplexor, nothing to check against
+    if (!m_multiplexed || m_muxRanges.isEmpty())
     {
-        const FrameRange &range = m_ranges[rangeID];
+        return true;
+    }
 
-        auto it = outputFrames.find(range.frameID);
+    quint64 selector = 0;
 
-        if (it == outputFrames.end())
+    for (int i = 0; i < m_muxRanges.size(); ++i)
+    {
+        selector |= m_muxRanges[i].extract(muxFrameWord) << m_muxOffsets[i];
+    }
+
+    return selector == m_muxValue;
+}
+
+quint64 CANObjects::CanObject::writeMux(quint64 muxFrameWord) const
+{
+    for (int i = 0; i < m_muxRanges.size(); ++i)
+    {
+        muxFrameWord = m_muxRanges[i].insert(muxFrameWord, static_cast<quint64>(m_muxValue) >> m_muxOffsets[i]);
+    }
+
+    return muxFrameWord;
+}
+
+double CANObjects::CanObject::decodeDouble(quint64 raw) const
+{
+    return scale(decodeUnscaled(raw));
+}
+
+void CANObjects::CanObject::decodeDoubles(const quint64 *raw, double *values, int count) const
+{
+    //locals, stores to values must not reload the members
+    const double factor = m_factor;
+    const double offset = m_offset;
+
+    switch (m_type) {
+    case QMetaType::Type::Int:
+    case QMetaType::Type::LongLong:
+    {
+        const int unused = m_size > 0 && m_size < 64 ? 64 - m_size : 0;
+
+        for (int i = 0; i < count; ++i)
         {
-            QCanBusFrame frame(range.frameID,QByteArray(8,0));
-            it = outputFrames.insert(range.frameID,frame);
+            values[i] = static_cast<double>(static_cast<qint64>(raw[i] << unused) >> unused) * factor + offset;
         }
-
-        QBitArray frameData = bytesToBits(it->payload());
-        QBitArray valueData;
-
-        switch (m_type) {
-        case QMetaType::Type::Bool:
-            frameData.setBit(range.byteID.value()*8 + range.startBit,value.toBool());
-            it->setPayload(bitsToBytes(frameData));
-            return;
-        case QMetaType::Type::Int:
-            valueData = valueToBits(value.toInt());
-            break;
-        case QMetaType::Type::UInt:
-            valueData = valueToBits(value.toUInt());
-            break;
-        case QMetaType::Type::Double:
-            valueData = valueToBits(value.toDouble());
-            break;
-        case QMetaType::Type::Float:
-            valueData = valueToBits(value.toFloat());
-            break;
-        default:
-            qDebug() << "not recognized type of CanObject";
-            break;
+        break;
+    }
+    case QMetaType::Type::UInt:
+    case QMetaType::Type::ULongLong:
+        for (int i = 0; i < count; ++i)
+        {
+            values[i] = static_cast<double>(raw[i]) * factor + offset;
+        }
+        break;
+    default:
+        for (int i = 0; i < count; ++i)
+        {
+            values[i] = decodeDouble(raw[i]);
         }
-        //TODO sign bit INT
-        const uint8_t firstBit = range.byteID.value()*8 + range.startBit;
-        const uint8_t lastBit = range.byteID.value()*8 + range.endBit;
+        break;
+    }
+}
 
-        for (uint8_t outbit = lastBit +1; outbit > firstBit; --outbit, --databit)
+double CANObjects::CanObject::getFactor() const
+{
+    return m_factor;
+}
+
+double CANObjects::CanObject::getOffset() const
+{
+    return m_offset;
+}
+
+bool CANObjects::CanObject::isScaled() const
+{
+    return m_factor != 1.0 || m_offset != 0.0;
+}
+
+void CANObjects::CanObject::setScaling(double factor, double offset)
+{
+    //zero factor could not be inverted on write
+    m_factor = factor != 0.0 ? factor : 1.0;
+    m_offset = offset;
+}
+
+void CANObjects::CanObject::scaleValues(double *values, int count, double factor, double offset)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        values[i] = values[i] * factor + offset;
+    }
+}
+
+const QHash<quint64, QString> &CANObjects::CanObject::getValueNames() const
+{
+    return m_valueNames;
+}
+
+void CANObjects::CanObject::setValueNames(const QHash<quint64, QString> &names)
+{
+    m_valueNames = names;
+}
+
+QString CANObjects::CanObject::valueName(quint64 raw) const
+{
+    return m_valueNames.value(raw & sizeMask());
+}
+
+bool CANObjects::CanObject::rawOfName(const QString &name, quint64 &raw) const
+{
+    for (auto it = m_valueNames.constBegin(); it != m_valueNames.constEnd(); ++it)
+    {
+        if (it.value() == name)
         {
-            frameData.setBit(outbit-1,valueData.at(databit));
+            raw = it.key();
+            return true;
         }
+    }
+
+    return false;
+}
 
-        const QByteArray newPayload = bitsToBytes(frameData);
-        it->setPayload(newPayload);
+double CANObjects::CanObject::decodeUnscaled(quint64 raw) const
+{
+    switch (m_type) {
+    case QMetaType::Type::Bool:
+        return (raw & 1u) ? 1.0 : 0.0;
+    case QMetaType::Type::Int:
+    case QMetaType::Type::LongLong:
+        return static_cast<double>(static_cast<qint64>(signExtend(raw)));
+    case QMetaType::Type::UInt:
+    case QMetaType::Type::ULongLong:
+        return static_cast<double>(raw);
+    case QMetaType::Type::Float:
+    {
+        const quint32 bits = static_cast<quint32>(raw);
+        float val = 0.0f;
+        std::memcpy(&val, &bits, sizeof(val));
+        return static_cast<double>(val);
     }
+    case QMetaType::Type::Double:
+    {
+        double val = 0.0;
+        std::memcpy(&val, &raw, sizeof(val));
+        return val;
+    }
+    default:
+        break;
+    }
+
+    return 0.0;
 }
 
 QVariant CANObjects::CanObject::getMinVal() const
@@ -223,78 +498,137 @@ QMetaType::Type CANObjects::CanObject::getType() const
     return m_type;
 }
 
-void CANObjects::CanObject::computeSize()
+const QVector<CANObjects::FrameRange> &CANObjects::CanObject::getRanges() const
 {
-    m_size = std::accumulate(m_ranges.begin(),m_ranges.end(),static_cast<quint8>(0u),
-                             [](quint8 sum,const FrameRange &val)
-    {return sum + (val.endBit - val.startBit) + static_cast<quint8>(1u);});
+    return m_ranges;
 }
 
-QBitArray CANObjects::CanObject::bytesToBits(const QByteArray &bytes) const
+quint8 CANObjects::CanObject::getRangeOffset(int rangeIndex) const
 {
-    // Create a bit array of the appropriate size
-    QBitArray bits(bytes.count()*8);
-
-    // Convert from QByteArray to QBitArray
-    for(int i=0; i<bytes.count(); ++i) {
-        for(int b=0; b<8;b++) {
-            bits.setBit( i*8+b, bytes.at(i)&(1<<(7-b)) );
-        }
-    }
+    return m_rangeOffsets[rangeIndex];
+}
 
-    return bits;
+quint8 CANObjects::CanObject::getSize() const
+{
+    return m_size;
 }
 
-QByteArray CANObjects::CanObject::bitsToBytes(const QBitArray &bits) const
+void CANObjects::CanObject::computeSize()
 {
-    // Resulting byte array
-    QByteArray bytes(bits.size()/8,0);
+    m_size = std::accumulate(m_ranges.begin(),m_ranges.end(),static_cast<quint8>(0u),
+                             [](quint8 sum,const FrameRange &val)
+    {return sum + (val.endBit - val.startBit) + static_cast<quint8>(1u);});
+
+    //last range holds the least significant bits
+    m_rangeOffsets.resize(m_ranges.size());
+    quint8 offset = 0;
 
-    // Convert from QBitArray to QByteArray
-    for(int b=0; b<bits.count();++b) {
-        bytes[b/8] = (bytes.at(b/8) | ((bits[b]?1:0)<<(7-(b%8))));
+    for (int i = m_ranges.size() - 1; i >= 0; --i)
+    {
+        m_rangeOffsets[i] = offset;
+        offset += m_ranges[i].width();
     }
+}
 
-    return bytes;
+quint64 CANObjects::CanObject::sizeMask() const
+{
+    return m_size >= 64 ? std::numeric_limits<quint64>::max() : (Q_UINT64_C(1) << m_size) - 1;
 }
 
-template <typename T>
-void CANObjects::CanObject::bitsToValue(const QBitArray &bits, QVariant &value) const
+quint64 CANObjects::CanObject::encodeUnscaled(double value) const
 {
-    QByteArray ret = bitsToBytes(bits);
-    QDataStream str(&ret, QIODevice::ReadOnly);
+    quint64 raw = 0;
+
+    //minval and maxval are physical, a negative factor swaps their raw order
+    bool minOk = false;
+    bool maxOk = false;
+    const double rawMin = (m_minVal.toDouble(&minOk) - m_offset) / m_factor;
+    const double rawMax = (m_maxVal.toDouble(&maxOk) - m_offset) / m_factor;
+    double low = -std::numeric_limits<double>::infinity();
+    double high = std::numeric_limits<double>::infinity();
 
-    if (sizeof (T) == sizeof(double))
+    if (minOk && m_minVal.isValid())
     {
-        str.setFloatingPointPrecision(QDataStream::DoublePrecision);
+        (m_factor > 0.0 ? low : high) = rawMin;
     }
 
-    if (sizeof (T) == sizeof(float))
+    if (maxOk && m_maxVal.isValid())
     {
-        str.setFloatingPointPrecision(QDataStream::SinglePrecision);
+        (m_factor > 0.0 ? high : low) = rawMax;
     }
 
-    T tmpVal;
-    str >> tmpVal;
-    value.setValue(tmpVal);
-}
+    value = std::isnan(value) ? 0.0 : std::min(std::max(value, low), high);
 
-template<typename T>
-QBitArray CANObjects::CanObject::valueToBits(const T value) const
-{
-    QByteArray bytes;
-    QDataStream str(&bytes, QIODevice::WriteOnly);
+    //the integer cast is only defined within the range of the signal
+    const int bits = m_size > 0 && m_size < 64 ? m_size : 64;
+
+    switch (m_type) {
+    case QMetaType::Type::Bool:
+        raw = value != 0.0 ? 1u : 0u;
+        break;
+    case QMetaType::Type::Int:
+    case QMetaType::Type::LongLong:
+    {
+        const qint64 maxRaw = static_cast<qint64>((Q_UINT64_C(1) << (bits - 1)) - 1);
+        const double rounded = std::nearbyint(value);
+
+        if (rounded >= std::ldexp(1.0, bits - 1))
+        {
+            raw = static_cast<quint64>(maxRaw);
+        }
+        else if (rounded < -std::ldexp(1.0, bits - 1))
+        {
+            raw = static_cast<quint64>(-maxRaw - 1);
+        }
+        else
+        {
+            raw = static_cast<quint64>(static_cast<qint64>(rounded));
+        }
 
-    if (sizeof (T) == sizeof(double))
+        break;
+    }
+    case QMetaType::Type::UInt:
+    case QMetaType::Type::ULongLong:
     {
-        str.setFloatingPointPrecision(QDataStream::DoublePrecision);
+        const double rounded = std::nearbyint(value);
+
+        if (rounded >= std::ldexp(1.0, bits))
+        {
+            raw = std::numeric_limits<quint64>::max() >> (64 - bits);
+        }
+        else
+        {
+            raw = rounded > 0.0 ? static_cast<quint64>(rounded) : 0u;
+        }
+
+        break;
+    }
+    case QMetaType::Type::Float:
+    {
+        const float val = static_cast<float>(value);
+        quint32 bits = 0;
+        std::memcpy(&bits, &val, sizeof(bits));
+        raw = bits;
+        break;
+    }
+    case QMetaType::Type::Double:
+        std::memcpy(&raw, &value, sizeof(raw));
+        break;
+    default:
+        qDebug() << "not recognized type of CanObject";
+        break;
     }
 
-    if (sizeof (T) == sizeof(float))
+    return raw & sizeMask();
+}
+
+quint64 CANObjects::CanObject::signExtend(quint64 raw) const
+{
+    //replicate the top bit of the signal into the unused high bits
+    if (m_size > 0 && m_size < 64 && ((raw >> (m_size - 1)) & 1u))
     {
-        str.setFloatingPointPrecision(QDataStream::SinglePrecision);
+        raw |= ~sizeMask();
     }
 
-    str << value;
-    return bytesToBits(bytes);
+    return raw;
 }
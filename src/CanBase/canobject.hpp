@@ -29,7 +29,6 @@
 #include <QVariant>
 #include <QCanBusFrame>
 #include <QHash>
-#include <QBitArray>
 #include <QByteArray>
 #include <QVector>
 
@@ -48,13 +47,53 @@ public:
 
     quint32 getFilterMask() const;
 
+    bool operator == (const CanObject &other) const;
+    bool operator != (const CanObject &other) const;
+
     QVariant readData(const QHash<quint32, QCanBusFrame> &inputFrames) const;
     void writeData(const QVariant &value, QHash<quint32, QCanBusFrame> &outputFrames) const;
 
+    //raw value is the concatenation of all ranges, first range holds the most significant bits
+    //scaled signals decode to and encode from the physical value as double
+    quint64 encodeRaw(const QVariant &value) const;
+    QVariant decodeRaw(quint64 raw) const;
+    double decodeDouble(quint64 raw) const;
+    //decodeDouble of count raw values at once, loops per type without branches so they vectorize
+    void decodeDoubles(const quint64 *raw, double *values, int count) const;
+
+    //physical value = raw * factor + offset
+    double getFactor() const;
+    double getOffset() const;
+    bool isScaled() const;
+    void setScaling(double factor, double offset);
+    static void scaleValues(double *values, int count, double factor, double offset);
+
+    //names of raw values, e.g. gear positions, written back by name in encodeRaw
+    const QHash<quint64, QString> &getValueNames() const;
+    void setValueNames(const QHash<quint64, QString> &names);
+    QString valueName(quint64 raw) const;
+    bool rawOfName(const QString &name, quint64 &raw) const;
+
+    //multiplexed signal is valid only when the multiplexor of its frame holds its mux value
+    bool isMultiplexor() const;
+    bool isMultiplexed() const;
+    quint32 getMuxValue() const;
+    quint32 getMuxFrameID() const;
+    const QVector<FrameRange> &getMuxRanges() const;
+    quint8 getMuxRangeOffset(int rangeIndex) const;
+    void setMultiplexor(bool multiplexor);
+    void setMuxValue(quint32 muxValue);
+    void linkMultiplexor(const CanObject &multiplexor);
+    bool muxMatches(quint64 muxFrameWord) const;
+    quint64 writeMux(quint64 muxFrameWord) const;
+
     QVariant getMinVal() const;
     QVariant getMaxVal() const;
     QString getName() const;
     QMetaType::Type getType() const;
+    const QVector<FrameRange> &getRanges() const;
+    quint8 getRangeOffset(int rangeIndex) const;
+    quint8 getSize() const;
 
 private:
     QString m_name;
@@ -64,13 +103,29 @@ private:
 
     QVector<FrameRange> m_ranges;
     quint8 m_size = 0;
+    QVector<quint8> m_rangeOffsets;
+
+    double m_factor = 1.0;
+    double m_offset = 0.0;
+    QHash<quint64, QString> m_valueNames;
+
+    bool m_multiplexor = false;
+    bool m_multiplexed = false;
+    quint32 m_muxValue = 0;
+    quint32 m_muxFrameID = 0;
+    QVector<FrameRange> m_muxRanges;
+    QVector<quint8> m_muxOffsets;
     void computeSize();
-
-    QBitArray bytesToBits(const QByteArray &bytes) const;
-    QByteArray bitsToBytes(const QBitArray &bits) const;
-
-    template <typename T> void bitsToValue(const QBitArray &bits, QVariant &value) const;
-    template <typename T> QBitArray valueToBits(const T value) const;
+    quint64 sizeMask() const;
+    quint64 signExtend(quint64 raw) const;
+    double decodeUnscaled(quint64 raw) const;
+    quint64 encodeUnscaled(double value) const;
+
+    //one multiply-add, contracted to a single FMA where the target has one
+    inline double scale(double value) const
+    {
+        return value * m_factor + m_offset;
+    }
 };
 
 }
@@ -0,0 +1,348 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "columnarexporter.hpp"
+
+#include <QDataStream>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+void appendLittleEndian(QByteArray &out, quint64 value, int bytes)
+{
+    for (int i = 0; i < bytes; ++i)
+    {
+        out.append(static_cast<char>(value >> (8*i)));
+    }
+}
+
+void appendVarint(QByteArray &out, quint64 value)
+{
+    while (value >= 0x80)
+    {
+        out.append(static_cast<char>(value | 0x80));
+        value >>= 7;
+    }
+
+    out.append(static_cast<char>(value));
+}
+
+//width bits of every value, LSB first
+void appendPacked(QByteArray &out, const QVector<quint64> &values, quint64 reference, int width)
+{
+    quint8 current = 0;
+    int used = 0;
+
+    for (const quint64 key : values)
+    {
+        const quint64 value = key - reference;
+        int written = 0;
+
+        while (written < width)
+        {
+            const int take = std::min(width - written, 8 - used);
+            current |= static_cast<quint8>(((value >> written) & ((1u << take) - 1)) << used);
+            written += take;
+            used += take;
+
+            if (used == 8)
+            {
+                out.append(static_cast<char>(current));
+                current = 0;
+                used = 0;
+            }
+        }
+    }
+
+    if (used)
+    {
+        out.append(static_cast<char>(current));
+    }
+}
+
+double keyToDouble(quint64 key, bool isSigned)
+{
+    return isSigned ? static_cast<double>(static_cast<qint64>(key ^ (Q_UINT64_C(1) << 63)))
+                    : static_cast<double>(key);
+}
+
+}
+
+CANObjects::ColumnarExporter::ColumnarExporter(const QVector<CanObject> &objects, int chunkRows) :
+    m_chunkRows(std::max(1, chunkRows))
+{
+    m_columns.resize(objects.size());
+    m_signals.resize(objects.size());
+
+    for (int i = 0; i < objects.size(); ++i)
+    {
+        const CanObject &obj = objects[i];
+        Column &column = m_columns[i];
+
+        m_signals[i].name = obj.getName();
+        m_signals[i].type = static_cast<quint32>(obj.getType());
+        m_signals[i].size = obj.getSize();
+        m_signals[i].factor = obj.getFactor();
+        m_signals[i].offset = obj.getOffset();
+
+        switch (obj.getType())
+        {
+        case QMetaType::Type::Float:
+        case QMetaType::Type::Double:
+            column.encoding = Columnar::Encoding::Plain;
+            break;
+        case QMetaType::Type::Int:
+        case QMetaType::Type::LongLong:
+            column.encoding = Columnar::Encoding::FrameOfReference;
+            column.isSigned = true;
+            break;
+        default:
+            column.encoding = Columnar::Encoding::FrameOfReference;
+            break;
+        }
+
+        column.size = obj.getSize();
+    }
+}
+
+CANObjects::ColumnarExporter::~ColumnarExporter()
+{
+    if (m_device)
+    {
+        finish();
+    }
+}
+
+bool CANObjects::ColumnarExporter::open(const QString &path)
+{
+    m_file.setFileName(path);
+
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        return false;
+    }
+
+    return open(&m_file);
+}
+
+bool CANObjects::ColumnarExporter::open(QIODevice *device)
+{
+    m_device = device;
+    m_chunks.clear();
+    m_rows = 0;
+
+    for (Column &column : m_columns)
+    {
+        column.timestamps.clear();
+        column.timestamps.reserve(m_chunkRows);
+        column.keys.clear();
+        column.keys.reserve(m_chunkRows);
+    }
+
+    return writeBytes(QByteArray(Columnar::Magic, Columnar::MagicSize));
+}
+
+void CANObjects::ColumnarExporter::onSignal(const DecodedSignal &signal)
+{
+    if (!m_device || signal.signal < 0 || signal.signal >= m_columns.size())
+    {
+        return;
+    }
+
+    Column &column = m_columns[signal.signal];
+    quint64 key = 0;
+
+    if (column.encoding == Columnar::Encoding::Plain)
+    {
+        std::memcpy(&key, &signal.value, sizeof(key));
+    }
+    else if (column.isSigned)
+    {
+        //sign extend raw, flip sign bit so keys order like values
+        const int unused = 64 - column.size;
+        const qint64 value = unused > 0 && unused < 64 ? static_cast<qint64>(signal.raw << unused) >> unused
+                                                       : static_cast<qint64>(signal.raw);
+        key = static_cast<quint64>(value) ^ (Q_UINT64_C(1) << 63);
+    }
+    else
+    {
+        key = signal.raw;
+    }
+
+    column.timestamps.push_back(signal.timestampUs);
+    column.keys.push_back(key);
+    ++m_rows;
+
+    if (column.keys.size() >= m_chunkRows)
+    {
+        writeChunk(signal.signal);
+    }
+}
+
+void CANObjects::ColumnarExporter::flush()
+{
+    for (int i = 0; i < m_columns.size(); ++i)
+    {
+        if (!m_columns[i].keys.isEmpty())
+        {
+            writeChunk(i);
+        }
+    }
+}
+
+bool CANObjects::ColumnarExporter::finish()
+{
+    if (!m_device)
+    {
+        return false;
+    }
+
+    flush();
+
+    const quint64 footerOffset = static_cast<quint64>(m_device->pos());
+
+    m_buffer.clear();
+    QDataStream stream(&m_buffer, QIODevice::WriteOnly);
+    stream.setByteOrder(QDataStream::LittleEndian);
+
+    stream << static_cast<quint32>(m_signals.size());
+
+    for (const Columnar::SignalInfo &info : m_signals)
+    {
+        const QByteArray name = info.name.toUtf8();
+        stream << static_cast<quint16>(name.size());
+        stream.writeRawData(name.constData(), name.size());
+        stream << info.type << info.size << info.factor << info.offset;
+    }
+
+    stream << static_cast<quint32>(m_chunks.size());
+
+    for (const Columnar::ChunkInfo &chunk : m_chunks)
+    {
+        stream << chunk.signal << chunk.rows << chunk.offset << chunk.size
+               << chunk.minTimestampUs << chunk.maxTimestampUs << chunk.minValue << chunk.maxValue;
+    }
+
+    stream << footerOffset;
+    stream.writeRawData(Columnar::Magic, Columnar::MagicSize);
+
+    const bool ok = writeBytes(m_buffer);
+
+    if (m_device == &m_file)
+    {
+        m_file.close();
+    }
+
+    m_device = nullptr;
+
+    return ok;
+}
+
+const QVector<CANObjects::Columnar::ChunkInfo> &CANObjects::ColumnarExporter::chunks() const
+{
+    return m_chunks;
+}
+
+quint64 CANObjects::ColumnarExporter::rows() const
+{
+    return m_rows;
+}
+
+void CANObjects::ColumnarExporter::writeChunk(int signal)
+{
+    Column &column = m_columns[signal];
+    const int rows = column.keys.size();
+
+    Columnar::ChunkInfo info;
+    info.signal = static_cast<quint32>(signal);
+    info.rows = static_cast<quint32>(rows);
+    info.offset = static_cast<quint64>(m_device->pos());
+
+    m_buffer.clear();
+    appendLittleEndian(m_buffer, info.signal, 4);
+    appendLittleEndian(m_buffer, info.rows, 4);
+    appendLittleEndian(m_buffer, static_cast<quint8>(column.encoding), 1);
+
+    //timestamps: first value, then deltas
+    info.minTimestampUs = column.timestamps.first();
+    info.maxTimestampUs = column.timestamps.first();
+    appendLittleEndian(m_buffer, static_cast<quint64>(column.timestamps.first()), 8);
+
+    for (int i = 1; i < rows; ++i)
+    {
+        const qint64 timestamp = column.timestamps[i];
+        info.minTimestampUs = std::min(info.minTimestampUs, timestamp);
+        info.maxTimestampUs = std::max(info.maxTimestampUs, timestamp);
+        appendVarint(m_buffer, Columnar::zigzag(timestamp - column.timestamps[i - 1]));
+    }
+
+    if (column.encoding == Columnar::Encoding::Plain)
+    {
+        double value = 0.0;
+        std::memcpy(&value, &column.keys.first(), sizeof(value));
+        info.minValue = value;
+        info.maxValue = value;
+
+        for (const quint64 key : column.keys)
+        {
+            std::memcpy(&value, &key, sizeof(value));
+            info.minValue = std::min(info.minValue, value);
+            info.maxValue = std::max(info.maxValue, value);
+            appendLittleEndian(m_buffer, key, 8);
+        }
+    }
+    else
+    {
+        const auto range = std::minmax_element(column.keys.begin(), column.keys.end());
+        const quint64 reference = *range.first;
+        const quint64 spread = *range.second - reference;
+        const int width = spread ? 64 - __builtin_clzll(spread) : 0;
+
+        //physical bounds, a negative factor swaps them
+        const Columnar::SignalInfo &signalInfo = m_signals[signal];
+        const double first = keyToDouble(*range.first, column.isSigned) * signalInfo.factor + signalInfo.offset;
+        const double second = keyToDouble(*range.second, column.isSigned) * signalInfo.factor + signalInfo.offset;
+        info.minValue = std::min(first, second);
+        info.maxValue = std::max(first, second);
+
+        appendLittleEndian(m_buffer, reference, 8);
+        appendLittleEndian(m_buffer, static_cast<quint64>(width), 1);
+        appendPacked(m_buffer, column.keys, reference, width);
+    }
+
+    info.size = static_cast<quint32>(m_buffer.size());
+
+    if (writeBytes(m_buffer))
+    {
+        m_chunks.push_back(info);
+    }
+
+    column.timestamps.clear();
+    column.keys.clear();
+}
+
+bool CANObjects::ColumnarExporter::writeBytes(const QByteArray &bytes)
+{
+    return m_device && m_device->write(bytes) == bytes.size();
+}
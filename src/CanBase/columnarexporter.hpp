@@ -0,0 +1,91 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include "canbase_global.hpp"
+
+#include "columnarformat.hpp"
+#include "signaldecoder.hpp"
+
+#include <QFile>
+#include <QVector>
+
+class QIODevice;
+
+namespace CANObjects {
+
+/*
+ * Streams decoded signals into a columnar file (see columnarformat.hpp).
+ *
+ * Every signal buffers up to chunkRows samples and writes them as one chunk
+ * when the buffer is full, so memory stays at signals * chunkRows samples
+ * however long the export runs. Integer signals are stored as raw values,
+ * floating signals as decoded doubles.
+ *
+ * Sits behind a SignalDecoder, fed by live RX or by a replayed log alike.
+ */
+class CANBASESHARED_EXPORT ColumnarExporter : public SignalSink
+{
+public:
+    explicit ColumnarExporter(const QVector<CanObject> &objects, int chunkRows = 4096);
+    ~ColumnarExporter() override;
+
+    bool open(const QString &path);
+    //device must be open for writing and outlive the exporter
+    bool open(QIODevice *device);
+
+    void onSignal(const DecodedSignal &signal) override;
+
+    //writes all partially filled chunks
+    void flush();
+    //flushes and writes the footer, the file is complete afterwards
+    bool finish();
+
+    const QVector<Columnar::ChunkInfo> &chunks() const;
+    quint64 rows() const;
+
+private:
+    struct Column
+    {
+        Columnar::Encoding encoding = Columnar::Encoding::Plain;
+        bool isSigned = false;
+        quint8 size = 64;
+        QVector<qint64> timestamps;
+        QVector<quint64> keys;      //frame of reference keys or double bits
+    };
+
+    QVector<Columnar::SignalInfo> m_signals;
+    QVector<Column> m_columns;
+    QVector<Columnar::ChunkInfo> m_chunks;
+    int m_chunkRows = 4096;
+    quint64 m_rows = 0;
+
+    QFile m_file;
+    QIODevice *m_device = nullptr;
+    QByteArray m_buffer;
+
+    void writeChunk(int signal);
+    bool writeBytes(const QByteArray &bytes);
+};
+
+}
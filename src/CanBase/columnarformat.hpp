@@ -0,0 +1,94 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include "canbase_global.hpp"
+
+#include <QString>
+
+namespace CANObjects {
+namespace Columnar {
+
+/*
+ * Column oriented file of decoded signals, little endian.
+ *
+ *   Magic
+ *   chunks
+ *   footer
+ *   footer offset (u64), Magic
+ *
+ * Chunk: signal (u32), rows (u32), value encoding (u8), timestamps, values.
+ *   timestamps: first (i64), then rows-1 zigzag varint deltas
+ *   Plain: rows doubles
+ *   FrameOfReference: reference key (u64), bit width (u8), rows offsets from
+ *   the reference packed LSB first. Signed values are stored as keys with the
+ *   sign bit flipped, so keys sort like the values. Keys are raw values, the
+ *   reader applies factor and offset of the signal.
+ *
+ * Footer: signal count (u32) and per signal name length (u16), UTF-8 name,
+ * type (u32), size (u8), factor (f64), offset (f64), then chunk count (u32)
+ * and a ChunkInfo per chunk. Chunk min/max values are physical.
+ */
+
+constexpr char Magic[] = "CANCOL02";
+constexpr int MagicSize = 8;
+
+enum class Encoding : quint8
+{
+    Plain = 0,
+    FrameOfReference = 1
+};
+
+struct CANBASESHARED_EXPORT ChunkInfo
+{
+    quint32 signal = 0;
+    quint32 rows = 0;
+    quint64 offset = 0;
+    quint32 size = 0;
+    qint64 minTimestampUs = 0;
+    qint64 maxTimestampUs = 0;
+    double minValue = 0.0;
+    double maxValue = 0.0;
+};
+
+struct CANBASESHARED_EXPORT SignalInfo
+{
+    QString name;
+    quint32 type = 0;
+    quint8 size = 0;
+    double factor = 1.0;
+    double offset = 0.0;
+};
+
+inline quint64 zigzag(const qint64 value)
+{
+    return (static_cast<quint64>(value) << 1) ^ static_cast<quint64>(value >> 63);
+}
+
+inline qint64 unzigzag(const quint64 value)
+{
+    return static_cast<qint64>(value >> 1) ^ -static_cast<qint64>(value & 1);
+}
+
+}
+}
@@ -0,0 +1,291 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "columnarreader.hpp"
+
+#include "canobject.hpp"
+
+#include <QDataStream>
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+class ByteReader
+{
+public:
+    explicit ByteReader(const QByteArray &bytes) :
+        m_data(reinterpret_cast<const quint8*>(bytes.constData()))
+      , m_size(bytes.size())
+    {
+
+    }
+
+    bool ok() const
+    {
+        return m_ok;
+    }
+
+    quint64 littleEndian(int bytes)
+    {
+        quint64 value = 0;
+
+        for (int i = 0; i < bytes; ++i)
+        {
+            value |= static_cast<quint64>(next()) << (8*i);
+        }
+
+        return value;
+    }
+
+    quint64 varint()
+    {
+        quint64 value = 0;
+
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            const quint8 byte = next();
+            value |= static_cast<quint64>(byte & 0x7f) << shift;
+
+            if (!(byte & 0x80))
+            {
+                break;
+            }
+        }
+
+        return value;
+    }
+
+    quint64 packed(int width)
+    {
+        quint64 value = 0;
+        int read = 0;
+
+        while (read < width)
+        {
+            if (m_bit == 0)
+            {
+                m_current = next();
+            }
+
+            const int take = std::min(width - read, 8 - m_bit);
+            value |= static_cast<quint64>((m_current >> m_bit) & ((1u << take) - 1)) << read;
+            read += take;
+            m_bit = (m_bit + take) & 7;
+        }
+
+        return value;
+    }
+
+private:
+    const quint8 *m_data = nullptr;
+    int m_size = 0;
+    int m_pos = 0;
+    bool m_ok = true;
+
+    quint8 m_current = 0;
+    int m_bit = 0;
+
+    quint8 next()
+    {
+        if (m_pos >= m_size)
+        {
+            m_ok = false;
+            return 0;
+        }
+
+        return m_data[m_pos++];
+    }
+};
+
+}
+
+bool CANObjects::ColumnarReader::open(const QString &path)
+{
+    m_file.setFileName(path);
+
+    if (!m_file.open(QIODevice::ReadOnly))
+    {
+        return false;
+    }
+
+    return open(&m_file);
+}
+
+bool CANObjects::ColumnarReader::open(QIODevice *device)
+{
+    m_device = device;
+    m_signals.clear();
+    m_chunks.clear();
+
+    const qint64 tailSize = 8 + Columnar::MagicSize;
+
+    if (!m_device->seek(0) || m_device->read(Columnar::MagicSize) != QByteArray(Columnar::Magic, Columnar::MagicSize) ||
+        m_device->size() < Columnar::MagicSize + tailSize || !m_device->seek(m_device->size() - tailSize))
+    {
+        return false;
+    }
+
+    const QByteArray tail = m_device->read(tailSize);
+
+    if (tail.mid(8) != QByteArray(Columnar::Magic, Columnar::MagicSize))
+    {
+        return false;
+    }
+
+    ByteReader tailReader(tail);
+    const qint64 footerOffset = static_cast<qint64>(tailReader.littleEndian(8));
+
+    if (!m_device->seek(footerOffset))
+    {
+        return false;
+    }
+
+    QDataStream stream(m_device);
+    stream.setByteOrder(QDataStream::LittleEndian);
+
+    quint32 signalCount = 0;
+    stream >> signalCount;
+
+    for (quint32 i = 0; i < signalCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        Columnar::SignalInfo info;
+        quint16 nameSize = 0;
+        stream >> nameSize;
+
+        QByteArray name(nameSize, 0);
+        stream.readRawData(name.data(), nameSize);
+        info.name = QString::fromUtf8(name);
+
+        stream >> info.type >> info.size >> info.factor >> info.offset;
+        m_signals.push_back(info);
+    }
+
+    quint32 chunkCount = 0;
+    stream >> chunkCount;
+
+    for (quint32 i = 0; i < chunkCount && stream.status() == QDataStream::Ok; ++i)
+    {
+        Columnar::ChunkInfo chunk;
+        stream >> chunk.signal >> chunk.rows >> chunk.offset >> chunk.size
+               >> chunk.minTimestampUs >> chunk.maxTimestampUs >> chunk.minValue >> chunk.maxValue;
+        m_chunks.push_back(chunk);
+    }
+
+    return stream.status() == QDataStream::Ok;
+}
+
+const QVector<CANObjects::Columnar::SignalInfo> &CANObjects::ColumnarReader::signalInfos() const
+{
+    return m_signals;
+}
+
+const QVector<CANObjects::Columnar::ChunkInfo> &CANObjects::ColumnarReader::chunks() const
+{
+    return m_chunks;
+}
+
+int CANObjects::ColumnarReader::indexOf(const QString &name) const
+{
+    for (int i = 0; i < m_signals.size(); ++i)
+    {
+        if (m_signals[i].name == name)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+bool CANObjects::ColumnarReader::readChunk(int chunk, QVector<qint64> &timestampsUs, QVector<double> &values) const
+{
+    if (!m_device || chunk < 0 || chunk >= m_chunks.size())
+    {
+        return false;
+    }
+
+    const Columnar::ChunkInfo &info = m_chunks[chunk];
+
+    if (!m_device->seek(static_cast<qint64>(info.offset)))
+    {
+        return false;
+    }
+
+    ByteReader reader(m_device->read(info.size));
+
+    const quint32 signal = static_cast<quint32>(reader.littleEndian(4));
+    const int rows = static_cast<int>(reader.littleEndian(4));
+    const Columnar::Encoding encoding = static_cast<Columnar::Encoding>(reader.littleEndian(1));
+
+    if (signal != info.signal || static_cast<quint32>(rows) != info.rows)
+    {
+        return false;
+    }
+
+    timestampsUs.resize(rows);
+    values.resize(rows);
+
+    qint64 timestamp = static_cast<qint64>(reader.littleEndian(8));
+
+    for (int i = 0; i < rows; ++i)
+    {
+        if (i > 0)
+        {
+            timestamp += Columnar::unzigzag(reader.varint());
+        }
+
+        timestampsUs[i] = timestamp;
+    }
+
+    if (encoding == Columnar::Encoding::Plain)
+    {
+        for (int i = 0; i < rows; ++i)
+        {
+            const quint64 bits = reader.littleEndian(8);
+            std::memcpy(&values[i], &bits, sizeof(bits));
+        }
+    }
+    else
+    {
+        const quint64 reference = reader.littleEndian(8);
+        const int width = static_cast<int>(reader.littleEndian(1));
+        const Columnar::SignalInfo signalInfo = m_signals.value(static_cast<int>(signal));
+        const bool isSigned = signalInfo.type == QMetaType::Type::Int || signalInfo.type == QMetaType::Type::LongLong;
+
+        for (int i = 0; i < rows; ++i)
+        {
+            const quint64 key = reference + reader.packed(width);
+            values[i] = isSigned ? static_cast<double>(static_cast<qint64>(key ^ (Q_UINT64_C(1) << 63)))
+                                 : static_cast<double>(key);
+        }
+
+        //whole column at once, after unpacking
+        if (signalInfo.factor != 1.0 || signalInfo.offset != 0.0)
+        {
+            CanObject::scaleValues(values.data(), rows, signalInfo.factor, signalInfo.offset);
+        }
+    }
+
+    return reader.ok();
+}
@@ -0,0 +1,58 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include "canbase_global.hpp"
+
+#include "columnarformat.hpp"
+
+#include <QFile>
+#include <QVector>
+
+class QIODevice;
+
+namespace CANObjects {
+
+//reads files written by ColumnarExporter, chunk by chunk
+class CANBASESHARED_EXPORT ColumnarReader
+{
+public:
+    bool open(const QString &path);
+    //device must be open for reading and outlive the reader
+    bool open(QIODevice *device);
+
+    const QVector<Columnar::SignalInfo> &signalInfos() const;
+    const QVector<Columnar::ChunkInfo> &chunks() const;
+    int indexOf(const QString &name) const;
+
+    bool readChunk(int chunk, QVector<qint64> &timestampsUs, QVector<double> &values) const;
+
+private:
+    QFile m_file;
+    QIODevice *m_device = nullptr;
+
+    QVector<Columnar::SignalInfo> m_signals;
+    QVector<Columnar::ChunkInfo> m_chunks;
+};
+
+}
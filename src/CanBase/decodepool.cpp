@@ -0,0 +1,141 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "decodepool.hpp"
+
+#include <algorithm>
+
+CANObjects::DecodePool::DecodePool(int threads)
+{
+    if (threads < 0)
+    {
+        threads = std::max(0, static_cast<int>(std::thread::hardware_concurrency()) - 1);
+    }
+
+    m_ranges.reset(new Range[static_cast<size_t>(threads + 1)]);
+
+    for (int i = 0; i < threads; ++i)
+    {
+        m_threads.emplace_back(&DecodePool::worker, this, i + 1);
+    }
+}
+
+CANObjects::DecodePool::~DecodePool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stop = true;
+    }
+
+    m_start.notify_all();
+
+    for (std::thread &thread : m_threads)
+    {
+        thread.join();
+    }
+}
+
+int CANObjects::DecodePool::threadCount() const
+{
+    return static_cast<int>(m_threads.size()) + 1;
+}
+
+void CANObjects::DecodePool::run(int tasks, const std::function<void(int)> &task)
+{
+    const int threads = threadCount();
+    const int perThread = tasks / threads;
+    const int rest = tasks % threads;
+    int begin = 0;
+
+    for (int i = 0; i < threads; ++i)
+    {
+        const int end = begin + perThread + (i < rest ? 1 : 0);
+        m_ranges[i].next.store(begin, std::memory_order_relaxed);
+        m_ranges[i].end = end;
+        begin = end;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_task = &task;
+        m_busy = threads - 1;
+        ++m_generation;
+    }
+
+    if (threads > 1)
+    {
+        m_start.notify_all();
+    }
+
+    work(0);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this]() { return m_busy == 0; });
+    m_task = nullptr;
+}
+
+void CANObjects::DecodePool::worker(int self)
+{
+    quint64 generation = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_start.wait(lock, [this, generation]() { return m_stop || m_generation != generation; });
+
+            if (m_stop)
+            {
+                return;
+            }
+
+            generation = m_generation;
+        }
+
+        work(self);
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_busy;
+        }
+
+        m_done.notify_one();
+    }
+}
+
+void CANObjects::DecodePool::work(int self)
+{
+    const int threads = threadCount();
+    const std::function<void(int)> &task = *m_task;
+
+    //own range first, then steal from the others
+    for (int i = 0; i < threads; ++i)
+    {
+        Range &range = m_ranges[(self + i) % threads];
+
+        for (int index = range.next.fetch_add(1, std::memory_order_relaxed); index < range.end;
+             index = range.next.fetch_add(1, std::memory_order_relaxed))
+        {
+            task(index);
+        }
+    }
+}
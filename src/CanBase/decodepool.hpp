@@ -0,0 +1,82 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include "canbase_global.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace CANObjects {
+
+/*
+ * Small work stealing pool for batch decoding.
+ *
+ * run() splits the tasks into one contiguous range per thread, the calling
+ * thread takes part as well. A thread done with its own range takes tasks
+ * from the ranges of the others, so uneven chunks do not leave cores idle.
+ * Threads sleep between batches.
+ */
+class CANBASESHARED_EXPORT DecodePool
+{
+public:
+    //worker threads besides the caller, -1 uses all cores
+    explicit DecodePool(int threads = -1);
+    ~DecodePool();
+
+    DecodePool(const DecodePool&) = delete;
+    DecodePool &operator=(const DecodePool&) = delete;
+
+    int threadCount() const;
+
+    //calls task(i) for every i in [0, tasks) and returns when all are done
+    void run(int tasks, const std::function<void(int)> &task);
+
+private:
+    struct alignas(64) Range
+    {
+        std::atomic<int> next{0};
+        int end = 0;
+    };
+
+    std::vector<std::thread> m_threads;
+    std::unique_ptr<Range[]> m_ranges;
+
+    std::mutex m_mutex;
+    std::condition_variable m_start;
+    std::condition_variable m_done;
+    quint64 m_generation = 0;
+    int m_busy = 0;
+    bool m_stop = false;
+    const std::function<void(int)> *m_task = nullptr;
+
+    void worker(int self);
+    void work(int self);
+};
+
+}
@@ -0,0 +1,216 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "e2eprotection.hpp"
+
+CANObjects::Crc8::Crc8(quint8 polynomial)
+{
+    for (int byte = 0; byte < 256; ++byte)
+    {
+        quint8 crc = static_cast<quint8>(byte);
+
+        for (int bit = 0; bit < 8; ++bit)
+        {
+            crc = static_cast<quint8>(crc & 0x80 ? (crc << 1) ^ polynomial : crc << 1);
+        }
+
+        m_table[static_cast<size_t>(byte)] = crc;
+    }
+}
+
+quint8 CANObjects::Crc8::compute(const quint8 *data, int size, quint8 init) const
+{
+    quint8 crc = init;
+
+    for (int i = 0; i < size; ++i)
+    {
+        crc = update(crc, data[i]);
+    }
+
+    return crc;
+}
+
+CANObjects::E2EProfile::E2EProfile(const QVariantMap &map)
+{
+    frameID = map["frameid"].toUInt();
+    crcByte = static_cast<quint8>(map["crc"].toMap()["byteid"].toUInt());
+
+    QVariantMap counterMap = map["counter"].toMap();
+    counterMap["frameid"] = frameID;
+    counter = FrameRange(counterMap);
+
+    dataID = static_cast<quint16>(map.value("dataid", frameID).toUInt());
+    length = static_cast<quint8>(map.value("length", 8).toUInt());
+    maxDeltaCounter = static_cast<quint8>(map.value("maxdelta", 1).toUInt());
+    polynomial = static_cast<quint8>(map.value("polynomial", 0x1D).toUInt());
+    init = static_cast<quint8>(map.value("init", 0xFF).toUInt());
+    xorOut = static_cast<quint8>(map.value("xorout", 0xFF).toUInt());
+}
+
+bool CANObjects::E2EProfile::operator==(const E2EProfile &other) const
+{
+    return frameID == other.frameID && crcByte == other.crcByte && counter == other.counter &&
+            dataID == other.dataID && length == other.length && maxDeltaCounter == other.maxDeltaCounter &&
+            polynomial == other.polynomial && init == other.init && xorOut == other.xorOut;
+}
+
+bool CANObjects::E2EProfile::operator!=(const E2EProfile &other) const
+{
+    return !(*this == other);
+}
+
+CANObjects::E2EProtection::E2EProtection(const QVector<E2EProfile> &profiles) :
+    m_profiles(profiles)
+{
+    m_states.reserve(profiles.size());
+
+    for (const E2EProfile &profile : profiles)
+    {
+        State state;
+        state.profile = profile;
+        state.crc = Crc8(profile.polynomial);
+        state.counterMask = profile.counter.mask() >> profile.counter.shift();
+
+        m_stateIndex.insert(profile.frameID, m_states.size());
+        m_states.push_back(state);
+    }
+}
+
+bool CANObjects::E2EProtection::isProtected(quint32 frameID) const
+{
+    return m_stateIndex.contains(frameID);
+}
+
+bool CANObjects::E2EProtection::protect(quint32 frameID, quint64 &payload)
+{
+    auto it = m_stateIndex.constFind(frameID);
+
+    if (it == m_stateIndex.constEnd())
+    {
+        return false;
+    }
+
+    State &state = m_states[it.value()];
+
+    payload = state.profile.counter.insert(payload, state.nextCounter);
+    state.nextCounter = (state.nextCounter + 1) & state.counterMask;
+
+    const quint8 shift = static_cast<quint8>(56 - 8*state.profile.crcByte);
+    payload = (payload & ~(Q_UINT64_C(0xFF) << shift)) | static_cast<quint64>(crcOf(state, payload)) << shift;
+
+    return true;
+}
+
+void CANObjects::E2EProtection::protect(QCanBusFrame &frame)
+{
+    const QByteArray data = frame.payload();
+    quint64 payload = payloadToWord(data);
+
+    if (protect(frame.frameId(), payload))
+    {
+        frame.setPayload(wordToPayload(payload, data.size()));
+    }
+}
+
+CANObjects::E2EProtection::Status CANObjects::E2EProtection::check(quint32 frameID, quint64 payload)
+{
+    auto it = m_stateIndex.constFind(frameID);
+
+    if (it == m_stateIndex.constEnd())
+    {
+        return Status::Unprotected;
+    }
+
+    State &state = m_states[it.value()];
+
+    const quint8 received = static_cast<quint8>(payload >> (56 - 8*state.profile.crcByte));
+
+    if (received != crcOf(state, payload))
+    {
+        ++state.counters.crcErrors;
+        return Status::CrcError;
+    }
+
+    const quint64 counter = state.profile.counter.extract(payload);
+    const bool first = !state.received;
+    const quint64 delta = (counter - state.lastCounter) & state.counterMask;
+
+    state.lastCounter = counter;
+    state.received = true;
+
+    if (first)
+    {
+        ++state.counters.ok;
+        return Status::Initial;
+    }
+
+    if (delta == 0)
+    {
+        ++state.counters.repeated;
+        return Status::Repeated;
+    }
+
+    if (delta > state.profile.maxDeltaCounter)
+    {
+        ++state.counters.sequenceErrors;
+        return Status::WrongSequence;
+    }
+
+    ++state.counters.ok;
+    return Status::Ok;
+}
+
+bool CANObjects::E2EProtection::isCorrupted(Status status)
+{
+    //a sequence error means lost frames, the data itself is valid
+    return status == Status::CrcError || status == Status::Repeated;
+}
+
+CANObjects::E2ECounters CANObjects::E2EProtection::counters(quint32 frameID) const
+{
+    auto it = m_stateIndex.constFind(frameID);
+
+    return it == m_stateIndex.constEnd() ? E2ECounters() : m_states[it.value()].counters;
+}
+
+const QVector<CANObjects::E2EProfile> &CANObjects::E2EProtection::profiles() const
+{
+    return m_profiles;
+}
+
+quint8 CANObjects::E2EProtection::crcOf(const State &state, quint64 payload)
+{
+    const E2EProfile &profile = state.profile;
+
+    quint8 crc = state.crc.update(profile.init, static_cast<quint8>(profile.dataID));
+    crc = state.crc.update(crc, static_cast<quint8>(profile.dataID >> 8));
+
+    for (int i = 0; i < profile.length && i < 8; ++i)
+    {
+        if (i != profile.crcByte)
+        {
+            crc = state.crc.update(crc, static_cast<quint8>(payload >> (56 - 8*i)));
+        }
+    }
+
+    return static_cast<quint8>(crc ^ profile.xorOut);
+}
@@ -0,0 +1,147 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include "canbase_global.hpp"
+
+#include "framerange.hpp"
+
+#include <QCanBusFrame>
+#include <QHash>
+#include <QVariantMap>
+#include <QVector>
+
+#include <array>
+
+namespace CANObjects {
+
+//table driven CRC8, one lookup per byte
+class CANBASESHARED_EXPORT Crc8
+{
+public:
+    explicit Crc8(quint8 polynomial = 0x1D);
+
+    inline quint8 update(const quint8 crc, const quint8 byte) const
+    {
+        return m_table[crc ^ byte];
+    }
+
+    quint8 compute(const quint8 *data, int size, quint8 init) const;
+
+private:
+    std::array<quint8, 256> m_table;
+};
+
+/*
+ * E2E profile of one frame: CRC8 byte and alive counter.
+ *
+ * The CRC covers the data ID (low byte first) and the first length payload
+ * bytes except the CRC byte. Defaults are CRC8 SAE J1850.
+ *
+ *   "e2e": [{"frameid": 544, "crc": {"byteid": 0},
+ *            "counter": {"byteid": 1, "startbit": 4, "endbit": 7},
+ *            "dataid": 544, "length": 8, "maxdelta": 1}]
+ */
+struct CANBASESHARED_EXPORT E2EProfile
+{
+    quint32 frameID = 0;
+    quint8 crcByte = 0;
+    FrameRange counter;
+    quint16 dataID = 0;
+    quint8 length = 8;
+    quint8 maxDeltaCounter = 1;
+    quint8 polynomial = 0x1D;
+    quint8 init = 0xFF;
+    quint8 xorOut = 0xFF;
+
+    E2EProfile(){}
+    explicit E2EProfile(const QVariantMap &map);
+
+    bool operator==(const E2EProfile &other) const;
+    bool operator!=(const E2EProfile &other) const;
+};
+
+struct CANBASESHARED_EXPORT E2ECounters
+{
+    quint64 ok = 0;
+    quint64 crcErrors = 0;
+    quint64 repeated = 0;           //same counter again, stale sender
+    quint64 sequenceErrors = 0;     //counter jumped by more than maxdelta, frames lost
+};
+
+/*
+ * Fills and checks E2E protected frames.
+ *
+ * protect() increments the alive counter of the frame and writes the counter
+ * and the CRC. check() validates a received payload and counts errors per
+ * frame ID. Both work on the big endian payload word and do not allocate.
+ */
+class CANBASESHARED_EXPORT E2EProtection
+{
+public:
+    enum class Status
+    {
+        Unprotected,
+        Ok,
+        Initial,            //first frame, counter not checked
+        CrcError,
+        Repeated,
+        WrongSequence
+    };
+
+    E2EProtection(){}
+    explicit E2EProtection(const QVector<E2EProfile> &profiles);
+
+    bool isProtected(quint32 frameID) const;
+
+    bool protect(quint32 frameID, quint64 &payload);
+    void protect(QCanBusFrame &frame);
+
+    Status check(quint32 frameID, quint64 payload);
+
+    //data must not be used
+    static bool isCorrupted(Status status);
+
+    E2ECounters counters(quint32 frameID) const;
+    const QVector<E2EProfile> &profiles() const;
+
+private:
+    struct State
+    {
+        E2EProfile profile;
+        Crc8 crc;
+        quint64 counterMask = 0;
+        quint64 nextCounter = 0;
+        quint64 lastCounter = 0;
+        bool received = false;
+        E2ECounters counters;
+    };
+
+    QVector<E2EProfile> m_profiles;
+    QVector<State> m_states;
+    QHash<quint32, int> m_stateIndex;
+
+    static quint8 crcOf(const State &state, quint64 payload);
+};
+
+}
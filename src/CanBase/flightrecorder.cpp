@@ -0,0 +1,399 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "flightrecorder.hpp"
+
+#include "framerange.hpp"
+#include "framesnapshottable.hpp"
+#include "framesupervisor.hpp"
+
+#include <QDataStream>
+#include <QFile>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <limits>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+bool CANObjects::FlightRecord::operator==(const FlightRecord &other) const
+{
+    return timestampUs == other.timestampUs && frameID == other.frameID && size == other.size &&
+            flags == other.flags && payload == other.payload;
+}
+
+bool CANObjects::FlightLog::write(QIODevice *device, const QVector<FlightRecord> &records, qint64 triggerUs)
+{
+    QDataStream stream(device);
+    stream.setByteOrder(QDataStream::LittleEndian);
+
+    stream.writeRawData(Magic, MagicSize);
+    stream << Version << triggerUs << static_cast<quint32>(records.size());
+
+    for (const FlightRecord &record : records)
+    {
+        stream << record.timestampUs << record.frameID << record.size << record.flags << record.payload;
+    }
+
+    return stream.status() == QDataStream::Ok;
+}
+
+bool CANObjects::FlightLog::read(QIODevice *device, QVector<FlightRecord> &records, qint64 *triggerUs)
+{
+    QDataStream stream(device);
+    stream.setByteOrder(QDataStream::LittleEndian);
+
+    char magic[MagicSize];
+    quint32 version = 0;
+    qint64 trigger = 0;
+    quint32 count = 0;
+
+    if (stream.readRawData(magic, MagicSize) != MagicSize || std::memcmp(magic, Magic, MagicSize) != 0)
+    {
+        return false;
+    }
+
+    stream >> version >> trigger >> count;
+
+    if (version != Version || stream.status() != QDataStream::Ok)
+    {
+        return false;
+    }
+
+    records.clear();
+
+    //count comes from the file, a truncated or corrupt dump must not reserve more than it holds
+    records.reserve(static_cast<int>(std::min<qint64>(count, device->bytesAvailable() / RecordSize)));
+
+    for (quint32 i = 0; i < count; ++i)
+    {
+        FlightRecord record;
+        stream >> record.timestampUs >> record.frameID >> record.size >> record.flags >> record.payload;
+
+        if (stream.status() != QDataStream::Ok)
+        {
+            break;
+        }
+
+        records.push_back(record);
+    }
+
+    if (triggerUs)
+    {
+        *triggerUs = trigger;
+    }
+
+    return stream.status() == QDataStream::Ok;
+}
+
+CANObjects::FlightRecorder::FlightRecorder(int capacity)
+{
+    m_capacity = 1;
+
+    while (m_capacity < static_cast<quint64>(std::max(capacity, 1)))
+    {
+        m_capacity <<= 1;
+    }
+
+    m_mask = m_capacity - 1;
+
+    //out of memory like a failed new
+    if (!map(-1))
+    {
+        throw std::bad_alloc();
+    }
+}
+
+CANObjects::FlightRecorder::~FlightRecorder()
+{
+    if (m_worker.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+
+        m_wakeup.notify_all();
+        m_worker.join();
+    }
+
+    unmap();
+}
+
+bool CANObjects::FlightRecorder::open(const QString &path)
+{
+    const int fd = ::open(QFile::encodeName(path).constData(), O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+
+    if (fd < 0)
+    {
+        m_errorString = QStringLiteral("could not open %1: %2").arg(path, QString::fromLocal8Bit(strerror(errno)));
+        return false;
+    }
+
+    unmap();
+    const bool ok = map(fd);
+    ::close(fd);
+
+    if (!ok)
+    {
+        map(-1);
+    }
+
+    return ok;
+}
+
+void CANObjects::FlightRecorder::close()
+{
+    if (m_fileBacked)
+    {
+        unmap();
+        map(-1);
+    }
+}
+
+bool CANObjects::FlightRecorder::isFileBacked() const
+{
+    return m_fileBacked;
+}
+
+QString CANObjects::FlightRecorder::errorString() const
+{
+    return m_errorString;
+}
+
+int CANObjects::FlightRecorder::capacity() const
+{
+    return static_cast<int>(m_capacity);
+}
+
+quint64 CANObjects::FlightRecorder::recorded() const
+{
+    return m_header->head.load(std::memory_order_acquire);
+}
+
+qint64 CANObjects::FlightRecorder::newestRecordUs() const
+{
+    const quint64 head = m_header->head.load(std::memory_order_acquire);
+
+    return head ? m_slots[(head - 1) & m_mask].timestampUs.load(std::memory_order_relaxed) : std::numeric_limits<qint64>::min();
+}
+
+void CANObjects::FlightRecorder::record(const QCanBusFrame &frame)
+{
+    const QByteArray payload = frame.payload();
+
+    quint8 flags = 0;
+    flags |= frame.hasExtendedFrameFormat() ? FlightRecord::Extended : 0;
+    flags |= frame.frameType() == QCanBusFrame::ErrorFrame ? FlightRecord::Error : 0;
+    flags |= frame.frameType() == QCanBusFrame::RemoteRequestFrame ? FlightRecord::Remote : 0;
+
+    record(frame.frameId(), payloadToWord(payload), static_cast<quint8>(payload.size()), flags,
+           FrameSnapshotTable::timestampUs(frame));
+}
+
+void CANObjects::FlightRecorder::snapshot(qint64 fromUs, qint64 toUs, QVector<FlightRecord> &records) const
+{
+    records.clear();
+
+    const quint64 head = m_header->head.load(std::memory_order_acquire);
+    const quint64 first = head > m_capacity ? head - m_capacity : 0;
+
+    QVector<FlightRecord> copied;
+    copied.reserve(static_cast<int>(head - first));
+
+    for (quint64 i = first; i < head; ++i)
+    {
+        const Slot &slot = m_slots[i & m_mask];
+        const quint64 info = slot.info.load(std::memory_order_relaxed);
+
+        FlightRecord record;
+        record.timestampUs = slot.timestampUs.load(std::memory_order_relaxed);
+        record.frameID = static_cast<quint32>(info);
+        record.size = static_cast<quint8>(info >> 32);
+        record.flags = static_cast<quint8>(info >> 40);
+        record.payload = slot.payload.load(std::memory_order_relaxed);
+        copied.push_back(record);
+    }
+
+    //records the writer overwrote while copying are dropped
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const quint64 headAfter = m_header->head.load(std::memory_order_relaxed);
+    const quint64 firstValid = headAfter >= m_capacity ? headAfter - m_capacity + 1 : 0;
+
+    for (quint64 i = std::max(first, firstValid); i < head; ++i)
+    {
+        const FlightRecord &record = copied[static_cast<int>(i - first)];
+
+        if (record.timestampUs >= fromUs && record.timestampUs <= toUs)
+        {
+            records.push_back(record);
+        }
+    }
+}
+
+void CANObjects::FlightRecorder::trigger(qint64 timestampUs, qint64 preUs, qint64 postUs, const QString &path)
+{
+    Dump dump;
+    dump.triggerUs = timestampUs;
+    dump.fromUs = timestampUs - preUs;
+    dump.toUs = timestampUs + postUs;
+    dump.deadlineUs = FrameSupervisor::nowUs() + postUs;
+    dump.path = path;
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_dumps.push_back(dump);
+
+        if (!m_worker.joinable())
+        {
+            m_worker = std::thread(&FlightRecorder::run, this);
+        }
+    }
+
+    m_wakeup.notify_all();
+}
+
+bool CANObjects::FlightRecorder::waitForDumps(int timeoutMs)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    return m_idle.wait_for(lock, std::chrono::milliseconds(timeoutMs), [this] { return m_dumps.isEmpty() && !m_writing; });
+}
+
+int CANObjects::FlightRecorder::dumpsWritten() const
+{
+    return m_dumpsWritten.load();
+}
+
+bool CANObjects::FlightRecorder::map(int fd)
+{
+    const size_t size = sizeof(RingHeader) + sizeof(Slot) * m_capacity;
+    bool keep = false;
+
+    if (fd >= 0)
+    {
+        struct stat info;
+        keep = ::fstat(fd, &info) == 0 && static_cast<size_t>(info.st_size) == size;
+
+        if (!keep && ::ftruncate(fd, static_cast<off_t>(size)) != 0)
+        {
+            m_errorString = QStringLiteral("could not resize flight recorder file");
+            return false;
+        }
+    }
+
+    void *memory = fd >= 0 ? ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)
+                           : ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+
+    if (memory == MAP_FAILED)
+    {
+        m_errorString = QStringLiteral("could not map flight recorder");
+        return false;
+    }
+
+    RingHeader *header = static_cast<RingHeader *>(memory);
+
+    //records of an earlier run are kept when the file matches
+    keep = keep && std::memcmp(header->magic, RingMagic, sizeof(header->magic)) == 0 && header->capacity == m_capacity;
+
+    if (!keep)
+    {
+        header = new (memory) RingHeader;
+        std::memcpy(header->magic, RingMagic, sizeof(header->magic));
+        header->capacity = m_capacity;
+        header->head.store(0, std::memory_order_relaxed);
+    }
+
+    m_memory = memory;
+    m_size = size;
+    m_fileBacked = fd >= 0;
+    m_header = header;
+    m_slots = reinterpret_cast<Slot *>(static_cast<char *>(memory) + sizeof(RingHeader));
+
+    return true;
+}
+
+void CANObjects::FlightRecorder::unmap()
+{
+    if (m_memory)
+    {
+        ::munmap(m_memory, m_size);
+    }
+
+    m_memory = nullptr;
+    m_header = nullptr;
+    m_slots = nullptr;
+    m_fileBacked = false;
+}
+
+void CANObjects::FlightRecorder::run()
+{
+    QVector<FlightRecord> records;
+    std::unique_lock<std::mutex> lock(m_mutex);
+
+    while (!m_stop)
+    {
+        if (m_dumps.isEmpty())
+        {
+            m_idle.notify_all();
+            m_wakeup.wait(lock);
+            continue;
+        }
+
+        //frame time and local time are different clocks, a window is complete once a
+        //newer frame was recorded or the bus stayed silent for the post window
+        const qint64 newestUs = newestRecordUs();
+        const qint64 nowUs = FrameSupervisor::nowUs();
+        const auto due = std::find_if(m_dumps.begin(), m_dumps.end(), [newestUs, nowUs](const Dump &dump) {
+            return dump.toUs <= newestUs || dump.deadlineUs <= nowUs;
+        });
+
+        //record() never notifies, it must not block
+        if (due == m_dumps.end())
+        {
+            m_wakeup.wait_for(lock, std::chrono::milliseconds(PollIntervalMs));
+            continue;
+        }
+
+        const Dump dump = *due;
+        m_dumps.erase(due);
+        m_writing = true;
+        lock.unlock();
+
+        snapshot(dump.fromUs, dump.toUs, records);
+
+        QFile file(dump.path);
+
+        if (file.open(QIODevice::WriteOnly) && FlightLog::write(&file, records, dump.triggerUs))
+        {
+            ++m_dumpsWritten;
+        }
+
+        lock.lock();
+        m_writing = false;
+    }
+}
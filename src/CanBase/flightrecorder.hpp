@@ -0,0 +1,187 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include "canbase_global.hpp"
+
+#include <QCanBusFrame>
+#include <QIODevice>
+#include <QString>
+#include <QVector>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace CANObjects {
+
+struct CANBASESHARED_EXPORT FlightRecord
+{
+    enum Flags : quint8
+    {
+        Extended = 0x01,
+        Error = 0x02,
+        Remote = 0x04
+    };
+
+    qint64 timestampUs = 0;
+    quint32 frameID = 0;
+    quint8 size = 0;
+    quint8 flags = 0;
+    quint64 payload = 0;
+
+    bool operator==(const FlightRecord &other) const;
+};
+
+namespace FlightLog {
+
+/*
+ * Dump of a trigger window, little endian.
+ *
+ *   Magic, version (u32), trigger time (i64), record count (u32)
+ *   per record: timestamp (i64), frame ID (u32), size (u8), flags (u8), payload (u64)
+ */
+constexpr char Magic[] = "CANFLT01";
+constexpr int MagicSize = 8;
+constexpr quint32 Version = 1;
+constexpr int RecordSize = 8 + 4 + 1 + 1 + 8;
+
+CANBASESHARED_EXPORT bool write(QIODevice *device, const QVector<FlightRecord> &records, qint64 triggerUs);
+CANBASESHARED_EXPORT bool read(QIODevice *device, QVector<FlightRecord> &records, qint64 *triggerUs = nullptr);
+
+}
+
+/*
+ * Keeps the most recent frames in a fixed ring of capacity records.
+ *
+ * One thread records (RX), record() is three relaxed stores and a release of
+ * the head, it never blocks or allocates. Readers copy the ring and drop what
+ * the writer overwrote meanwhile, like the seqlocks of the shared signal
+ * segment. The oldest slot may be in rewrite at any time, so a snapshot holds
+ * at most capacity - 1 records.
+ *
+ * The ring lives in anonymous memory or, after open(), in a mapped file that
+ * survives a crash of the process: reopening a file of the same capacity
+ * keeps its records. open() and close() must not race with record().
+ *
+ * trigger() asks for a dump of [trigger - pre, trigger + post]. A worker
+ * thread waits until a frame past the post window was recorded, or until
+ * post passed on the local clock without traffic, and writes the FlightLog
+ * file. RX keeps recording all the time.
+ */
+class CANBASESHARED_EXPORT FlightRecorder
+{
+public:
+    //capacity is rounded up to a power of two
+    explicit FlightRecorder(int capacity = 65536);
+    ~FlightRecorder();
+
+    FlightRecorder(const FlightRecorder &) = delete;
+    FlightRecorder &operator=(const FlightRecorder &) = delete;
+
+    bool open(const QString &path);
+    void close();
+    bool isFileBacked() const;
+    QString errorString() const;
+
+    int capacity() const;
+    quint64 recorded() const;
+
+    inline void record(quint32 frameID, quint64 payload, quint8 size, quint8 flags, qint64 timestampUs);
+    void record(const QCanBusFrame &frame);
+
+    //records of [fromUs, toUs] still in the ring, oldest first
+    void snapshot(qint64 fromUs, qint64 toUs, QVector<FlightRecord> &records) const;
+
+    //any thread, the dump is written to path once a frame after timestampUs + postUs was recorded
+    void trigger(qint64 timestampUs, qint64 preUs, qint64 postUs, const QString &path);
+    bool waitForDumps(int timeoutMs);
+    int dumpsWritten() const;
+
+private:
+    static constexpr char RingMagic[] = "CANRING1";
+    static constexpr int PollIntervalMs = 10;
+
+    struct alignas(64) RingHeader
+    {
+        char magic[8];
+        quint64 capacity;
+        std::atomic<quint64> head;
+    };
+
+    struct Slot
+    {
+        std::atomic<qint64> timestampUs;
+        std::atomic<quint64> info;      //frame ID, size << 32, flags << 40
+        std::atomic<quint64> payload;
+    };
+
+    struct Dump
+    {
+        qint64 triggerUs = 0;
+        qint64 fromUs = 0;
+        qint64 toUs = 0;
+        qint64 deadlineUs = 0;      //FrameSupervisor::nowUs() after which a silent bus completes the window
+        QString path;
+    };
+
+    quint64 m_capacity = 0;
+    quint64 m_mask = 0;
+    void *m_memory = nullptr;
+    size_t m_size = 0;
+    bool m_fileBacked = false;
+    RingHeader *m_header = nullptr;
+    Slot *m_slots = nullptr;
+    QString m_errorString;
+
+    std::thread m_worker;
+    std::mutex m_mutex;
+    std::condition_variable m_wakeup;
+    std::condition_variable m_idle;
+    QVector<Dump> m_dumps;
+    bool m_writing = false;
+    bool m_stop = false;
+    std::atomic<int> m_dumpsWritten{0};
+
+    qint64 newestRecordUs() const;
+    bool map(int fd);
+    void unmap();
+    void run();
+};
+
+void FlightRecorder::record(quint32 frameID, quint64 payload, quint8 size, quint8 flags, qint64 timestampUs)
+{
+    const quint64 head = m_header->head.load(std::memory_order_relaxed);
+    Slot &slot = m_slots[head & m_mask];
+
+    //readers seeing the new slot content also see the head it overwrites
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.timestampUs.store(timestampUs, std::memory_order_relaxed);
+    slot.info.store(frameID | static_cast<quint64>(size) << 32 | static_cast<quint64>(flags) << 40, std::memory_order_relaxed);
+    slot.payload.store(payload, std::memory_order_relaxed);
+
+    m_header->head.store(head + 1, std::memory_order_release);
+}
+
+}
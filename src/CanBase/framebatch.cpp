@@ -0,0 +1,180 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "framebatch.hpp"
+
+#include "framesnapshottable.hpp"
+
+#include <algorithm>
+
+CANObjects::FrameBatch::FrameBatch(const FrameIndex &index, int capacity)
+{
+    m_frames.resize(std::max(capacity, 1));
+    setIndex(index);
+}
+
+void CANObjects::FrameBatch::setIndex(const FrameIndex &index)
+{
+    m_index = index;
+    m_latest.fill(-1, m_index.size());
+    m_touched.clear();
+    m_touched.reserve(m_index.size());
+    m_size = 0;
+}
+
+const CANObjects::FrameIndex &CANObjects::FrameBatch::index() const
+{
+    return m_index;
+}
+
+void CANObjects::FrameBatch::clear()
+{
+    for (const int slot : m_touched)
+    {
+        m_latest[slot] = -1;
+    }
+
+    m_touched.clear();
+    m_size = 0;
+}
+
+void CANObjects::FrameBatch::append(const QCanBusFrame &frame)
+{
+    const QByteArray payload = frame.payload();
+
+    append(frame.frameId(), payloadToWord(payload), static_cast<quint8>(payload.size()), FrameSnapshotTable::timestampUs(frame));
+}
+
+void CANObjects::FrameBatch::append(quint32 frameID, quint64 payload, quint8 size, qint64 timestampUs)
+{
+    //grows only past the largest batch seen so far
+    if (m_size == m_frames.size())
+    {
+        m_frames.resize(m_frames.size() * 2);
+    }
+
+    FrameRecord &record = m_frames[m_size];
+    record.frameID = frameID;
+    record.slot = m_index.slotOf(frameID);
+    record.payload = payload;
+    record.size = size;
+    record.timestampUs = timestampUs;
+
+    if (record.slot >= 0)
+    {
+        int &latest = m_latest[record.slot];
+
+        if (latest < 0)
+        {
+            m_touched.push_back(record.slot);
+        }
+
+        latest = m_size;
+    }
+
+    ++m_size;
+}
+
+int CANObjects::FrameBatch::size() const
+{
+    return m_size;
+}
+
+bool CANObjects::FrameBatch::isEmpty() const
+{
+    return m_size == 0;
+}
+
+int CANObjects::FrameBatch::capacity() const
+{
+    return m_frames.size();
+}
+
+const CANObjects::FrameRecord &CANObjects::FrameBatch::at(int i) const
+{
+    return m_frames[i];
+}
+
+const CANObjects::FrameRecord *CANObjects::FrameBatch::begin() const
+{
+    return m_frames.constData();
+}
+
+const CANObjects::FrameRecord *CANObjects::FrameBatch::end() const
+{
+    return m_frames.constData() + m_size;
+}
+
+bool CANObjects::FrameBatch::isLatest(int i) const
+{
+    const int slot = m_frames[i].slot;
+
+    return slot < 0 || m_latest[slot] == i;
+}
+
+const CANObjects::FrameRecord *CANObjects::FrameBatch::latestOf(quint32 frameID) const
+{
+    const int slot = m_index.slotOf(frameID);
+
+    if (slot < 0 || m_latest[slot] < 0)
+    {
+        return nullptr;
+    }
+
+    return &m_frames[m_latest[slot]];
+}
+
+QVariant CANObjects::FrameBatch::readData(const CanObject &obj) const
+{
+    const QVector<FrameRange> &ranges = obj.getRanges();
+    const FrameRecord *record = nullptr;
+    quint64 raw = 0;
+
+    if (obj.isMultiplexed() && !obj.getMuxRanges().isEmpty())
+    {
+        record = latestOf(obj.getMuxFrameID());
+
+        if (!record || !obj.muxMatches(record->payload))
+        {
+            return QVariant();
+        }
+    }
+
+    for (int i = 0; i < ranges.size(); ++i)
+    {
+        const FrameRange &range = ranges[i];
+
+        if (!record || record->frameID != range.frameID)
+        {
+            record = latestOf(range.frameID);
+
+            if (!record)
+            {
+                return QVariant();
+            }
+        }
+
+        raw |= range.extract(record->payload) << obj.getRangeOffset(i);
+    }
+
+    return obj.decodeRaw(raw);
+}
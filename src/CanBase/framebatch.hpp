@@ -0,0 +1,89 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include "canbase_global.hpp"
+
+#include "canobject.hpp"
+#include "frameindex.hpp"
+
+#include <QCanBusFrame>
+#include <QVariant>
+#include <QVector>
+
+namespace CANObjects {
+
+struct CANBASESHARED_EXPORT FrameRecord
+{
+    quint32 frameID = 0;
+    int slot = -1;              //slot in the index of the batch, -1 for unknown IDs
+    quint64 payload = 0;
+    quint8 size = 0;
+    qint64 timestampUs = 0;
+};
+
+/*
+ * Frames of one receive batch, every occurrence in arrival order.
+ *
+ * The buffer is allocated once and reused, clear() only resets counters and
+ * the last occurrence marks of IDs seen in the batch. Consumers that only
+ * need the newest value of a frame opt in to the last-value shortcut through
+ * isLatest() and latestOf(), nothing is dropped for the others.
+ */
+class CANBASESHARED_EXPORT FrameBatch
+{
+public:
+    explicit FrameBatch(const FrameIndex &index = FrameIndex(), int capacity = 1024);
+
+    //also clears the batch
+    void setIndex(const FrameIndex &index);
+    const FrameIndex &index() const;
+
+    void clear();
+    void append(const QCanBusFrame &frame);
+    void append(quint32 frameID, quint64 payload, quint8 size, qint64 timestampUs);
+
+    int size() const;
+    bool isEmpty() const;
+    int capacity() const;
+    const FrameRecord &at(int i) const;
+    const FrameRecord *begin() const;
+    const FrameRecord *end() const;
+
+    //frames of IDs outside the index are always the latest
+    bool isLatest(int i) const;
+    const FrameRecord *latestOf(quint32 frameID) const;
+
+    //decodes obj from the latest frames, null when one of its frames is not in the batch
+    QVariant readData(const CanObject &obj) const;
+
+private:
+    FrameIndex m_index;
+    QVector<FrameRecord> m_frames;
+    int m_size = 0;
+
+    QVector<int> m_latest;      //per slot, index of the last occurrence or -1
+    QVector<int> m_touched;     //slots with an occurrence, to reset m_latest
+};
+
+}
@@ -0,0 +1,177 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "framecomposer.hpp"
+
+CANObjects::FrameComposer::FrameComposer(const QVector<CanObject> &objects, int defaultPeriodMs) :
+    m_objects(objects)
+{
+    m_writeBegin.reserve(m_objects.size() + 1);
+
+    auto slotOf = [this, defaultPeriodMs](quint32 frameID)
+    {
+        auto it = m_frameIndex.find(frameID);
+
+        if (it == m_frameIndex.end())
+        {
+            FrameSlot slot;
+            slot.frameID = frameID;
+            slot.periodMs = defaultPeriodMs;
+            it = m_frameIndex.insert(frameID, m_frames.size());
+            m_frames.push_back(slot);
+        }
+
+        return it.value();
+    };
+
+    for (const CanObject &obj : m_objects)
+    {
+        m_writeBegin.push_back(m_writes.size());
+
+        const QVector<FrameRange> &ranges = obj.getRanges();
+
+        for (int i = 0; i < ranges.size(); ++i)
+        {
+            const FrameRange &range = ranges[i];
+
+            SignalWrite write;
+            write.slot = slotOf(range.frameID);
+            write.frameMask = range.mask();
+            write.frameShift = range.shift();
+            write.valueOffset = obj.getRangeOffset(i);
+            write.valueMask = (Q_UINT64_C(1) << range.width()) - 1;
+            m_writes.push_back(write);
+        }
+
+        //writing a multiplexed signal selects its layout
+        const QVector<FrameRange> &muxRanges = obj.getMuxRanges();
+
+        for (int i = 0; i < muxRanges.size(); ++i)
+        {
+            const FrameRange &range = muxRanges[i];
+
+            SignalWrite write;
+            write.slot = slotOf(range.frameID);
+            write.frameMask = range.mask();
+            write.fixed = true;
+            write.fixedBits = range.insert(0, static_cast<quint64>(obj.getMuxValue()) >> obj.getMuxRangeOffset(i));
+            m_writes.push_back(write);
+        }
+    }
+
+    m_writeBegin.push_back(m_writes.size());
+}
+
+int CANObjects::FrameComposer::signalCount() const
+{
+    return m_objects.size();
+}
+
+int CANObjects::FrameComposer::indexOf(const QString &name) const
+{
+    for (int i = 0; i < m_objects.size(); ++i)
+    {
+        if (m_objects[i].getName() == name)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+void CANObjects::FrameComposer::setPeriod(quint32 frameID, int periodMs)
+{
+    auto it = m_frameIndex.find(frameID);
+
+    if (it != m_frameIndex.end())
+    {
+        m_frames[it.value()].periodMs = periodMs;
+    }
+}
+
+void CANObjects::FrameComposer::writeValue(int signal, const QVariant &value)
+{
+    writeRaw(signal, m_objects[signal].encodeRaw(value));
+}
+
+void CANObjects::FrameComposer::writeRaw(int signal, quint64 raw)
+{
+    for (int i = m_writeBegin[signal]; i < m_writeBegin[signal + 1]; ++i)
+    {
+        const SignalWrite &write = m_writes[i];
+        FrameSlot &slot = m_frames[write.slot];
+
+        const quint64 bits = write.fixed ? write.fixedBits :
+                                           ((raw >> write.valueOffset) & write.valueMask) << write.frameShift;
+        const quint64 payload = (slot.payload & ~write.frameMask) | bits;
+
+        slot.dirty |= payload != slot.payload;
+        slot.payload = payload;
+        slot.active = true;
+    }
+}
+
+void CANObjects::FrameComposer::setProtection(E2EProtection *protection)
+{
+    m_protection = protection;
+}
+
+void CANObjects::FrameComposer::compose(qint64 nowMs, QVector<QCanBusFrame> &outputFrames)
+{
+    for (FrameSlot &slot : m_frames)
+    {
+        if (!slot.active)
+        {
+            continue;
+        }
+
+        const bool periodElapsed = slot.periodMs > 0 && nowMs - slot.lastSentMs >= slot.periodMs;
+
+        if (slot.dirty || periodElapsed || !slot.sent)
+        {
+            quint64 payload = slot.payload;
+
+            if (m_protection)
+            {
+                m_protection->protect(slot.frameID, payload);
+            }
+
+            outputFrames.push_back(QCanBusFrame(slot.frameID, wordToPayload(payload)));
+            slot.lastSentMs = nowMs;
+            slot.dirty = false;
+            slot.sent = true;
+        }
+    }
+}
+
+QCanBusFrame CANObjects::FrameComposer::frame(quint32 frameID) const
+{
+    auto it = m_frameIndex.find(frameID);
+
+    if (it == m_frameIndex.end())
+    {
+        return QCanBusFrame(QCanBusFrame::InvalidFrame);
+    }
+
+    return QCanBusFrame(frameID, wordToPayload(m_frames[it.value()].payload));
+}
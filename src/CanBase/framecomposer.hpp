@@ -0,0 +1,98 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include "canbase_global.hpp"
+
+#include "canobject.hpp"
+#include "e2eprotection.hpp"
+
+#include <QCanBusFrame>
+#include <QHash>
+#include <QVector>
+
+namespace CANObjects {
+
+/*
+ * Packs TX signals into per frame payload buffers.
+ *
+ * Signals are grouped by frame ID once, every write only merges the signal bits
+ * into the persistent payload with masks precomputed from FrameRange.
+ */
+class CANBASESHARED_EXPORT FrameComposer
+{
+public:
+    FrameComposer(){}
+    explicit FrameComposer(const QVector<CanObject> &objects, int defaultPeriodMs = 0);
+
+    int signalCount() const;
+    int indexOf(const QString &name) const;
+
+    //period 0 means the frame is sent only when its content changes
+    void setPeriod(quint32 frameID, int periodMs);
+
+    void writeValue(int signal, const QVariant &value);
+    void writeRaw(int signal, quint64 raw);
+
+    //counter and CRC of protected frames are filled in by compose()
+    void setProtection(E2EProtection *protection);
+
+    //appends frames that changed or whose period elapsed
+    void compose(qint64 nowMs, QVector<QCanBusFrame> &outputFrames);
+
+    QCanBusFrame frame(quint32 frameID) const;
+
+private:
+    struct FrameSlot
+    {
+        quint32 frameID = 0;
+        quint64 payload = 0;
+        int periodMs = 0;
+        qint64 lastSentMs = 0;
+        bool dirty = false;
+        bool active = false;
+        bool sent = false;
+    };
+
+    struct SignalWrite
+    {
+        int slot = 0;
+        quint64 frameMask = 0;
+        quint8 frameShift = 0;
+        quint8 valueOffset = 0;
+        quint64 valueMask = 0;
+        bool fixed = false;     //multiplexor bits of a multiplexed signal
+        quint64 fixedBits = 0;
+    };
+
+    QVector<CanObject> m_objects;
+    QVector<FrameSlot> m_frames;
+    QHash<quint32, int> m_frameIndex;
+    E2EProtection *m_protection = nullptr;
+
+    //writes of signal i are m_writes[m_writeBegin[i]] .. m_writes[m_writeBegin[i+1]-1]
+    QVector<int> m_writeBegin;
+    QVector<SignalWrite> m_writes;
+};
+
+}
@@ -0,0 +1,163 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "framedispatcher.hpp"
+
+CANObjects::FrameDispatcher::FrameDispatcher(const QVector<CanObject> &objects)
+{
+    build(objects, nullptr);
+}
+
+const QVector<int> &CANObjects::FrameDispatcher::signalsOf(quint32 frameID) const
+{
+    const Entry *e = entry(frameID);
+
+    return e ? e->all : m_empty;
+}
+
+QVector<quint32> CANObjects::FrameDispatcher::frameIDs() const
+{
+    return m_index.frameIDs();
+}
+
+const QVector<int> &CANObjects::FrameDispatcher::plainSignalsOf(quint32 frameID) const
+{
+    const Entry *e = entry(frameID);
+
+    return e ? e->plain : m_empty;
+}
+
+const QVector<int> &CANObjects::FrameDispatcher::muxSignalsOf(quint32 frameID, quint64 payload) const
+{
+    const Entry *e = entry(frameID);
+
+    if (!e || e->selectorRanges.isEmpty())
+    {
+        return m_empty;
+    }
+
+    quint64 selector = 0;
+
+    for (int i = 0; i < e->selectorRanges.size(); ++i)
+    {
+        selector |= e->selectorRanges[i].extract(payload) << e->selectorOffsets[i];
+    }
+
+    if (selector < static_cast<quint64>(e->muxTable.size()))
+    {
+        return e->muxTable[static_cast<int>(selector)];
+    }
+
+    auto it = e->sparseMux.find(static_cast<quint32>(selector));
+
+    return it == e->sparseMux.end() ? m_empty : it.value();
+}
+
+void CANObjects::FrameDispatcher::update(const QVector<CanObject> &objects, const QVector<quint32> &frameIDs)
+{
+    build(objects, &frameIDs);
+}
+
+void CANObjects::FrameDispatcher::build(const QVector<CanObject> &objects, const QVector<quint32> *onlyFrames)
+{
+    //entries are collected by ID, then flattened into slot order of the index
+    QHash<quint32, Entry> entries;
+
+    if (onlyFrames)
+    {
+        const QVector<quint32> &frameIDs = m_index.frameIDs();
+
+        for (int slot = 0; slot < frameIDs.size(); ++slot)
+        {
+            if (!onlyFrames->contains(frameIDs[slot]))
+            {
+                entries.insert(frameIDs[slot], m_entries[slot]);
+            }
+        }
+    }
+
+    for (int i = 0; i < objects.size(); ++i)
+    {
+        const CanObject &obj = objects[i];
+
+        for (const FrameRange &range : obj.getRanges())
+        {
+            if (onlyFrames && !onlyFrames->contains(range.frameID))
+            {
+                continue;
+            }
+
+            Entry &e = entries[range.frameID];
+
+            //signal with more ranges in one frame is dispatched once
+            if (!e.all.isEmpty() && e.all.last() == i)
+            {
+                continue;
+            }
+
+            e.all.push_back(i);
+
+            if (obj.isMultiplexor())
+            {
+                e.selectorRanges = obj.getRanges();
+                e.selectorOffsets.clear();
+
+                for (int r = 0; r < obj.getRanges().size(); ++r)
+                {
+                    e.selectorOffsets.push_back(obj.getRangeOffset(r));
+                }
+            }
+
+            if (!obj.isMultiplexed() || obj.getMuxRanges().isEmpty() || obj.getMuxFrameID() != range.frameID)
+            {
+                e.plain.push_back(i);
+            }
+            else if (obj.getMuxValue() < MaxDenseMuxValue)
+            {
+                if (static_cast<quint32>(e.muxTable.size()) <= obj.getMuxValue())
+                {
+                    e.muxTable.resize(static_cast<int>(obj.getMuxValue()) + 1);
+                }
+
+                e.muxTable[static_cast<int>(obj.getMuxValue())].push_back(i);
+            }
+            else
+            {
+                e.sparseMux[obj.getMuxValue()].push_back(i);
+            }
+        }
+    }
+
+    m_entries.clear();
+    m_entries.reserve(entries.size());
+
+    QVector<quint32> frameIDs;
+    frameIDs.reserve(entries.size());
+
+    for (auto it = entries.cbegin(); it != entries.cend(); ++it)
+    {
+        frameIDs.push_back(it.key());
+        m_entries.push_back(it.value());
+    }
+
+    m_index = FrameIndex(frameIDs);
+}
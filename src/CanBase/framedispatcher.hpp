@@ -0,0 +1,90 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include "canbase_global.hpp"
+
+#include "canobject.hpp"
+#include "frameindex.hpp"
+
+#include <QHash>
+#include <QVector>
+
+namespace CANObjects {
+
+/*
+ * Maps frame ID to indices of the CanObjects that have a range in it,
+ * so a received frame touches only its own signals.
+ *
+ * Frames with a multiplexor get a jump table indexed by the mux value,
+ * the selector is read once per frame and only the signals of the current
+ * layout are returned.
+ */
+class CANBASESHARED_EXPORT FrameDispatcher
+{
+public:
+    FrameDispatcher(){}
+    explicit FrameDispatcher(const QVector<CanObject> &objects);
+
+    //all signals of the frame regardless of the mux value
+    const QVector<int> &signalsOf(quint32 frameID) const;
+    QVector<quint32> frameIDs() const;
+
+    //signals valid for this payload: plain ones (including the multiplexor) and the current mux layout
+    const QVector<int> &plainSignalsOf(quint32 frameID) const;
+    const QVector<int> &muxSignalsOf(quint32 frameID, quint64 payload) const;
+
+    //rebuilds entries of frameIDs only, indices of other signals must not have moved
+    void update(const QVector<CanObject> &objects, const QVector<quint32> &frameIDs);
+
+private:
+    static constexpr quint32 MaxDenseMuxValue = 4096;
+
+    struct Entry
+    {
+        QVector<int> all;
+        QVector<int> plain;
+
+        QVector<FrameRange> selectorRanges;
+        QVector<quint8> selectorOffsets;
+        QVector<QVector<int>> muxTable;
+        QHash<quint32, QVector<int>> sparseMux;
+    };
+
+    //m_entries[m_index.slotOf(frameID)]
+    QVector<Entry> m_entries;
+    FrameIndex m_index;
+    QVector<int> m_empty;
+
+    void build(const QVector<CanObject> &objects, const QVector<quint32> *onlyFrames);
+    inline const Entry *entry(quint32 frameID) const;
+};
+
+const FrameDispatcher::Entry *FrameDispatcher::entry(quint32 frameID) const
+{
+    const int slot = m_index.slotOf(frameID);
+
+    return slot < 0 ? nullptr : &m_entries[slot];
+}
+
+}
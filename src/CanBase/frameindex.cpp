@@ -0,0 +1,184 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "frameindex.hpp"
+
+#include <QSet>
+
+#include <algorithm>
+#include <numeric>
+
+CANObjects::FrameIndex::FrameIndex(const QVector<quint32> &frameIDs)
+{
+    //a repeated ID would overwrite dense entries and never get distinct perfect hash positions
+    QSet<quint32> known;
+    known.reserve(frameIDs.size());
+    m_frameIDs.reserve(frameIDs.size());
+
+    for (const quint32 frameID : frameIDs)
+    {
+        if (!known.contains(frameID))
+        {
+            known.insert(frameID);
+            m_frameIDs.push_back(frameID);
+        }
+    }
+
+    if (m_frameIDs.isEmpty())
+    {
+        return;
+    }
+
+    const auto range = std::minmax_element(m_frameIDs.constBegin(), m_frameIDs.constEnd());
+    const quint64 span = static_cast<quint64>(*range.second) - *range.first + 1;
+
+    if (span <= MaxDenseSpan || span <= 4 * static_cast<quint64>(m_frameIDs.size()))
+    {
+        m_base = *range.first;
+        m_dense.fill(-1, static_cast<int>(span));
+
+        for (int i = 0; i < m_frameIDs.size(); ++i)
+        {
+            m_dense[static_cast<int>(m_frameIDs[i] - m_base)] = i;
+        }
+
+        return;
+    }
+
+    //about 3 IDs per bucket, more buckets and then a sparser table when no seeds were found
+    const int n = m_frameIDs.size();
+    int buckets = n / 3 + 1;
+    int tableSize = n;
+
+    for (int attempt = 0; attempt < MaxBuildAttempts; ++attempt)
+    {
+        if (buildPerfectHash(buckets, tableSize))
+        {
+            return;
+        }
+
+        if (buckets < n)
+        {
+            buckets = std::min(buckets * 2, n);
+        }
+        else
+        {
+            tableSize *= 2;
+        }
+    }
+
+    m_seeds.clear();
+    m_table.clear();
+
+    for (int i = 0; i < n; ++i)
+    {
+        m_fallback.insert(m_frameIDs[i], i);
+    }
+}
+
+int CANObjects::FrameIndex::size() const
+{
+    return m_frameIDs.size();
+}
+
+bool CANObjects::FrameIndex::isDense() const
+{
+    return !m_dense.isEmpty();
+}
+
+const QVector<quint32> &CANObjects::FrameIndex::frameIDs() const
+{
+    return m_frameIDs;
+}
+
+bool CANObjects::FrameIndex::buildPerfectHash(int buckets, int tableSize)
+{
+    const int n = m_frameIDs.size();
+
+    QVector<QVector<int>> members(buckets);
+
+    for (int i = 0; i < n; ++i)
+    {
+        members[static_cast<int>(reduce(hash(m_frameIDs[i], 0), buckets))].push_back(i);
+    }
+
+    //largest buckets first, while most of the table is free
+    QVector<int> order(buckets);
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&members](int a, int b)
+    {
+        return members[a].size() > members[b].size();
+    });
+
+    m_seeds.fill(0, buckets);
+    m_table.fill(-1, tableSize);
+
+    QVector<int> positions;
+
+    for (const int bucket : order)
+    {
+        const QVector<int> &keys = members[bucket];
+
+        if (keys.isEmpty())
+        {
+            break;
+        }
+
+        bool placed = false;
+
+        for (quint32 seed = 1; seed < (1u << 20) && !placed; ++seed)
+        {
+            positions.clear();
+            placed = true;
+
+            for (const int key : keys)
+            {
+                const int position = static_cast<int>(reduce(hash(m_frameIDs[key], seed), tableSize));
+
+                if (m_table[position] >= 0 || positions.contains(position))
+                {
+                    placed = false;
+                    break;
+                }
+
+                positions.push_back(position);
+            }
+
+            if (placed)
+            {
+                m_seeds[bucket] = seed;
+
+                for (int i = 0; i < keys.size(); ++i)
+                {
+                    m_table[positions[i]] = keys[i];
+                }
+            }
+        }
+
+        if (!placed)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
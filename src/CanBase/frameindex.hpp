@@ -0,0 +1,119 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include "canbase_global.hpp"
+
+#include <QHash>
+#include <QVector>
+
+namespace CANObjects {
+
+/*
+ * Maps the frame IDs of a config to compact slots 0..n-1, built once at
+ * config load.
+ *
+ * IDs spanning a small range (typical 11 bit configs) get a dense table
+ * indexed by ID - lowest ID. Sparse sets (29 bit J1939 style) get a minimal
+ * perfect hash: the ID picks a bucket, the displacement seed of the bucket
+ * picks the slot and one compare with the stored ID rejects unknown frames.
+ * A lookup never probes more than once. Should no seeds be found within a
+ * few table sizes, lookups fall back to a plain hash.
+ */
+class CANBASESHARED_EXPORT FrameIndex
+{
+public:
+    static constexpr quint32 MaxDenseSpan = 4096;
+    static constexpr int MaxBuildAttempts = 8;
+
+    FrameIndex(){}
+    //slot i is frameIDs()[i], repeated IDs keep the slot of their first occurrence
+    explicit FrameIndex(const QVector<quint32> &frameIDs);
+
+    //-1 for IDs not in the set
+    inline int slotOf(quint32 frameID) const;
+
+    int size() const;
+    bool isDense() const;
+    const QVector<quint32> &frameIDs() const;
+
+private:
+    QVector<quint32> m_frameIDs;
+
+    //dense table
+    quint32 m_base = 0;
+    QVector<int> m_dense;
+
+    //perfect hash
+    QVector<quint32> m_seeds;
+    QVector<int> m_table;
+
+    //fallback when the perfect hash could not be built
+    QHash<quint32, int> m_fallback;
+
+    static inline quint32 hash(quint32 frameID, quint32 seed);
+    static inline quint32 reduce(quint32 hash, int size);
+
+    bool buildPerfectHash(int buckets, int tableSize);
+};
+
+int FrameIndex::slotOf(quint32 frameID) const
+{
+    if (!m_dense.isEmpty())
+    {
+        const quint32 i = frameID - m_base;
+
+        return i < static_cast<quint32>(m_dense.size()) ? m_dense[static_cast<int>(i)] : -1;
+    }
+
+    if (m_table.isEmpty())
+    {
+        return m_fallback.value(frameID, -1);
+    }
+
+    const quint32 seed = m_seeds[static_cast<int>(reduce(hash(frameID, 0), m_seeds.size()))];
+    const int slot = m_table[static_cast<int>(reduce(hash(frameID, seed), m_table.size()))];
+
+    //tables larger than the ID count keep empty (-1) entries
+    return slot >= 0 && m_frameIDs[slot] == frameID ? slot : -1;
+}
+
+quint32 FrameIndex::hash(quint32 frameID, quint32 seed)
+{
+    //murmur3 finalizer
+    quint32 h = frameID ^ (seed * 0x9E3779B9u);
+    h ^= h >> 16;
+    h *= 0x85EBCA6Bu;
+    h ^= h >> 13;
+    h *= 0xC2B2AE35u;
+    h ^= h >> 16;
+
+    return h;
+}
+
+quint32 FrameIndex::reduce(quint32 hash, int size)
+{
+    return static_cast<quint32>((static_cast<quint64>(hash) * static_cast<quint32>(size)) >> 32);
+}
+
+}
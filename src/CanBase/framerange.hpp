@@ -25,6 +25,7 @@
 #include "canbase_global.hpp"
 
 #include <QVariantMap>
+#include <QByteArray>
 
 namespace CANObjects {
 
@@ -82,6 +83,61 @@ public:
     CANFrameRange byteID;
     BitRange startBit;
     BitRange endBit;
+
+    //payload is handled as one big endian 64bit word, byte 0 is the most significant one
+    inline quint8 width() const {
+        return static_cast<quint8>(endBit.value() - startBit.value() + 1);
+    }
+
+    inline quint8 shift() const {
+        return static_cast<quint8>(63 - (byteID.value()*8 + endBit.value()));
+    }
+
+    inline quint64 mask() const {
+        return ((Q_UINT64_C(1) << width()) - 1) << shift();
+    }
+
+    inline quint64 extract(const quint64 word) const {
+        return (word & mask()) >> shift();
+    }
+
+    inline quint64 insert(const quint64 word, const quint64 bits) const {
+        return (word & ~mask()) | ((bits << shift()) & mask());
+    }
+
+    inline bool operator == (const FrameRange& other) const {
+        return frameID == other.frameID && byteID.value() == other.byteID.value() &&
+                startBit.value() == other.startBit.value() && endBit.value() == other.endBit.value();
+    }
+
+    inline bool operator != (const FrameRange& other) const {
+        return !(*this == other);
+    }
 };
 
+inline quint64 payloadToWord(const QByteArray &payload)
+{
+    quint64 word = 0;
+    const int size = payload.size() < 8 ? payload.size() : 8;
+
+    for (int i = 0; i < size; ++i)
+    {
+        word |= static_cast<quint64>(static_cast<quint8>(payload.at(i))) << (56 - 8*i);
+    }
+
+    return word;
+}
+
+inline QByteArray wordToPayload(const quint64 word, const int size = 8)
+{
+    QByteArray payload(size, 0);
+
+    for (int i = 0; i < size && i < 8; ++i)
+    {
+        payload[i] = static_cast<char>((word >> (56 - 8*i)) & 0xFF);
+    }
+
+    return payload;
+}
+
 }
@@ -0,0 +1,213 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "framesnapshottable.hpp"
+
+#include <QThread>
+
+CANObjects::FrameSnapshotTable::FrameSnapshotTable(int capacity)
+{
+    //power of two, probing uses a mask instead of modulo
+    m_capacity = 1;
+
+    while (m_capacity < capacity)
+    {
+        m_capacity <<= 1;
+    }
+
+    m_slots.reset(new Slot[m_capacity]);
+}
+
+bool CANObjects::FrameSnapshotTable::write(const QCanBusFrame &frame)
+{
+    const QByteArray payload = frame.payload();
+
+    return write(frame.frameId(), payloadToWord(payload), static_cast<quint8>(payload.size()), timestampUs(frame));
+}
+
+bool CANObjects::FrameSnapshotTable::write(quint32 frameID, quint64 payload, quint8 size, qint64 timestampUs)
+{
+    const int mask = m_capacity - 1;
+    int index = probeStart(frameID);
+
+    for (int probe = 0; probe < m_capacity; ++probe, index = (index + 1) & mask)
+    {
+        Slot &slot = m_slots[index];
+        const quint32 key = slot.key.load(std::memory_order_relaxed);
+
+        if (key != frameID && key != EmptyKey)
+        {
+            continue;
+        }
+
+        const quint32 seq = slot.sequence.load(std::memory_order_relaxed);
+        slot.sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        slot.payload.store(payload, std::memory_order_relaxed);
+        slot.timestamp.store(timestampUs, std::memory_order_relaxed);
+        slot.size.store(size, std::memory_order_relaxed);
+
+        slot.sequence.store(seq + 2, std::memory_order_release);
+
+        if (key == EmptyKey)
+        {
+            //publish new ID only after its first payload is complete
+            slot.key.store(frameID, std::memory_order_release);
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+bool CANObjects::FrameSnapshotTable::read(quint32 frameID, FrameSnapshot &snapshot) const
+{
+    const Slot *slot = findSlot(frameID);
+
+    if (!slot)
+    {
+        return false;
+    }
+
+    for (;;)
+    {
+        const quint32 begin = slot->sequence.load(std::memory_order_acquire);
+
+        if (begin & 1u)
+        {
+            QThread::yieldCurrentThread();
+            continue;
+        }
+
+        snapshot.payload = slot->payload.load(std::memory_order_relaxed);
+        snapshot.timestampUs = slot->timestamp.load(std::memory_order_relaxed);
+        snapshot.size = slot->size.load(std::memory_order_relaxed);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+
+        if (slot->sequence.load(std::memory_order_relaxed) == begin)
+        {
+            snapshot.frameID = frameID;
+            return true;
+        }
+    }
+}
+
+QHash<quint32, QCanBusFrame> CANObjects::FrameSnapshotTable::snapshot(const QVector<quint32> &frameIDs) const
+{
+    QHash<quint32, QCanBusFrame> frames;
+    frames.reserve(frameIDs.size());
+
+    FrameSnapshot snap;
+
+    for (const quint32 frameID : frameIDs)
+    {
+        if (read(frameID, snap))
+        {
+            QCanBusFrame frame(frameID, wordToPayload(snap.payload, snap.size));
+            frame.setTimeStamp(QCanBusFrame::TimeStamp(snap.timestampUs / 1000000, snap.timestampUs % 1000000));
+            frames.insert(frameID, frame);
+        }
+    }
+
+    return frames;
+}
+
+QVariant CANObjects::FrameSnapshotTable::readData(const CanObject &obj) const
+{
+    const QVector<FrameRange> &ranges = obj.getRanges();
+
+    FrameSnapshot snap;
+    bool haveSnap = false;
+    quint64 raw = 0;
+
+    if (obj.isMultiplexed() && !obj.getMuxRanges().isEmpty())
+    {
+        haveSnap = read(obj.getMuxFrameID(), snap);
+
+        if (!haveSnap || !obj.muxMatches(snap.payload))
+        {
+            return QVariant();
+        }
+    }
+
+    for (int i = 0; i < ranges.size(); ++i)
+    {
+        const FrameRange &range = ranges[i];
+
+        //ranges of one signal mostly share the frame, read it once
+        if (!haveSnap || snap.frameID != range.frameID)
+        {
+            haveSnap = read(range.frameID, snap);
+
+            if (!haveSnap)
+            {
+                return QVariant();
+            }
+        }
+
+        raw |= range.extract(snap.payload) << obj.getRangeOffset(i);
+    }
+
+    return obj.decodeRaw(raw);
+}
+
+int CANObjects::FrameSnapshotTable::capacity() const
+{
+    return m_capacity;
+}
+
+qint64 CANObjects::FrameSnapshotTable::timestampUs(const QCanBusFrame &frame)
+{
+    const QCanBusFrame::TimeStamp stamp = frame.timeStamp();
+    return stamp.seconds() * 1000000 + stamp.microSeconds();
+}
+
+int CANObjects::FrameSnapshotTable::probeStart(quint32 frameID) const
+{
+    return static_cast<int>((frameID * 2654435761u) & static_cast<quint32>(m_capacity - 1));
+}
+
+const CANObjects::FrameSnapshotTable::Slot *CANObjects::FrameSnapshotTable::findSlot(quint32 frameID) const
+{
+    const int mask = m_capacity - 1;
+    int index = probeStart(frameID);
+
+    for (int probe = 0; probe < m_capacity; ++probe, index = (index + 1) & mask)
+    {
+        const quint32 key = m_slots[index].key.load(std::memory_order_acquire);
+
+        if (key == frameID)
+        {
+            return &m_slots[index];
+        }
+
+        if (key == EmptyKey)
+        {
+            return nullptr;
+        }
+    }
+
+    return nullptr;
+}
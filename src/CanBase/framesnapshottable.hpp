@@ -0,0 +1,96 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include "canbase_global.hpp"
+
+#include "canobject.hpp"
+
+#include <QCanBusFrame>
+#include <QHash>
+#include <QVector>
+
+#include <atomic>
+#include <limits>
+#include <memory>
+
+namespace CANObjects {
+
+struct CANBASESHARED_EXPORT FrameSnapshot
+{
+    quint32 frameID = 0;
+    quint64 payload = 0;
+    quint8 size = 0;
+    qint64 timestampUs = 0;
+};
+
+/*
+ * Latest payload and timestamp of every frame ID.
+ *
+ * Written by one thread (RX), read by any number of threads without locks.
+ * Every slot is guarded by its own sequence counter (seqlock), readers retry
+ * while a write of the same slot is in progress.
+ */
+class CANBASESHARED_EXPORT FrameSnapshotTable
+{
+public:
+    explicit FrameSnapshotTable(int capacity = 1024);
+
+    FrameSnapshotTable(const FrameSnapshotTable &) = delete;
+    FrameSnapshotTable &operator=(const FrameSnapshotTable &) = delete;
+
+    //writer side, returns false when the table is full
+    bool write(const QCanBusFrame &frame);
+    bool write(quint32 frameID, quint64 payload, quint8 size, qint64 timestampUs);
+
+    //reader side, every returned frame is consistent on its own
+    bool read(quint32 frameID, FrameSnapshot &snapshot) const;
+    QHash<quint32, QCanBusFrame> snapshot(const QVector<quint32> &frameIDs) const;
+
+    //decodes obj directly from the table, null when one of its frames was not seen yet
+    QVariant readData(const CanObject &obj) const;
+
+    int capacity() const;
+
+    static qint64 timestampUs(const QCanBusFrame &frame);
+
+private:
+    static constexpr quint32 EmptyKey = std::numeric_limits<quint32>::max();
+
+    struct alignas(64) Slot
+    {
+        std::atomic<quint32> key{EmptyKey};
+        std::atomic<quint32> sequence{0};
+        std::atomic<quint64> payload{0};
+        std::atomic<qint64> timestamp{0};
+        std::atomic<quint8> size{0};
+    };
+
+    int m_capacity = 0;
+    std::unique_ptr<Slot[]> m_slots;
+
+    int probeStart(quint32 frameID) const;
+    const Slot *findSlot(quint32 frameID) const;
+};
+
+}
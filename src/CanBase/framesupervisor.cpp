@@ -0,0 +1,225 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "framesupervisor.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+CANObjects::FrameCycle::FrameCycle(quint32 frameID, int cycleMs, int timeoutMs) :
+    frameID(frameID)
+  , cycleMs(cycleMs)
+  , timeoutMs(timeoutMs < 0 ? cycleMs + cycleMs / 2 : timeoutMs)
+{
+}
+
+CANObjects::FrameCycle::FrameCycle(const QVariantMap &map) :
+    FrameCycle(map["frameid"].toUInt(), map["cycletime"].toInt(), map.value("timeout", -1).toInt())
+{
+}
+
+bool CANObjects::FrameCycle::operator==(const FrameCycle &other) const
+{
+    return frameID == other.frameID && cycleMs == other.cycleMs && timeoutMs == other.timeoutMs;
+}
+
+bool CANObjects::FrameCycle::operator!=(const FrameCycle &other) const
+{
+    return !(*this == other);
+}
+
+CANObjects::FrameSupervisor::FrameSupervisor(const QVector<FrameCycle> &cycles, qint64 tickUs) :
+    m_tickUs(std::max<qint64>(tickUs, 1))
+{
+    QVector<quint32> frameIDs;
+
+    //entries follow the slots of the index, the first cycle of a frame ID wins
+    for (const FrameCycle &cycle : cycles)
+    {
+        if (!frameIDs.contains(cycle.frameID))
+        {
+            frameIDs.push_back(cycle.frameID);
+            m_cycles.push_back(cycle);
+        }
+    }
+
+    m_index = FrameIndex(frameIDs);
+    m_entries.resize(m_cycles.size());
+    m_buckets.fill(-1, WheelSize);
+
+    for (int i = 0; i < m_cycles.size(); ++i)
+    {
+        m_entries[i].timeoutUs = static_cast<qint64>(m_cycles[i].timeoutMs) * 1000;
+    }
+}
+
+void CANObjects::FrameSupervisor::arm(qint64 nowUs)
+{
+    for (int slot = 0; slot < m_entries.size(); ++slot)
+    {
+        const Entry &entry = m_entries[slot];
+
+        if (entry.bucket < 0 && !entry.timedOut)
+        {
+            schedule(slot, nowUs + entry.timeoutUs);
+        }
+    }
+}
+
+bool CANObjects::FrameSupervisor::onFrame(quint32 frameID, qint64 timestampUs)
+{
+    const int slot = m_index.slotOf(frameID);
+
+    if (slot < 0)
+    {
+        return false;
+    }
+
+    Entry &entry = m_entries[slot];
+    const bool recovered = entry.timedOut;
+
+    if (recovered)
+    {
+        entry.timedOut = false;
+        --m_timedOutCount;
+    }
+
+    schedule(slot, timestampUs + entry.timeoutUs);
+
+    return recovered;
+}
+
+void CANObjects::FrameSupervisor::advance(qint64 nowUs, QVector<quint32> &timedOut)
+{
+    const qint64 nowTick = nowUs / m_tickUs;
+
+    //first call visits every bucket
+    if (m_tick < 0)
+    {
+        m_tick = nowTick - WheelSize;
+    }
+
+    //one revolution visits every bucket
+    const qint64 first = std::max(m_tick + 1, nowTick - WheelSize + 1);
+
+    for (qint64 tick = first; tick <= nowTick; ++tick)
+    {
+        int slot = m_buckets[static_cast<int>(tick & (WheelSize - 1))];
+
+        while (slot >= 0)
+        {
+            Entry &entry = m_entries[slot];
+            const int next = entry.next;
+
+            //later revolutions stay in the bucket
+            if (entry.deadlineUs <= nowUs)
+            {
+                unlink(slot);
+                entry.timedOut = true;
+                ++m_timedOutCount;
+                timedOut.push_back(m_cycles[slot].frameID);
+            }
+
+            slot = next;
+        }
+    }
+
+    m_tick = std::max(m_tick, nowTick);
+}
+
+bool CANObjects::FrameSupervisor::isSupervised(quint32 frameID) const
+{
+    return m_index.slotOf(frameID) >= 0;
+}
+
+bool CANObjects::FrameSupervisor::isTimedOut(quint32 frameID) const
+{
+    const int slot = m_index.slotOf(frameID);
+
+    return slot >= 0 && m_entries[slot].timedOut;
+}
+
+int CANObjects::FrameSupervisor::timedOutCount() const
+{
+    return m_timedOutCount;
+}
+
+const QVector<CANObjects::FrameCycle> &CANObjects::FrameSupervisor::cycles() const
+{
+    return m_cycles;
+}
+
+void CANObjects::FrameSupervisor::schedule(int slot, qint64 deadlineUs)
+{
+    unlink(slot);
+
+    //a deadline in an already visited tick goes to the next one
+    const qint64 tick = std::max((deadlineUs + m_tickUs - 1) / m_tickUs, m_tick + 1);
+    const int bucket = static_cast<int>(tick & (WheelSize - 1));
+
+    Entry &entry = m_entries[slot];
+    entry.deadlineUs = deadlineUs;
+    entry.bucket = bucket;
+    entry.prev = -1;
+    entry.next = m_buckets[bucket];
+
+    if (entry.next >= 0)
+    {
+        m_entries[entry.next].prev = slot;
+    }
+
+    m_buckets[bucket] = slot;
+}
+
+void CANObjects::FrameSupervisor::unlink(int slot)
+{
+    Entry &entry = m_entries[slot];
+
+    if (entry.bucket < 0)
+    {
+        return;
+    }
+
+    if (entry.prev >= 0)
+    {
+        m_entries[entry.prev].next = entry.next;
+    }
+    else
+    {
+        m_buckets[entry.bucket] = entry.next;
+    }
+
+    if (entry.next >= 0)
+    {
+        m_entries[entry.next].prev = entry.prev;
+    }
+
+    entry.bucket = -1;
+    entry.prev = -1;
+    entry.next = -1;
+}
+
+qint64 CANObjects::FrameSupervisor::nowUs()
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+}
@@ -0,0 +1,116 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include "canbase_global.hpp"
+
+#include "frameindex.hpp"
+
+#include <QVariantMap>
+#include <QVector>
+
+namespace CANObjects {
+
+/*
+ * Expected cycle time of one frame ID. The frame times out when nothing
+ * arrived for timeout ms, by default one and a half cycles.
+ *
+ *   "cycles": [{"frameid": 1680, "cycletime": 100, "timeout": 150}]
+ */
+struct CANBASESHARED_EXPORT FrameCycle
+{
+    quint32 frameID = 0;
+    int cycleMs = 0;
+    int timeoutMs = 0;
+
+    FrameCycle(){}
+    FrameCycle(quint32 frameID, int cycleMs, int timeoutMs = -1);
+    explicit FrameCycle(const QVariantMap &map);
+
+    bool operator==(const FrameCycle &other) const;
+    bool operator!=(const FrameCycle &other) const;
+};
+
+/*
+ * Missing frame supervision on a hashed timing wheel.
+ *
+ * Every supervised frame sits in the wheel bucket of its deadline tick, in an
+ * intrusive list. A received frame moves itself to the bucket of its new
+ * deadline, advance() visits only the buckets of elapsed ticks, so both are
+ * O(1) regardless of the number of frame IDs. Deadlines further away than one
+ * revolution stay in their bucket until their own turn comes.
+ *
+ * A frame is supervised from its first reception or from arm(). A timed out
+ * frame is reported once and stays timed out until it is received again.
+ */
+class CANBASESHARED_EXPORT FrameSupervisor
+{
+public:
+    static constexpr int WheelSize = 512;
+    static constexpr qint64 DefaultTickUs = 1000;
+
+    FrameSupervisor(){}
+    explicit FrameSupervisor(const QVector<FrameCycle> &cycles, qint64 tickUs = DefaultTickUs);
+
+    //starts supervision of frames not received yet
+    void arm(qint64 nowUs);
+
+    //restarts the deadline, true when the frame was timed out before
+    bool onFrame(quint32 frameID, qint64 timestampUs);
+
+    //frames whose deadline passed up to nowUs are appended to timedOut
+    void advance(qint64 nowUs, QVector<quint32> &timedOut);
+
+    bool isSupervised(quint32 frameID) const;
+    bool isTimedOut(quint32 frameID) const;
+    int timedOutCount() const;
+
+    const QVector<FrameCycle> &cycles() const;
+
+    //monotonic time for live supervision, does not jump with the wall clock
+    static qint64 nowUs();
+
+private:
+    struct Entry
+    {
+        qint64 timeoutUs = 0;
+        qint64 deadlineUs = 0;
+        int bucket = -1;        //-1 when not in the wheel
+        int prev = -1;
+        int next = -1;
+        bool timedOut = false;
+    };
+
+    QVector<FrameCycle> m_cycles;
+    FrameIndex m_index;
+    QVector<Entry> m_entries;
+    QVector<int> m_buckets;     //first entry of every bucket
+    qint64 m_tickUs = DefaultTickUs;
+    qint64 m_tick = -1;         //last tick advance() processed
+    int m_timedOutCount = 0;
+
+    void schedule(int slot, qint64 deadlineUs);
+    void unlink(int slot);
+};
+
+}
@@ -0,0 +1,382 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "isotptransport.hpp"
+
+#include <algorithm>
+
+namespace {
+
+constexpr quint8 SingleFrame = 0x0;
+constexpr quint8 FirstFrame = 0x1;
+constexpr quint8 ConsecutiveFrame = 0x2;
+constexpr quint8 FlowControlFrame = 0x3;
+
+constexpr int FrameSize = 8;
+
+}
+
+CANObjects::IsoTpTransport::IsoTpTransport(const QVector<IsoTpChannelConfig> &channels)
+{
+    m_channels.resize(channels.size());
+
+    for (int i = 0; i < channels.size(); ++i)
+    {
+        Channel &channel = m_channels[i];
+        channel.config = channels[i];
+        //a single or first frame always fills up to 7 bytes of the buffer
+        channel.config.maxSize = std::min(std::max(channel.config.maxSize, 8), 4095);
+
+        //allocated once, reused for every message
+        channel.rxBuffer.resize(channel.config.maxSize);
+        channel.txBuffer.resize(channel.config.maxSize);
+
+        m_channelIndex.insert(channel.config.rxID, i);
+    }
+}
+
+int CANObjects::IsoTpTransport::channelCount() const
+{
+    return m_channels.size();
+}
+
+int CANObjects::IsoTpTransport::channelOf(quint32 rxID) const
+{
+    return m_channelIndex.value(rxID, -1);
+}
+
+void CANObjects::IsoTpTransport::setMessageHandler(const MessageHandler &handler)
+{
+    m_messageHandler = handler;
+}
+
+void CANObjects::IsoTpTransport::setErrorHandler(const ErrorHandler &handler)
+{
+    m_errorHandler = handler;
+}
+
+CANObjects::IsoTpTransport::Result CANObjects::IsoTpTransport::send(int channel, const QByteArray &data, qint64 nowUs)
+{
+    Channel &ch = m_channels[channel];
+
+    if (ch.txState != TxState::Idle)
+    {
+        return Result::Busy;
+    }
+
+    if (data.isEmpty() || data.size() > ch.config.maxSize)
+    {
+        return Result::TooLarge;
+    }
+
+    std::copy(data.constBegin(), data.constEnd(), ch.txBuffer.begin());
+    ch.txSize = data.size();
+    ch.txPos = 0;
+    ch.txSequence = 1;
+    ch.txNextUs = nowUs;
+    ch.txState = data.size() < FrameSize ? TxState::Single : TxState::First;
+
+    return Result::Ok;
+}
+
+bool CANObjects::IsoTpTransport::isSending(int channel) const
+{
+    return m_channels[channel].txState != TxState::Idle;
+}
+
+bool CANObjects::IsoTpTransport::receive(const QCanBusFrame &frame, qint64 nowUs)
+{
+    const int channel = channelOf(frame.frameId());
+
+    if (channel < 0 || frame.frameType() != QCanBusFrame::DataFrame)
+    {
+        return false;
+    }
+
+    const QByteArray payload = frame.payload();
+
+    if (payload.isEmpty())
+    {
+        return true;
+    }
+
+    Channel &ch = m_channels[channel];
+    const quint8 pci = static_cast<quint8>(payload.at(0));
+    const char *data = payload.constData();
+    char *buffer = ch.rxBuffer.data();
+
+    switch (pci >> 4)
+    {
+    case SingleFrame:
+    {
+        const int size = pci & 0x0F;
+
+        if (size == 0 || size >= payload.size())
+        {
+            break;
+        }
+
+        //a new message aborts one in progress
+        if (ch.rxState == RxState::Receiving)
+        {
+            fail(channel, Result::Aborted);
+        }
+
+        std::copy(data + 1, data + 1 + size, buffer);
+        ch.rxState = RxState::Idle;
+
+        if (m_messageHandler)
+        {
+            m_messageHandler(channel, QByteArray::fromRawData(buffer, size));
+        }
+
+        break;
+    }
+    case FirstFrame:
+    {
+        if (payload.size() < FrameSize)
+        {
+            break;
+        }
+
+        const int size = ((pci & 0x0F) << 8) | static_cast<quint8>(payload.at(1));
+
+        //shorter messages are single frames, ignored as ISO 15765-2 requires
+        if (size < FrameSize)
+        {
+            break;
+        }
+
+        if (ch.rxState == RxState::Receiving)
+        {
+            fail(channel, Result::Aborted);
+        }
+
+        ch.flowControlDue = true;
+
+        if (size > ch.config.maxSize)
+        {
+            ch.flowStatus = FlowStatus::Overflow;
+            ch.rxState = RxState::Idle;
+            break;
+        }
+
+        std::copy(data + 2, data + FrameSize, buffer);
+        ch.rxSize = size;
+        ch.rxPos = FrameSize - 2;
+        ch.rxSequence = 1;
+        ch.rxBlockCount = 0;
+        ch.rxDeadlineUs = nowUs + TimeoutUs;
+        ch.flowStatus = FlowStatus::ContinueToSend;
+        ch.rxState = RxState::Receiving;
+        break;
+    }
+    case ConsecutiveFrame:
+    {
+        if (ch.rxState != RxState::Receiving)
+        {
+            break;
+        }
+
+        if ((pci & 0x0F) != ch.rxSequence)
+        {
+            ch.rxState = RxState::Idle;
+            fail(channel, Result::WrongSequence);
+            break;
+        }
+
+        const int size = std::max(0, std::min(ch.rxSize - ch.rxPos, payload.size() - 1));
+        std::copy(data + 1, data + 1 + size, buffer + ch.rxPos);
+        ch.rxPos += size;
+        ch.rxSequence = (ch.rxSequence + 1) & 0x0F;
+        ch.rxDeadlineUs = nowUs + TimeoutUs;
+
+        if (ch.rxPos >= ch.rxSize)
+        {
+            ch.rxState = RxState::Idle;
+
+            if (m_messageHandler)
+            {
+                m_messageHandler(channel, QByteArray::fromRawData(buffer, ch.rxSize));
+            }
+        }
+        else if (ch.config.blockSize && ++ch.rxBlockCount == ch.config.blockSize)
+        {
+            ch.rxBlockCount = 0;
+            ch.flowControlDue = true;
+        }
+
+        break;
+    }
+    case FlowControlFrame:
+        onFlowControl(channel, payload, nowUs);
+        break;
+    default:
+        break;
+    }
+
+    return true;
+}
+
+void CANObjects::IsoTpTransport::poll(qint64 nowUs, QVector<QCanBusFrame> &output)
+{
+    char frame[FrameSize];
+
+    for (int channel = 0; channel < m_channels.size(); ++channel)
+    {
+        Channel &ch = m_channels[channel];
+
+        if (ch.flowControlDue)
+        {
+            frame[0] = static_cast<char>(FlowControlFrame << 4 | static_cast<quint8>(ch.flowStatus));
+            frame[1] = static_cast<char>(ch.config.blockSize);
+            frame[2] = static_cast<char>(ch.config.stMin);
+            output.push_back(makeFrame(ch, frame, 3));
+            ch.flowControlDue = false;
+        }
+
+        if (ch.rxState == RxState::Receiving && nowUs > ch.rxDeadlineUs)
+        {
+            ch.rxState = RxState::Idle;
+            fail(channel, Result::Timeout);
+        }
+
+        const char *data = ch.txBuffer.constData();
+
+        switch (ch.txState)
+        {
+        case TxState::Single:
+            frame[0] = static_cast<char>(ch.txSize);
+            std::copy(data, data + ch.txSize, frame + 1);
+            output.push_back(makeFrame(ch, frame, ch.txSize + 1));
+            ch.txState = TxState::Idle;
+            break;
+        case TxState::First:
+            frame[0] = static_cast<char>(FirstFrame << 4 | ch.txSize >> 8);
+            frame[1] = static_cast<char>(ch.txSize & 0xFF);
+            std::copy(data, data + FrameSize - 2, frame + 2);
+            output.push_back(makeFrame(ch, frame, FrameSize));
+            ch.txPos = FrameSize - 2;
+            ch.txDeadlineUs = nowUs + TimeoutUs;
+            ch.txState = TxState::WaitFlowControl;
+            break;
+        case TxState::WaitFlowControl:
+            if (nowUs > ch.txDeadlineUs)
+            {
+                ch.txState = TxState::Idle;
+                fail(channel, Result::Timeout);
+            }
+            break;
+        case TxState::Sending:
+            //STmin 0 sends the whole block at once
+            while (ch.txState == TxState::Sending && nowUs >= ch.txNextUs)
+            {
+                const int size = std::min(ch.txSize - ch.txPos, FrameSize - 1);
+
+                frame[0] = static_cast<char>(ConsecutiveFrame << 4 | ch.txSequence);
+                std::copy(data + ch.txPos, data + ch.txPos + size, frame + 1);
+                output.push_back(makeFrame(ch, frame, size + 1));
+
+                ch.txPos += size;
+                ch.txSequence = (ch.txSequence + 1) & 0x0F;
+                ch.txNextUs = nowUs + ch.txStMinUs;
+
+                if (ch.txPos >= ch.txSize)
+                {
+                    ch.txState = TxState::Idle;
+                }
+                else if (ch.txBlockRemaining > 0 && --ch.txBlockRemaining == 0)
+                {
+                    ch.txDeadlineUs = nowUs + TimeoutUs;
+                    ch.txState = TxState::WaitFlowControl;
+                }
+
+                if (ch.txStMinUs > 0)
+                {
+                    break;
+                }
+            }
+            break;
+        case TxState::Idle:
+            break;
+        }
+    }
+}
+
+qint64 CANObjects::IsoTpTransport::stMinToUs(quint8 stMin)
+{
+    if (stMin <= 0x7F)
+    {
+        return stMin * 1000;
+    }
+
+    if (stMin >= 0xF1 && stMin <= 0xF9)
+    {
+        return (stMin - 0xF0) * 100;
+    }
+
+    //reserved values mean the longest STmin
+    return 127000;
+}
+
+void CANObjects::IsoTpTransport::onFlowControl(int channel, const QByteArray &payload, qint64 nowUs)
+{
+    Channel &ch = m_channels[channel];
+
+    if (ch.txState != TxState::WaitFlowControl || payload.size() < 3)
+    {
+        return;
+    }
+
+    switch (static_cast<FlowStatus>(payload.at(0) & 0x0F))
+    {
+    case FlowStatus::ContinueToSend:
+        ch.txBlockRemaining = static_cast<quint8>(payload.at(1));
+        ch.txStMinUs = stMinToUs(static_cast<quint8>(payload.at(2)));
+        ch.txNextUs = nowUs;
+        ch.txState = TxState::Sending;
+        break;
+    case FlowStatus::Wait:
+        ch.txDeadlineUs = nowUs + TimeoutUs;
+        break;
+    case FlowStatus::Overflow:
+        ch.txState = TxState::Idle;
+        fail(channel, Result::Overflow);
+        break;
+    }
+}
+
+void CANObjects::IsoTpTransport::fail(int channel, Result error)
+{
+    if (m_errorHandler)
+    {
+        m_errorHandler(channel, error);
+    }
+}
+
+QCanBusFrame CANObjects::IsoTpTransport::makeFrame(const Channel &channel, const char *data, int size) const
+{
+    QByteArray payload(FrameSize, static_cast<char>(channel.config.padding));
+    std::copy(data, data + size, payload.begin());
+
+    return QCanBusFrame(channel.config.txID, payload);
+}
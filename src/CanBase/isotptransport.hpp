@@ -0,0 +1,158 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include "canbase_global.hpp"
+
+#include <QByteArray>
+#include <QCanBusFrame>
+#include <QHash>
+#include <QVector>
+
+#include <functional>
+
+namespace CANObjects {
+
+struct CANBASESHARED_EXPORT IsoTpChannelConfig
+{
+    quint32 rxID = 0;
+    quint32 txID = 0;
+    quint8 blockSize = 0;       //sent in our flow control, 0 is unlimited
+    quint8 stMin = 0;           //sent in our flow control, ISO 15765-2 encoding
+    quint8 padding = 0xCC;
+    int maxSize = 4095;         //8..4095
+};
+
+/*
+ * ISO 15765-2 transport over classic CAN frames, normal addressing.
+ *
+ * Every channel owns receive and send buffers of maxSize bytes allocated
+ * once, consecutive frames are written straight into the receive buffer and
+ * a complete message is handed out as a QByteArray view of it. Channels are
+ * independent, any number of them can transfer at the same time.
+ *
+ * The transport does no I/O: frames from QCanBusDevice go into receive(),
+ * frames to send (flow control, consecutive frames respecting the block size
+ * and STmin of the peer) are collected by poll() which also runs the N_Bs and
+ * N_Cr timeouts. Call poll() from a timer at least as often as the smallest
+ * STmin.
+ */
+class CANBASESHARED_EXPORT IsoTpTransport
+{
+public:
+    enum class Result
+    {
+        Ok,
+        Busy,
+        TooLarge,
+        Timeout,
+        Overflow,
+        WrongSequence,
+        Aborted
+    };
+
+    //message is a view into the channel buffer, valid only during the call
+    using MessageHandler = std::function<void(int channel, const QByteArray &message)>;
+    using ErrorHandler = std::function<void(int channel, Result error)>;
+
+    static constexpr qint64 TimeoutUs = 1000000;
+
+    explicit IsoTpTransport(const QVector<IsoTpChannelConfig> &channels);
+
+    int channelCount() const;
+    int channelOf(quint32 rxID) const;
+
+    void setMessageHandler(const MessageHandler &handler);
+    void setErrorHandler(const ErrorHandler &handler);
+
+    //copies data into the send buffer of the channel, frames go out with poll()
+    Result send(int channel, const QByteArray &data, qint64 nowUs);
+    bool isSending(int channel) const;
+
+    //false when the frame belongs to no channel
+    bool receive(const QCanBusFrame &frame, qint64 nowUs);
+
+    void poll(qint64 nowUs, QVector<QCanBusFrame> &output);
+
+    static qint64 stMinToUs(quint8 stMin);
+
+private:
+    enum class RxState
+    {
+        Idle,
+        Receiving
+    };
+
+    enum class TxState
+    {
+        Idle,
+        Single,
+        First,
+        WaitFlowControl,
+        Sending
+    };
+
+    enum class FlowStatus : quint8
+    {
+        ContinueToSend = 0,
+        Wait = 1,
+        Overflow = 2
+    };
+
+    struct Channel
+    {
+        IsoTpChannelConfig config;
+
+        QByteArray rxBuffer;
+        RxState rxState = RxState::Idle;
+        int rxSize = 0;
+        int rxPos = 0;
+        quint8 rxSequence = 0;
+        int rxBlockCount = 0;
+        qint64 rxDeadlineUs = 0;
+        bool flowControlDue = false;
+        FlowStatus flowStatus = FlowStatus::ContinueToSend;
+
+        QByteArray txBuffer;
+        TxState txState = TxState::Idle;
+        int txSize = 0;
+        int txPos = 0;
+        quint8 txSequence = 0;
+        int txBlockRemaining = 0;
+        qint64 txStMinUs = 0;
+        qint64 txNextUs = 0;
+        qint64 txDeadlineUs = 0;
+    };
+
+    QVector<Channel> m_channels;
+    QHash<quint32, int> m_channelIndex;
+
+    MessageHandler m_messageHandler;
+    ErrorHandler m_errorHandler;
+
+    void onFlowControl(int channel, const QByteArray &payload, qint64 nowUs);
+    void fail(int channel, Result error);
+    QCanBusFrame makeFrame(const Channel &channel, const char *data, int size) const;
+};
+
+}
@@ -0,0 +1,173 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "latencyhistogram.hpp"
+
+#include <algorithm>
+
+CANObjects::LatencyHistogram::LatencyHistogram() :
+    m_buckets(BucketCount, 0)
+{
+
+}
+
+void CANObjects::LatencyHistogram::record(qint64 value)
+{
+    value = std::max<qint64>(0, value);
+
+    ++m_buckets[bucketOf(static_cast<quint64>(value))];
+
+    m_min = m_count ? std::min(m_min, value) : value;
+    m_max = m_count ? std::max(m_max, value) : value;
+    m_sum += value;
+    ++m_count;
+}
+
+void CANObjects::LatencyHistogram::reset()
+{
+    std::fill(m_buckets.begin(), m_buckets.end(), 0);
+    m_count = 0;
+    m_min = 0;
+    m_max = 0;
+    m_sum = 0.0;
+}
+
+void CANObjects::LatencyHistogram::merge(const LatencyHistogram &other)
+{
+    if (other.m_count == 0)
+    {
+        return;
+    }
+
+    for (int bucket = 0; bucket < BucketCount; ++bucket)
+    {
+        m_buckets[bucket] += other.m_buckets.at(bucket);
+    }
+
+    m_min = m_count ? std::min(m_min, other.m_min) : other.m_min;
+    m_max = m_count ? std::max(m_max, other.m_max) : other.m_max;
+    m_sum += other.m_sum;
+    m_count += other.m_count;
+}
+
+void CANObjects::LatencyHistogram::merge(const quint64 *counts, qint64 min, qint64 max, double sum)
+{
+    quint64 count = 0;
+
+    for (int bucket = 0; bucket < BucketCount; ++bucket)
+    {
+        m_buckets[bucket] += counts[bucket];
+        count += counts[bucket];
+    }
+
+    if (count == 0)
+    {
+        return;
+    }
+
+    m_min = m_count ? std::min(m_min, min) : min;
+    m_max = m_count ? std::max(m_max, max) : max;
+    m_sum += sum;
+    m_count += count;
+}
+
+quint64 CANObjects::LatencyHistogram::count() const
+{
+    return m_count;
+}
+
+qint64 CANObjects::LatencyHistogram::min() const
+{
+    return m_min;
+}
+
+qint64 CANObjects::LatencyHistogram::max() const
+{
+    return m_max;
+}
+
+double CANObjects::LatencyHistogram::mean() const
+{
+    return m_count ? m_sum / m_count : 0.0;
+}
+
+qint64 CANObjects::LatencyHistogram::percentile(double percent) const
+{
+    if (m_count == 0)
+    {
+        return 0;
+    }
+
+    const quint64 rank = std::max<quint64>(1, static_cast<quint64>(percent / 100.0 * m_count + 0.5));
+    quint64 seen = 0;
+
+    for (int bucket = 0; bucket < m_buckets.size(); ++bucket)
+    {
+        seen += m_buckets[bucket];
+
+        if (seen >= rank)
+        {
+            return std::min<qint64>(static_cast<qint64>(bucketUpperBound(bucket)), m_max);
+        }
+    }
+
+    return m_max;
+}
+
+int CANObjects::LatencyHistogram::bucketOf(quint64 value)
+{
+    if (value < 32)
+    {
+        return static_cast<int>(value);
+    }
+
+    //shift keeps the 5 most significant bits, the top one is always set
+    const int msb = 63 - __builtin_clzll(value);
+    const int shift = msb - 4;
+
+    return 16 * shift + static_cast<int>(value >> shift);
+}
+
+quint64 CANObjects::LatencyHistogram::bucketLowerBound(int bucket)
+{
+    if (bucket < 32)
+    {
+        return static_cast<quint64>(bucket);
+    }
+
+    const int shift = bucket / 16 - 1;
+    const quint64 mantissa = static_cast<quint64>(bucket - 16 * shift);
+
+    return mantissa << shift;
+}
+
+quint64 CANObjects::LatencyHistogram::bucketUpperBound(int bucket)
+{
+    if (bucket < 32)
+    {
+        return static_cast<quint64>(bucket);
+    }
+
+    const int shift = bucket / 16 - 1;
+
+    return bucketLowerBound(bucket) + (Q_UINT64_C(1) << shift) - 1;
+}
@@ -0,0 +1,72 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include "canbase_global.hpp"
+
+#include <QVector>
+
+namespace CANObjects {
+
+/*
+ * Log-linear histogram of non negative values (microseconds).
+ *
+ * Values below 32 are exact, above that every power of two is split into
+ * 16 buckets, so percentiles are within ~6% with a fixed 976 bucket table.
+ */
+class CANBASESHARED_EXPORT LatencyHistogram
+{
+public:
+    static constexpr int BucketCount = 976;
+
+    LatencyHistogram();
+
+    void record(qint64 value);
+    void reset();
+
+    //adds the samples of other, copies bucket by bucket
+    void merge(const LatencyHistogram &other);
+    //adds samples counted elsewhere, counts has BucketCount entries
+    void merge(const quint64 *counts, qint64 min, qint64 max, double sum);
+
+    quint64 count() const;
+    qint64 min() const;
+    qint64 max() const;
+    double mean() const;
+
+    //upper bound of the bucket holding the given percentile (0..100)
+    qint64 percentile(double percent) const;
+
+    static int bucketOf(quint64 value);
+    static quint64 bucketLowerBound(int bucket);
+    static quint64 bucketUpperBound(int bucket);
+
+private:
+    QVector<quint64> m_buckets;
+    quint64 m_count = 0;
+    qint64 m_min = 0;
+    qint64 m_max = 0;
+    double m_sum = 0.0;
+};
+
+}
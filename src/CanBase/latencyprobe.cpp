@@ -0,0 +1,130 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "latencyprobe.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+CANObjects::LatencyProbe::LatencyProbe(int signal, int counterBits, int capacity) :
+    m_signal(signal)
+  , m_counterMask(counterBits >= 64 ? ~Q_UINT64_C(0) : (Q_UINT64_C(1) << counterBits) - 1)
+{
+    //a sequence must not come around while its frame is in flight
+    const quint64 sequences = m_counterMask + 1;
+    const int size = sequences != 0 && sequences < static_cast<quint64>(capacity) ? static_cast<int>(sequences) : capacity;
+
+    m_pending.resize(std::max(1, size));
+}
+
+int CANObjects::LatencyProbe::signal() const
+{
+    return m_signal;
+}
+
+quint64 CANObjects::LatencyProbe::nextSequence()
+{
+    const quint64 sequence = m_nextSequence;
+    m_nextSequence = (m_nextSequence + 1) & m_counterMask;
+
+    return sequence;
+}
+
+void CANObjects::LatencyProbe::onSent(quint64 sequence, qint64 txUs)
+{
+    Pending &slot = m_pending[static_cast<int>(sequence % static_cast<quint64>(m_pending.size()))];
+
+    if (slot.pending)
+    {
+        ++m_lost;
+    }
+
+    slot.sequence = sequence;
+    slot.txUs = txUs;
+    slot.pending = true;
+}
+
+void CANObjects::LatencyProbe::onSignal(const DecodedSignal &signal)
+{
+    if (signal.signal == m_signal)
+    {
+        onReceived(signal.raw, signal.timestampUs, nowUs());
+    }
+}
+
+void CANObjects::LatencyProbe::onReceived(quint64 sequence, qint64 rxUs, qint64 decodedUs)
+{
+    Pending &slot = m_pending[static_cast<int>(sequence % static_cast<quint64>(m_pending.size()))];
+
+    if (!slot.pending || slot.sequence != sequence)
+    {
+        ++m_unmatched;
+        return;
+    }
+
+    slot.pending = false;
+
+    m_txToRx.record(rxUs - slot.txUs);
+    m_rxToDecode.record(decodedUs - rxUs);
+    m_txToDecode.record(decodedUs - slot.txUs);
+}
+
+const CANObjects::LatencyHistogram &CANObjects::LatencyProbe::txToRx() const
+{
+    return m_txToRx;
+}
+
+const CANObjects::LatencyHistogram &CANObjects::LatencyProbe::rxToDecode() const
+{
+    return m_rxToDecode;
+}
+
+const CANObjects::LatencyHistogram &CANObjects::LatencyProbe::txToDecode() const
+{
+    return m_txToDecode;
+}
+
+quint64 CANObjects::LatencyProbe::lost() const
+{
+    return m_lost;
+}
+
+quint64 CANObjects::LatencyProbe::unmatched() const
+{
+    return m_unmatched;
+}
+
+void CANObjects::LatencyProbe::reset()
+{
+    m_txToRx.reset();
+    m_rxToDecode.reset();
+    m_txToDecode.reset();
+    m_lost = 0;
+    m_unmatched = 0;
+}
+
+qint64 CANObjects::LatencyProbe::nowUs()
+{
+    //same clock as kernel receive timestamps
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+}
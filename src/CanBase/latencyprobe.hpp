@@ -0,0 +1,93 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include "canbase_global.hpp"
+
+#include "latencyhistogram.hpp"
+#include "signaldecoder.hpp"
+
+#include <QVector>
+
+namespace CANObjects {
+
+/*
+ * Latency from TX write to RX decode.
+ *
+ * TX writes nextSequence() into the probe signal and reports the write time
+ * with onSent(). On RX the decoded sequence is matched to its TX time and
+ * three latencies are recorded: TX to kernel receive timestamp, kernel
+ * receive to decode completion and TX to decode completion.
+ *
+ * All times are realtime microseconds, as the kernel stamps received frames.
+ * Meant for loopback (vcan or own frames received back) where TX and RX share
+ * the clock.
+ */
+class CANBASESHARED_EXPORT LatencyProbe : public SignalSink
+{
+public:
+    LatencyProbe(int signal, int counterBits, int capacity = 4096);
+
+    int signal() const;
+
+    quint64 nextSequence();
+    void onSent(quint64 sequence, qint64 txUs);
+
+    void onSignal(const DecodedSignal &signal) override;
+    void onReceived(quint64 sequence, qint64 rxUs, qint64 decodedUs);
+
+    const LatencyHistogram &txToRx() const;
+    const LatencyHistogram &rxToDecode() const;
+    const LatencyHistogram &txToDecode() const;
+
+    //sent but overwritten before a match, received without a pending send
+    quint64 lost() const;
+    quint64 unmatched() const;
+
+    void reset();
+
+    static qint64 nowUs();
+
+private:
+    struct Pending
+    {
+        quint64 sequence = 0;
+        qint64 txUs = 0;
+        bool pending = false;
+    };
+
+    int m_signal = -1;
+    quint64 m_counterMask = 0;
+    quint64 m_nextSequence = 0;
+
+    QVector<Pending> m_pending;
+
+    LatencyHistogram m_txToRx;
+    LatencyHistogram m_rxToDecode;
+    LatencyHistogram m_txToDecode;
+
+    quint64 m_lost = 0;
+    quint64 m_unmatched = 0;
+};
+
+}
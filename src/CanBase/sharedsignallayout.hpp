@@ -0,0 +1,115 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+/*
+ * Memory layout of the shared signal segment.
+ *
+ * Plain C++ without Qt, readers in other processes include only this file
+ * and sharedsignalreader.hpp. Entries are guarded by per entry sequence
+ * counters, a reader retries while the sequence is odd or changed, up to
+ * MaxReadSpins times. ready is cleared before the writer unmaps the segment.
+ *
+ * [Header][SignalEntry x signalCount][FrameEntry x frameCount]
+ */
+
+namespace CANObjects {
+namespace SharedSignals {
+
+constexpr uint32_t Magic = 0x43414E4F; // "CANO"
+constexpr uint32_t Version = 1;
+constexpr int NameSize = 64;
+constexpr int MaxReadSpins = 1 << 16;   //odd or changed sequences a reader retries before giving up
+
+enum class ValueType : uint32_t
+{
+    Invalid = 0,
+    Bool = 1,
+    Int = 2,
+    UInt = 3,
+    Float = 4,
+    Double = 5,
+    Int64 = 6,
+    UInt64 = 7,
+};
+
+struct alignas(64) Header
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t layoutHash;    //changes with any change of signal names, types, ranges or scaling
+    uint32_t signalCount;
+    uint32_t frameCount;
+    uint64_t signalOffset;
+    uint64_t frameOffset;
+    uint64_t totalSize;
+    std::atomic<uint32_t> ready;
+};
+
+struct alignas(64) SignalEntry
+{
+    char name[NameSize];
+    uint32_t type;
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint64_t> raw;
+    std::atomic<uint64_t> value;    //bits of the double value
+    std::atomic<int64_t> timestampUs;
+};
+
+struct alignas(64) FrameEntry
+{
+    uint32_t frameID;
+    std::atomic<uint32_t> sequence;
+    std::atomic<uint64_t> payload;  //big endian word, byte 0 is the most significant
+    std::atomic<int64_t> timestampUs;
+    std::atomic<uint32_t> size;
+};
+
+static_assert(std::atomic<uint64_t>::is_always_lock_free, "shared segment needs lock free 64bit atomics");
+
+inline void beginWrite(std::atomic<uint32_t> &sequence)
+{
+    sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+}
+
+inline void endWrite(std::atomic<uint32_t> &sequence)
+{
+    sequence.store(sequence.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+//spin wait hint, the sibling hyperthread keeps running while a reader retries
+inline void cpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+}
+}
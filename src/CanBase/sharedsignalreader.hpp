@@ -0,0 +1,224 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include "sharedsignallayout.hpp"
+
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace CANObjects {
+namespace SharedSignals {
+
+struct SignalValue
+{
+    uint64_t raw = 0;
+    double value = 0.0;
+    int64_t timestampUs = 0;
+};
+
+struct FrameValue
+{
+    uint32_t frameID = 0;
+    uint64_t payload = 0;
+    uint32_t size = 0;
+    int64_t timestampUs = 0;
+};
+
+/*
+ * Header only reader of the segment published by SharedSignalWriter.
+ *
+ * After open() every read is a plain load from the mapping, no syscalls
+ * and no allocation.
+ */
+class Reader
+{
+public:
+    Reader() {}
+    ~Reader() { close(); }
+
+    Reader(const Reader &) = delete;
+    Reader &operator=(const Reader &) = delete;
+
+    //expectedHash 0 accepts any layout
+    bool open(const char *name, uint64_t expectedHash = 0)
+    {
+        close();
+
+        const int fd = shm_open(name, O_RDONLY, 0);
+
+        if (fd < 0)
+        {
+            return false;
+        }
+
+        struct stat st;
+
+        if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(Header))
+        {
+            ::close(fd);
+            return false;
+        }
+
+        void *mem = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+
+        if (mem == MAP_FAILED)
+        {
+            return false;
+        }
+
+        m_memory = mem;
+        m_size = static_cast<size_t>(st.st_size);
+        m_header = static_cast<const Header *>(mem);
+
+        if (m_header->magic != Magic || m_header->version != Version || m_header->totalSize > m_size
+                || m_header->ready.load(std::memory_order_acquire) == 0
+                || (expectedHash != 0 && m_header->layoutHash != expectedHash))
+        {
+            close();
+            return false;
+        }
+
+        m_signals = reinterpret_cast<const SignalEntry *>(static_cast<const char *>(mem) + m_header->signalOffset);
+        m_frames = reinterpret_cast<const FrameEntry *>(static_cast<const char *>(mem) + m_header->frameOffset);
+
+        return true;
+    }
+
+    void close()
+    {
+        if (m_memory)
+        {
+            munmap(m_memory, m_size);
+        }
+
+        m_memory = nullptr;
+        m_size = 0;
+        m_header = nullptr;
+        m_signals = nullptr;
+        m_frames = nullptr;
+    }
+
+    bool isOpen() const { return m_header != nullptr; }
+    //false once the writer closed the segment, values stay readable but are no longer updated
+    bool isReady() const { return m_header && m_header->ready.load(std::memory_order_acquire) != 0; }
+    uint64_t layoutHash() const { return m_header->layoutHash; }
+    int signalCount() const { return static_cast<int>(m_header->signalCount); }
+    int frameCount() const { return static_cast<int>(m_header->frameCount); }
+
+    const char *signalName(int index) const { return m_signals[index].name; }
+    ValueType signalType(int index) const { return static_cast<ValueType>(m_signals[index].type); }
+
+    //resolve once, then read by index
+    int indexOf(const char *name) const
+    {
+        for (int i = 0; i < signalCount(); ++i)
+        {
+            if (std::strncmp(m_signals[i].name, name, NameSize) == 0)
+            {
+                return i;
+            }
+        }
+
+        return -1;
+    }
+
+    //false until the signal was published at least once, or while a write does not finish within MaxReadSpins retries
+    bool read(int index, SignalValue &out) const
+    {
+        const SignalEntry &entry = m_signals[index];
+
+        for (int spin = 0; spin < MaxReadSpins; ++spin)
+        {
+            const uint32_t begin = entry.sequence.load(std::memory_order_acquire);
+
+            if (begin & 1u)
+            {
+                cpuRelax();
+                continue;
+            }
+
+            out.raw = entry.raw.load(std::memory_order_relaxed);
+            const uint64_t bits = entry.value.load(std::memory_order_relaxed);
+            out.timestampUs = entry.timestampUs.load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (entry.sequence.load(std::memory_order_relaxed) == begin)
+            {
+                std::memcpy(&out.value, &bits, sizeof(out.value));
+                return begin != 0;
+            }
+
+            cpuRelax();
+        }
+
+        return false;
+    }
+
+    bool readFrame(int index, FrameValue &out) const
+    {
+        const FrameEntry &entry = m_frames[index];
+
+        for (int spin = 0; spin < MaxReadSpins; ++spin)
+        {
+            const uint32_t begin = entry.sequence.load(std::memory_order_acquire);
+
+            if (begin & 1u)
+            {
+                cpuRelax();
+                continue;
+            }
+
+            out.payload = entry.payload.load(std::memory_order_relaxed);
+            out.size = entry.size.load(std::memory_order_relaxed);
+            out.timestampUs = entry.timestampUs.load(std::memory_order_relaxed);
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+
+            if (entry.sequence.load(std::memory_order_relaxed) == begin)
+            {
+                out.frameID = entry.frameID;
+                return begin != 0;
+            }
+
+            cpuRelax();
+        }
+
+        return false;
+    }
+
+private:
+    void *m_memory = nullptr;
+    size_t m_size = 0;
+    const Header *m_header = nullptr;
+    const SignalEntry *m_signals = nullptr;
+    const FrameEntry *m_frames = nullptr;
+};
+
+}
+}
@@ -0,0 +1,293 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "sharedsignalwriter.hpp"
+
+#include "framesnapshottable.hpp"
+
+#include <QDebug>
+
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <sys/mman.h>
+#include <unistd.h>
+
+CANObjects::SharedSignalWriter::SharedSignalWriter(const QVector<CanObject> &objects) :
+    m_objects(objects)
+  , m_dispatcher(objects)
+  , m_frameIDs(m_dispatcher.frameIDs())
+{
+    std::sort(m_frameIDs.begin(), m_frameIDs.end());
+    m_frameIndex = FrameIndex(m_frameIDs);
+}
+
+CANObjects::SharedSignalWriter::~SharedSignalWriter()
+{
+    close();
+}
+
+bool CANObjects::SharedSignalWriter::open(const QString &name)
+{
+    using namespace SharedSignals;
+
+    close();
+
+    const uint64_t signalOffset = sizeof(Header);
+    const uint64_t frameOffset = signalOffset + sizeof(SignalEntry) * static_cast<uint64_t>(m_objects.size());
+    const uint64_t totalSize = frameOffset + sizeof(FrameEntry) * static_cast<uint64_t>(m_frameIDs.size());
+
+    const QByteArray shmName = name.toLocal8Bit();
+
+    //readers still holding the old segment keep their mapping
+    shm_unlink(shmName.constData());
+
+    const int fd = shm_open(shmName.constData(), O_CREAT | O_RDWR, 0644);
+
+    if (fd < 0)
+    {
+        qWarning() << "could not create shared memory" << name;
+        return false;
+    }
+
+    if (ftruncate(fd, static_cast<off_t>(totalSize)) != 0)
+    {
+        qWarning() << "could not resize shared memory" << name;
+        ::close(fd);
+        return false;
+    }
+
+    void *mem = mmap(nullptr, totalSize, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+
+    if (mem == MAP_FAILED)
+    {
+        qWarning() << "could not map shared memory" << name;
+        return false;
+    }
+
+    m_name = name;
+    m_memory = mem;
+    m_size = totalSize;
+
+    char *base = static_cast<char *>(mem);
+    Header *header = new (base) Header;
+    header->ready.store(0, std::memory_order_relaxed);
+    header->magic = Magic;
+    header->version = Version;
+    header->layoutHash = layoutHash(m_objects);
+    header->signalCount = static_cast<uint32_t>(m_objects.size());
+    header->frameCount = static_cast<uint32_t>(m_frameIDs.size());
+    header->signalOffset = signalOffset;
+    header->frameOffset = frameOffset;
+    header->totalSize = totalSize;
+
+    m_signals = reinterpret_cast<SignalEntry *>(base + signalOffset);
+    m_frames = reinterpret_cast<FrameEntry *>(base + frameOffset);
+
+    for (int i = 0; i < m_objects.size(); ++i)
+    {
+        SignalEntry *entry = new (&m_signals[i]) SignalEntry;
+        std::memset(entry->name, 0, NameSize);
+        const QByteArray signalName = m_objects[i].getName().toUtf8().left(NameSize - 1);
+        std::memcpy(entry->name, signalName.constData(), static_cast<size_t>(signalName.size()));
+        entry->type = static_cast<uint32_t>(valueType(m_objects[i].getType()));
+        entry->sequence.store(0, std::memory_order_relaxed);
+        entry->raw.store(0, std::memory_order_relaxed);
+        entry->value.store(0, std::memory_order_relaxed);
+        entry->timestampUs.store(0, std::memory_order_relaxed);
+    }
+
+    for (int i = 0; i < m_frameIDs.size(); ++i)
+    {
+        FrameEntry *entry = new (&m_frames[i]) FrameEntry;
+        entry->frameID = m_frameIDs[i];
+        entry->sequence.store(0, std::memory_order_relaxed);
+        entry->payload.store(0, std::memory_order_relaxed);
+        entry->timestampUs.store(0, std::memory_order_relaxed);
+        entry->size.store(0, std::memory_order_relaxed);
+    }
+
+    header->ready.store(1, std::memory_order_release);
+
+    return true;
+}
+
+void CANObjects::SharedSignalWriter::close()
+{
+    if (m_memory)
+    {
+        //readers keep their mapping after the unlink, tell them nothing is written anymore
+        static_cast<SharedSignals::Header *>(m_memory)->ready.store(0, std::memory_order_release);
+        munmap(m_memory, m_size);
+        shm_unlink(m_name.toLocal8Bit().constData());
+    }
+
+    m_memory = nullptr;
+    m_size = 0;
+    m_signals = nullptr;
+    m_frames = nullptr;
+}
+
+bool CANObjects::SharedSignalWriter::isOpen() const
+{
+    return m_memory != nullptr;
+}
+
+void CANObjects::SharedSignalWriter::publish(const QCanBusFrame &frame)
+{
+    if (!m_memory)
+    {
+        return;
+    }
+
+    const int slot = m_frameIndex.slotOf(frame.frameId());
+
+    if (slot < 0)
+    {
+        return;
+    }
+
+    const qint64 timestampUs = FrameSnapshotTable::timestampUs(frame);
+    const QByteArray payload = frame.payload();
+
+    SharedSignals::FrameEntry &entry = m_frames[slot];
+    SharedSignals::beginWrite(entry.sequence);
+    entry.payload.store(payloadToWord(payload), std::memory_order_relaxed);
+    entry.timestampUs.store(timestampUs, std::memory_order_relaxed);
+    entry.size.store(static_cast<uint32_t>(payload.size()), std::memory_order_relaxed);
+    SharedSignals::endWrite(entry.sequence);
+
+    for (const int signal : m_dispatcher.plainSignalsOf(frame.frameId()))
+    {
+        publishSignal(signal, timestampUs);
+    }
+
+    for (const int signal : m_dispatcher.muxSignalsOf(frame.frameId(), payloadToWord(payload)))
+    {
+        publishSignal(signal, timestampUs);
+    }
+}
+
+void CANObjects::SharedSignalWriter::publish(const QHash<quint32, QCanBusFrame> &frames)
+{
+    for (const QCanBusFrame &frame : frames)
+    {
+        publish(frame);
+    }
+}
+
+quint64 CANObjects::SharedSignalWriter::layoutHash(const QVector<CanObject> &objects)
+{
+    //FNV-1a
+    quint64 hash = Q_UINT64_C(14695981039346656037);
+
+    auto mix = [&hash](const void *data, size_t size)
+    {
+        const quint8 *bytes = static_cast<const quint8 *>(data);
+
+        for (size_t i = 0; i < size; ++i)
+        {
+            hash ^= bytes[i];
+            hash *= Q_UINT64_C(1099511628211);
+        }
+    };
+
+    const quint32 version = SharedSignals::Version;
+    mix(&version, sizeof(version));
+
+    for (const CanObject &obj : objects)
+    {
+        const QByteArray name = obj.getName().toUtf8();
+        mix(name.constData(), static_cast<size_t>(name.size()));
+
+        const quint32 type = static_cast<quint32>(obj.getType());
+        mix(&type, sizeof(type));
+
+        //published values are physical, readers depend on the scaling too
+        const double scaling[2] = {obj.getFactor(), obj.getOffset()};
+        mix(scaling, sizeof(scaling));
+
+        for (const FrameRange &range : obj.getRanges())
+        {
+            const quint32 fields[4] = {range.frameID, range.byteID.value(), range.startBit.value(), range.endBit.value()};
+            mix(fields, sizeof(fields));
+        }
+    }
+
+    return hash;
+}
+
+void CANObjects::SharedSignalWriter::publishSignal(int signal, qint64 timestampUs)
+{
+    const CanObject &obj = m_objects[signal];
+    const QVector<FrameRange> &ranges = obj.getRanges();
+
+    //only this process writes the frame entries, they are read without seqlock
+    quint64 raw = 0;
+
+    for (int i = 0; i < ranges.size(); ++i)
+    {
+        const SharedSignals::FrameEntry &frame = m_frames[m_frameIndex.slotOf(ranges[i].frameID)];
+
+        if (frame.sequence.load(std::memory_order_relaxed) == 0)
+        {
+            return;
+        }
+
+        raw |= ranges[i].extract(frame.payload.load(std::memory_order_relaxed)) << obj.getRangeOffset(i);
+    }
+
+    const double value = obj.decodeDouble(raw);
+    quint64 valueBits = 0;
+    std::memcpy(&valueBits, &value, sizeof(valueBits));
+
+    SharedSignals::SignalEntry &entry = m_signals[signal];
+    SharedSignals::beginWrite(entry.sequence);
+    entry.raw.store(raw, std::memory_order_relaxed);
+    entry.value.store(valueBits, std::memory_order_relaxed);
+    entry.timestampUs.store(timestampUs, std::memory_order_relaxed);
+    SharedSignals::endWrite(entry.sequence);
+}
+
+CANObjects::SharedSignals::ValueType CANObjects::SharedSignalWriter::valueType(QMetaType::Type type)
+{
+    switch (type) {
+    case QMetaType::Type::Bool:
+        return SharedSignals::ValueType::Bool;
+    case QMetaType::Type::Int:
+        return SharedSignals::ValueType::Int;
+    case QMetaType::Type::UInt:
+        return SharedSignals::ValueType::UInt;
+    case QMetaType::Type::LongLong:
+        return SharedSignals::ValueType::Int64;
+    case QMetaType::Type::ULongLong:
+        return SharedSignals::ValueType::UInt64;
+    case QMetaType::Type::Float:
+        return SharedSignals::ValueType::Float;
+    case QMetaType::Type::Double:
+        return SharedSignals::ValueType::Double;
+    default:
+        return SharedSignals::ValueType::Invalid;
+    }
+}
@@ -0,0 +1,78 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include "canbase_global.hpp"
+
+#include "canobject.hpp"
+#include "framedispatcher.hpp"
+#include "frameindex.hpp"
+#include "sharedsignallayout.hpp"
+
+#include <QCanBusFrame>
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+namespace CANObjects {
+
+/*
+ * Publishes decoded signals and latest raw frames into a POSIX shared memory
+ * segment, other processes map it with SharedSignals::Reader.
+ */
+class CANBASESHARED_EXPORT SharedSignalWriter
+{
+public:
+    explicit SharedSignalWriter(const QVector<CanObject> &objects);
+    ~SharedSignalWriter();
+
+    SharedSignalWriter(const SharedSignalWriter &) = delete;
+    SharedSignalWriter &operator=(const SharedSignalWriter &) = delete;
+
+    //name has to start with '/', existing segment of the same name is replaced
+    bool open(const QString &name);
+    void close();
+    bool isOpen() const;
+
+    void publish(const QCanBusFrame &frame);
+    void publish(const QHash<quint32, QCanBusFrame> &frames);
+
+    static quint64 layoutHash(const QVector<CanObject> &objects);
+
+private:
+    QVector<CanObject> m_objects;
+    FrameDispatcher m_dispatcher;
+    QVector<quint32> m_frameIDs;
+    FrameIndex m_frameIndex;
+
+    QString m_name;
+    void *m_memory = nullptr;
+    size_t m_size = 0;
+    SharedSignals::SignalEntry *m_signals = nullptr;
+    SharedSignals::FrameEntry *m_frames = nullptr;
+
+    void publishSignal(int signal, qint64 timestampUs);
+    static SharedSignals::ValueType valueType(QMetaType::Type type);
+};
+
+}
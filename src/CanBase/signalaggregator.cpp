@@ -0,0 +1,197 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "signalaggregator.hpp"
+
+#include <algorithm>
+
+double CANObjects::WindowRecord::mean() const
+{
+    return count ? sum / count : 0.0;
+}
+
+CANObjects::SignalAggregator::SignalAggregator(int signalCount, qint64 windowUs, int panes) :
+    m_panesPerWindow(std::max(1, panes))
+  , m_hopUs(std::max<qint64>(1, windowUs / std::max(1, panes)))
+{
+    m_panes.resize(signalCount * m_panesPerWindow);
+    m_states.resize(signalCount);
+    m_records.reserve(signalCount * 2);
+}
+
+void CANObjects::SignalAggregator::setEnabled(int signal, bool enabled)
+{
+    m_states[signal].enabled = enabled;
+}
+
+void CANObjects::SignalAggregator::onSignal(const DecodedSignal &signal)
+{
+    add(signal.signal, signal.value, signal.timestampUs);
+}
+
+void CANObjects::SignalAggregator::add(int signal, double value, qint64 timestampUs)
+{
+    SignalState &state = m_states[signal];
+
+    if (!state.enabled)
+    {
+        return;
+    }
+
+    const qint64 paneIndex = paneIndexOf(timestampUs);
+
+    if (paneIndex > state.currentPane)
+    {
+        advance(signal, paneIndex);
+    }
+    else if (paneIndex < state.currentPane)
+    {
+        //out of order sample, accounted to the open pane
+        ++m_lateSamples;
+    }
+
+    Pane &p = pane(signal, state.currentPane);
+
+    if (p.count == 0)
+    {
+        p.min = value;
+        p.max = value;
+        p.sum = 0.0;
+    }
+    else
+    {
+        p.min = std::min(p.min, value);
+        p.max = std::max(p.max, value);
+    }
+
+    ++p.count;
+    p.sum += value;
+    p.last = value;
+}
+
+void CANObjects::SignalAggregator::flush(qint64 nowUs)
+{
+    const qint64 paneIndex = paneIndexOf(nowUs);
+
+    for (int signal = 0; signal < m_states.size(); ++signal)
+    {
+        if (m_states[signal].currentPane >= 0 && paneIndex > m_states[signal].currentPane)
+        {
+            advance(signal, paneIndex);
+        }
+    }
+}
+
+void CANObjects::SignalAggregator::takeRecords(QVector<WindowRecord> &records)
+{
+    records.clear();
+    records.swap(m_records);
+}
+
+qint64 CANObjects::SignalAggregator::windowUs() const
+{
+    return m_hopUs * m_panesPerWindow;
+}
+
+qint64 CANObjects::SignalAggregator::hopUs() const
+{
+    return m_hopUs;
+}
+
+quint64 CANObjects::SignalAggregator::lateSamples() const
+{
+    return m_lateSamples;
+}
+
+CANObjects::SignalAggregator::Pane &CANObjects::SignalAggregator::pane(int signal, qint64 paneIndex)
+{
+    return m_panes[signal * m_panesPerWindow + static_cast<int>(paneIndex % m_panesPerWindow)];
+}
+
+qint64 CANObjects::SignalAggregator::paneIndexOf(qint64 timestampUs) const
+{
+    return timestampUs >= 0 ? timestampUs / m_hopUs : 0;
+}
+
+void CANObjects::SignalAggregator::advance(int signal, qint64 paneIndex)
+{
+    SignalState &state = m_states[signal];
+
+    if (state.currentPane >= 0)
+    {
+        //every closed pane ends one window, after a full window of empty panes nothing is left to emit
+        const qint64 last = std::min(paneIndex - 1, state.currentPane + m_panesPerWindow - 1);
+
+        for (qint64 closed = state.currentPane; closed <= last; ++closed)
+        {
+            emitWindow(signal, closed);
+
+            Pane &next = pane(signal, closed + 1);
+            next.index = closed + 1;
+            next.count = 0;
+        }
+    }
+
+    Pane &current = pane(signal, paneIndex);
+
+    if (current.index != paneIndex)
+    {
+        current.index = paneIndex;
+        current.count = 0;
+    }
+
+    state.currentPane = paneIndex;
+}
+
+void CANObjects::SignalAggregator::emitWindow(int signal, qint64 lastPane)
+{
+    WindowRecord record;
+    record.signal = signal;
+    record.startUs = (lastPane - m_panesPerWindow + 1) * m_hopUs;
+    record.endUs = (lastPane + 1) * m_hopUs;
+
+    for (qint64 index = lastPane - m_panesPerWindow + 1; index <= lastPane; ++index)
+    {
+        if (index < 0)
+        {
+            continue;
+        }
+
+        const Pane &p = pane(signal, index);
+
+        if (p.index != index || p.count == 0)
+        {
+            continue;
+        }
+
+        record.min = record.count ? std::min(record.min, p.min) : p.min;
+        record.max = record.count ? std::max(record.max, p.max) : p.max;
+        record.count += p.count;
+        record.sum += p.sum;
+        record.last = p.last;
+    }
+
+    if (record.count)
+    {
+        m_records.push_back(record);
+    }
+}
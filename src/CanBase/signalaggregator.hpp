@@ -0,0 +1,106 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include "canbase_global.hpp"
+
+#include "signaldecoder.hpp"
+
+#include <QVector>
+
+namespace CANObjects {
+
+struct CANBASESHARED_EXPORT WindowRecord
+{
+    int signal = -1;
+    qint64 startUs = 0;
+    qint64 endUs = 0;
+    quint32 count = 0;
+    double min = 0.0;
+    double max = 0.0;
+    double sum = 0.0;
+    double last = 0.0;
+
+    double mean() const;
+};
+
+/*
+ * Streaming count/min/max/sum/last of decoded signals in time windows.
+ *
+ * A window consists of panes of windowUs/panes length. One pane gives
+ * tumbling windows, more panes a sliding window advancing by one pane.
+ * All panes are allocated up front, a record is emitted every time a pane
+ * of a signal closes.
+ */
+class CANBASESHARED_EXPORT SignalAggregator : public SignalSink
+{
+public:
+    SignalAggregator(int signalCount, qint64 windowUs, int panes = 1);
+
+    void setEnabled(int signal, bool enabled);
+
+    void onSignal(const DecodedSignal &signal) override;
+    void add(int signal, double value, qint64 timestampUs);
+
+    //closes panes that ended before nowUs, for signals that stopped updating
+    void flush(qint64 nowUs);
+
+    //swaps emitted records into records, keeps both buffers allocated
+    void takeRecords(QVector<WindowRecord> &records);
+
+    qint64 windowUs() const;
+    qint64 hopUs() const;
+    quint64 lateSamples() const;
+
+private:
+    struct Pane
+    {
+        qint64 index = -1;
+        quint32 count = 0;
+        double min = 0.0;
+        double max = 0.0;
+        double sum = 0.0;
+        double last = 0.0;
+    };
+
+    struct SignalState
+    {
+        qint64 currentPane = -1;
+        bool enabled = true;
+    };
+
+    int m_panesPerWindow = 1;
+    qint64 m_hopUs = 1;
+    quint64 m_lateSamples = 0;
+
+    QVector<Pane> m_panes;  //m_panesPerWindow panes per signal, ring indexed by pane index
+    QVector<SignalState> m_states;
+    QVector<WindowRecord> m_records;
+
+    Pane &pane(int signal, qint64 paneIndex);
+    qint64 paneIndexOf(qint64 timestampUs) const;
+    void advance(int signal, qint64 paneIndex);
+    void emitWindow(int signal, qint64 lastPane);
+};
+
+}
@@ -0,0 +1,535 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "signaldecoder.hpp"
+
+#include "framesnapshottable.hpp"
+
+#include <algorithm>
+
+CANObjects::SignalDecoder::SignalDecoder(const QVector<CanObject> &objects) :
+    m_objects(objects)
+  , m_dispatcher(objects)
+{
+    m_readBegin.reserve(m_objects.size() + 1);
+
+    QHash<quint32, int> frameSlot;
+    QVector<quint32> frameIDs;
+
+    for (const CanObject &obj : m_objects)
+    {
+        m_readBegin.push_back(m_reads.size());
+
+        const QVector<FrameRange> &ranges = obj.getRanges();
+        bool singleFrame = true;
+
+        for (int i = 0; i < ranges.size(); ++i)
+        {
+            const FrameRange &range = ranges[i];
+
+            auto it = frameSlot.find(range.frameID);
+
+            if (it == frameSlot.end())
+            {
+                it = frameSlot.insert(range.frameID, m_payloads.size());
+                frameIDs.push_back(range.frameID);
+                m_payloads.push_back(0);
+                m_seen.push_back(false);
+            }
+
+            RangeRead read;
+            read.slot = it.value();
+            singleFrame &= m_reads.size() == m_readBegin.last() || m_reads.last().slot == read.slot;
+            read.mask = range.mask();
+            read.shift = range.shift();
+            read.offset = obj.getRangeOffset(i);
+            m_reads.push_back(read);
+        }
+
+        m_singleFrame.push_back(singleFrame);
+    }
+
+    m_readBegin.push_back(m_reads.size());
+    m_frameIndex = FrameIndex(frameIDs);
+}
+
+void CANObjects::SignalDecoder::addSink(SignalSink *sink)
+{
+    if (!m_sinks.contains(sink))
+    {
+        m_sinks.push_back(sink);
+        m_latestOnly.push_back(sink->latestOnly());
+        m_allLatestOnly = !m_latestOnly.contains(false);
+    }
+}
+
+void CANObjects::SignalDecoder::removeSink(SignalSink *sink)
+{
+    const int i = m_sinks.indexOf(sink);
+
+    if (i >= 0)
+    {
+        m_sinks.remove(i);
+        m_latestOnly.remove(i);
+        m_allLatestOnly = !m_sinks.isEmpty() && !m_latestOnly.contains(false);
+    }
+}
+
+void CANObjects::SignalDecoder::setProtection(E2EProtection *protection)
+{
+    m_protection = protection;
+}
+
+void CANObjects::SignalDecoder::setSupervisor(FrameSupervisor *supervisor)
+{
+    m_supervisor = supervisor;
+}
+
+void CANObjects::SignalDecoder::expire(qint64 nowUs)
+{
+    if (!m_supervisor)
+    {
+        return;
+    }
+
+    m_timedOut.clear();
+    m_supervisor->advance(nowUs, m_timedOut);
+
+    //last values of the dependent signals are passed on once more, marked stale
+    for (const quint32 frameID : m_timedOut)
+    {
+        const int slot = m_frameIndex.slotOf(frameID);
+
+        if (slot < 0 || !m_seen[slot])
+        {
+            continue;
+        }
+
+        const auto emitStale = [&](const QVector<int> &signalList) {
+            for (const int signal : signalList)
+            {
+                DecodedSignal decoded;
+
+                if (!readRaw(signal, decoded.raw))
+                {
+                    continue;
+                }
+
+                decoded.signal = signal;
+                decoded.bus = m_bus;
+                decoded.value = m_objects[signal].decodeDouble(decoded.raw);
+                decoded.timestampUs = nowUs;
+                decoded.stale = true;
+
+                for (SignalSink *sink : m_sinks)
+                {
+                    if (sink->wantsStale())
+                    {
+                        sink->onSignal(decoded);
+                    }
+                }
+            }
+        };
+
+        emitStale(m_dispatcher.plainSignalsOf(frameID));
+        emitStale(m_dispatcher.muxSignalsOf(frameID, m_payloads[slot]));
+    }
+}
+
+void CANObjects::SignalDecoder::setBus(int bus)
+{
+    m_bus = bus;
+}
+
+void CANObjects::SignalDecoder::setPool(DecodePool *pool, int minSignals)
+{
+    m_pool = pool;
+    m_minParallelSignals = minSignals;
+}
+
+void CANObjects::SignalDecoder::decode(const QCanBusFrame &frame)
+{
+    decode(frame.frameId(), payloadToWord(frame.payload()), FrameSnapshotTable::timestampUs(frame));
+}
+
+void CANObjects::SignalDecoder::decode(quint32 frameID, quint64 payload, qint64 timestampUs)
+{
+    decodeFrame(frameID, payload, timestampUs, true);
+}
+
+void CANObjects::SignalDecoder::decode(const QVector<QCanBusFrame> &frames)
+{
+    qint64 timestampUs = 0;
+
+    if (m_pool)
+    {
+        beginJobs();
+
+        for (const QCanBusFrame &frame : frames)
+        {
+            timestampUs = FrameSnapshotTable::timestampUs(frame);
+            addJobs(frame.frameId(), payloadToWord(frame.payload()), timestampUs, true);
+        }
+
+        runJobs(timestampUs);
+        return;
+    }
+
+    for (const QCanBusFrame &frame : frames)
+    {
+        timestampUs = FrameSnapshotTable::timestampUs(frame);
+        decode(frame.frameId(), payloadToWord(frame.payload()), timestampUs);
+    }
+
+    for (SignalSink *sink : m_sinks)
+    {
+        sink->onBatchEnd(timestampUs);
+    }
+}
+
+void CANObjects::SignalDecoder::decode(const FrameBatch &batch)
+{
+    //E2E counters have to see every occurrence
+    const bool skipOlder = m_allLatestOnly && !m_protection;
+    qint64 timestampUs = 0;
+
+    if (m_pool)
+    {
+        beginJobs();
+    }
+
+    for (int i = 0; i < batch.size(); ++i)
+    {
+        const FrameRecord &record = batch.at(i);
+        const bool latest = batch.isLatest(i);
+
+        if (!latest && skipOlder)
+        {
+            continue;
+        }
+
+        timestampUs = record.timestampUs;
+
+        if (m_pool)
+        {
+            addJobs(record.frameID, record.payload, record.timestampUs, latest);
+        }
+        else
+        {
+            decodeFrame(record.frameID, record.payload, record.timestampUs, latest);
+        }
+    }
+
+    if (m_pool)
+    {
+        runJobs(timestampUs);
+        return;
+    }
+
+    for (SignalSink *sink : m_sinks)
+    {
+        sink->onBatchEnd(timestampUs);
+    }
+}
+
+const QVector<CANObjects::CanObject> &CANObjects::SignalDecoder::objects() const
+{
+    return m_objects;
+}
+
+const CANObjects::FrameDispatcher &CANObjects::SignalDecoder::dispatcher() const
+{
+    return m_dispatcher;
+}
+
+int CANObjects::SignalDecoder::indexOf(const QString &name) const
+{
+    for (int i = 0; i < m_objects.size(); ++i)
+    {
+        if (m_objects[i].getName() == name)
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+void CANObjects::SignalDecoder::decodeFrame(quint32 frameID, quint64 payload, qint64 timestampUs, bool latest)
+{
+    if (!storePayload(frameID, payload, timestampUs))
+    {
+        return;
+    }
+
+    for (const int signal : m_dispatcher.plainSignalsOf(frameID))
+    {
+        decodeSignal(signal, timestampUs, latest);
+    }
+
+    for (const int signal : m_dispatcher.muxSignalsOf(frameID, payload))
+    {
+        decodeSignal(signal, timestampUs, latest);
+    }
+}
+
+void CANObjects::SignalDecoder::decodeSignal(int signal, qint64 timestampUs, bool latest)
+{
+    quint64 raw = 0;
+
+    if (!readRaw(signal, raw))
+    {
+        return;
+    }
+
+    DecodedSignal decoded;
+    decoded.signal = signal;
+    decoded.bus = m_bus;
+    decoded.raw = raw;
+    decoded.value = m_objects[signal].decodeDouble(raw);
+    decoded.timestampUs = timestampUs;
+    decoded.stale = isStale(signal);
+
+    for (int i = 0; i < m_sinks.size(); ++i)
+    {
+        if (latest || !m_latestOnly[i])
+        {
+            m_sinks[i]->onSignal(decoded);
+        }
+    }
+}
+
+bool CANObjects::SignalDecoder::readRaw(int signal, quint64 &raw) const
+{
+    raw = 0;
+
+    for (int i = m_readBegin[signal]; i < m_readBegin[signal + 1]; ++i)
+    {
+        const RangeRead &read = m_reads[i];
+
+        //other frame of the signal was not received yet
+        if (!m_seen[read.slot])
+        {
+            return false;
+        }
+
+        raw |= ((m_payloads[read.slot] & read.mask) >> read.shift) << read.offset;
+    }
+
+    return true;
+}
+
+quint64 CANObjects::SignalDecoder::rawOf(int signal, quint64 payload) const
+{
+    quint64 raw = 0;
+
+    for (int i = m_readBegin[signal]; i < m_readBegin[signal + 1]; ++i)
+    {
+        const RangeRead &read = m_reads[i];
+        raw |= ((payload & read.mask) >> read.shift) << read.offset;
+    }
+
+    return raw;
+}
+
+quint64 CANObjects::SignalDecoder::rawOf(int signal, const quint64 *payloads) const
+{
+    quint64 raw = 0;
+    const int begin = m_readBegin[signal];
+
+    for (int i = begin; i < m_readBegin[signal + 1]; ++i)
+    {
+        const RangeRead &read = m_reads[i];
+        raw |= ((payloads[i - begin] & read.mask) >> read.shift) << read.offset;
+    }
+
+    return raw;
+}
+
+bool CANObjects::SignalDecoder::isStale(int signal) const
+{
+    //the frame being decoded was just received, only other frames can be timed out
+    if (!m_supervisor || m_singleFrame[signal] || m_supervisor->timedOutCount() == 0)
+    {
+        return false;
+    }
+
+    for (int i = m_readBegin[signal]; i < m_readBegin[signal + 1]; ++i)
+    {
+        if (m_supervisor->isTimedOut(m_frameIndex.frameIDs()[m_reads[i].slot]))
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+bool CANObjects::SignalDecoder::storePayload(quint32 frameID, quint64 payload, qint64 timestampUs)
+{
+    const int slot = m_frameIndex.slotOf(frameID);
+
+    if (slot < 0)
+    {
+        return false;
+    }
+
+    if (m_protection && E2EProtection::isCorrupted(m_protection->check(frameID, payload)))
+    {
+        return false;
+    }
+
+    if (m_supervisor)
+    {
+        m_supervisor->onFrame(frameID, timestampUs);
+    }
+
+    m_payloads[slot] = payload;
+    m_seen[slot] = true;
+
+    return true;
+}
+
+void CANObjects::SignalDecoder::beginJobs()
+{
+    m_jobCount = 0;
+    m_snapshots.clear();
+}
+
+void CANObjects::SignalDecoder::addJobs(quint32 frameID, quint64 payload, qint64 timestampUs, bool latest)
+{
+    //payload state is sequential, jobs capture the payloads they read
+    if (!storePayload(frameID, payload, timestampUs))
+    {
+        return;
+    }
+
+    const auto add = [&](const QVector<int> &signalList) {
+        for (const int signal : signalList)
+        {
+            Job &job = appendJob();
+            job.decoded.signal = signal;
+            job.decoded.bus = m_bus;
+            job.decoded.timestampUs = timestampUs;
+            job.decoded.stale = isStale(signal);
+            job.payload = payload;
+            job.snapshot = -1;
+            job.latest = latest;
+            job.valid = true;
+
+            //signals spanning frames copy the current payload of every read
+            if (!m_singleFrame[signal])
+            {
+                job.snapshot = static_cast<int>(m_snapshots.size());
+
+                for (int i = m_readBegin[signal]; i < m_readBegin[signal + 1]; ++i)
+                {
+                    const int slot = m_reads[i].slot;
+
+                    if (!m_seen[slot])
+                    {
+                        job.valid = false;
+                        break;
+                    }
+
+                    m_snapshots.push_back(m_payloads[slot]);
+                }
+            }
+        }
+    };
+
+    add(m_dispatcher.plainSignalsOf(frameID));
+    add(m_dispatcher.muxSignalsOf(frameID, payload));
+}
+
+void CANObjects::SignalDecoder::runJobs(qint64 timestampUs)
+{
+    const int chunks = (m_jobCount + ChunkJobs - 1) / ChunkJobs;
+
+    if (m_jobCount >= m_minParallelSignals)
+    {
+        m_pool->run(chunks, [this](int chunk) { decodeChunk(chunk); });
+    }
+    else
+    {
+        for (int chunk = 0; chunk < chunks; ++chunk)
+        {
+            decodeChunk(chunk);
+        }
+    }
+
+    //sinks are not thread safe, results are passed on in frame order
+    for (int i = 0; i < m_jobCount; ++i)
+    {
+        const Job &job = m_chunks[static_cast<size_t>(i / ChunkJobs)].jobs[i % ChunkJobs];
+
+        if (!job.valid)
+        {
+            continue;
+        }
+
+        for (int sink = 0; sink < m_sinks.size(); ++sink)
+        {
+            if (job.latest || !m_latestOnly[sink])
+            {
+                m_sinks[sink]->onSignal(job.decoded);
+            }
+        }
+    }
+
+    for (SignalSink *sink : m_sinks)
+    {
+        sink->onBatchEnd(timestampUs);
+    }
+}
+
+CANObjects::SignalDecoder::Job &CANObjects::SignalDecoder::appendJob()
+{
+    const size_t chunk = static_cast<size_t>(m_jobCount / ChunkJobs);
+
+    //grows to the largest batch seen, reused afterwards
+    if (chunk == m_chunks.size())
+    {
+        m_chunks.emplace_back();
+    }
+
+    return m_chunks[chunk].jobs[m_jobCount++ % ChunkJobs];
+}
+
+void CANObjects::SignalDecoder::decodeChunk(int chunk)
+{
+    JobChunk &jobs = m_chunks[static_cast<size_t>(chunk)];
+    const int count = std::min(ChunkJobs, m_jobCount - chunk * ChunkJobs);
+
+    for (int i = 0; i < count; ++i)
+    {
+        Job &job = jobs.jobs[i];
+
+        //only const access to shared state, nothing may detach on the workers
+        if (job.valid)
+        {
+            job.decoded.raw = job.snapshot < 0 ? rawOf(job.decoded.signal, job.payload) :
+                                                 rawOf(job.decoded.signal, m_snapshots.data() + job.snapshot);
+            job.decoded.value = m_objects.at(job.decoded.signal).decodeDouble(job.decoded.raw);
+        }
+    }
+}
@@ -0,0 +1,176 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include "canbase_global.hpp"
+
+#include "canobject.hpp"
+#include "decodepool.hpp"
+#include "e2eprotection.hpp"
+#include "framebatch.hpp"
+#include "framedispatcher.hpp"
+#include "framesupervisor.hpp"
+#include "frameindex.hpp"
+
+#include <QCanBusFrame>
+#include <QHash>
+#include <QVector>
+
+#include <vector>
+
+namespace CANObjects {
+
+struct CANBASESHARED_EXPORT DecodedSignal
+{
+    int signal = -1;
+    quint64 raw = 0;
+    double value = 0.0;
+    qint64 timestampUs = 0;
+    bool stale = false;     //one of its frames timed out, value is the last one received
+    int bus = 0;            //index into Config::buses, signal indexes are per bus
+};
+
+//consumer of the decode loop, called on the decoding thread
+class CANBASESHARED_EXPORT SignalSink
+{
+public:
+    virtual ~SignalSink() {}
+
+    virtual void onSignal(const DecodedSignal &signal) = 0;
+    virtual void onBatchEnd(qint64 timestampUs) { Q_UNUSED(timestampUs) }
+
+    //only the last occurrence of a frame in a FrameBatch is decoded for this sink, asked once in addSink
+    virtual bool latestOnly() const { return false; }
+
+    //timed out signals replayed by expire() are passed only to sinks opting in
+    virtual bool wantsStale() const { return false; }
+};
+
+/*
+ * Decode loop over received frames.
+ *
+ * Keeps the latest payload of every configured frame, so signals spanning
+ * more frames are decoded whenever one of their frames arrives. Only signals
+ * dispatched for the frame (and its current mux layout) are decoded, every
+ * result is passed to all sinks. A FrameBatch is decoded per occurrence,
+ * sinks opting in to latestOnly() see only the last one of every frame.
+ */
+class CANBASESHARED_EXPORT SignalDecoder
+{
+public:
+    SignalDecoder(){}
+    explicit SignalDecoder(const QVector<CanObject> &objects);
+
+    void addSink(SignalSink *sink);
+    void removeSink(SignalSink *sink);
+
+    //frames failing their E2E check are dropped before decoding
+    void setProtection(E2EProtection *protection);
+
+    //received frames restart their deadline, expire() reports signals of timed out frames to wantsStale() sinks
+    void setSupervisor(FrameSupervisor *supervisor);
+    void expire(qint64 nowUs);
+
+    //stamped into every decoded signal
+    void setBus(int bus);
+
+    //batches touching at least minSignals signals are decoded on the pool
+    void setPool(DecodePool *pool, int minSignals = 512);
+
+    void decode(const QCanBusFrame &frame);
+    void decode(quint32 frameID, quint64 payload, qint64 timestampUs);
+    void decode(const QVector<QCanBusFrame> &frames);
+    void decode(const FrameBatch &batch);
+
+    const QVector<CanObject> &objects() const;
+    const FrameDispatcher &dispatcher() const;
+    int indexOf(const QString &name) const;
+
+private:
+    struct RangeRead
+    {
+        int slot = 0;
+        quint64 mask = 0;
+        quint8 shift = 0;
+        quint8 offset = 0;
+    };
+
+    QVector<CanObject> m_objects;
+    FrameDispatcher m_dispatcher;
+    QVector<SignalSink*> m_sinks;
+    QVector<bool> m_latestOnly;     //per sink
+    bool m_allLatestOnly = false;
+    E2EProtection *m_protection = nullptr;
+    FrameSupervisor *m_supervisor = nullptr;
+    QVector<quint32> m_timedOut;
+    int m_bus = 0;
+
+    //one job per decoded signal of a batch, chunks do not share cache lines
+    struct Job
+    {
+        DecodedSignal decoded;
+        quint64 payload = 0;    //frame of a single frame signal
+        int snapshot = -1;      //first of the copied payloads of a spanning signal, one per read
+        bool latest = true;
+        bool valid = false;
+    };
+
+    static constexpr int ChunkJobs = 16;
+
+    struct alignas(64) JobChunk
+    {
+        Job jobs[ChunkJobs];
+    };
+
+    DecodePool *m_pool = nullptr;
+    int m_minParallelSignals = 512;
+    std::vector<JobChunk> m_chunks;
+    std::vector<quint64> m_snapshots;
+    int m_jobCount = 0;
+
+    FrameIndex m_frameIndex;
+    QVector<quint64> m_payloads;
+    QVector<bool> m_seen;
+    QVector<bool> m_singleFrame;    //all ranges of the signal are in one frame
+
+    //reads of signal i are m_reads[m_readBegin[i]] .. m_reads[m_readBegin[i+1]-1]
+    QVector<int> m_readBegin;
+    QVector<RangeRead> m_reads;
+
+    void decodeFrame(quint32 frameID, quint64 payload, qint64 timestampUs, bool latest);
+    void decodeSignal(int signal, qint64 timestampUs, bool latest);
+    bool readRaw(int signal, quint64 &raw) const;
+    quint64 rawOf(int signal, quint64 payload) const;
+    quint64 rawOf(int signal, const quint64 *payloads) const;
+
+    bool isStale(int signal) const;
+
+    bool storePayload(quint32 frameID, quint64 payload, qint64 timestampUs);
+    void beginJobs();
+    void addJobs(quint32 frameID, quint64 payload, qint64 timestampUs, bool latest);
+    void runJobs(qint64 timestampUs);
+    Job &appendJob();
+    void decodeChunk(int chunk);
+};
+
+}
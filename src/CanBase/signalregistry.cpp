@@ -0,0 +1,113 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "signalregistry.hpp"
+
+CANObjects::SignalRegistry::SignalRegistry() :
+    m_current(std::make_shared<const SignalSet>())
+{
+
+}
+
+CANObjects::SignalRegistry::SignalRegistry(const Config &config) :
+    SignalRegistry()
+{
+    reload(config);
+}
+
+std::shared_ptr<const CANObjects::SignalSet> CANObjects::SignalRegistry::current() const
+{
+    return std::atomic_load(&m_current);
+}
+
+CANObjects::Config CANObjects::SignalRegistry::config() const
+{
+    return m_config;
+}
+
+CANObjects::ConfigDiff CANObjects::SignalRegistry::reload(const Config &config)
+{
+    const ConfigDiff diff = ConfigLoader::diff(m_config, config);
+
+    if (diff.isEmpty() && m_config.canObjects.size() == config.canObjects.size())
+    {
+        //only the order could differ, nothing to rebuild
+        bool sameOrder = true;
+
+        for (int i = 0; i < config.canObjects.size() && sameOrder; ++i)
+        {
+            sameOrder = m_config.canObjects[i].getName() == config.canObjects[i].getName();
+        }
+
+        if (sameOrder)
+        {
+            return diff;
+        }
+    }
+
+    std::shared_ptr<const SignalSet> next = build(config, *current(), diff);
+
+    m_config = config;
+    std::atomic_store(&m_current, next);
+
+    return diff;
+}
+
+std::shared_ptr<const CANObjects::SignalSet> CANObjects::SignalRegistry::build(const Config &config, const SignalSet &previous, const ConfigDiff &diff)
+{
+    auto next = std::make_shared<SignalSet>();
+    next->filter = config.filter;
+    next->objects.reserve(config.canObjects.size());
+
+    bool indicesKept = config.canObjects.size() == previous.objects.size();
+
+    for (int i = 0; i < config.canObjects.size(); ++i)
+    {
+        const CanObject &obj = config.canObjects[i];
+        const int oldIndex = previous.indexByName.value(obj.getName(), -1);
+
+        //unchanged decoders are taken over including their precomputed layout
+        if (oldIndex >= 0 && !diff.changedSignals.contains(obj.getName()))
+        {
+            next->objects.push_back(previous.objects[oldIndex]);
+        }
+        else
+        {
+            next->objects.push_back(obj);
+        }
+
+        next->indexByName.insert(obj.getName(), i);
+        indicesKept &= oldIndex == i;
+    }
+
+    if (indicesKept)
+    {
+        next->dispatcher = previous.dispatcher;
+        next->dispatcher.update(next->objects, diff.touchedFrames);
+    }
+    else
+    {
+        next->dispatcher = FrameDispatcher(next->objects);
+    }
+
+    return next;
+}
@@ -0,0 +1,73 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include "canbase_global.hpp"
+
+#include "canconfigloader.hpp"
+#include "canobject.hpp"
+#include "framedispatcher.hpp"
+
+#include <QHash>
+#include <QString>
+#include <QVector>
+
+#include <memory>
+
+namespace CANObjects {
+
+//immutable once published, readers keep their copy alive while decoding
+struct CANBASESHARED_EXPORT SignalSet
+{
+    QVector<CanObject> objects;
+    FrameDispatcher dispatcher;
+    QHash<QString, int> indexByName;
+    QCanBusDevice::Filter filter;
+};
+
+/*
+ * Holds the decoders of the current Config and swaps them on reload.
+ *
+ * reload() diffs the configs by signal name, reuses unchanged CanObjects and
+ * dispatch entries of untouched frames and publishes the result with one
+ * atomic pointer store. RX threads pick the new set up on their next batch.
+ */
+class CANBASESHARED_EXPORT SignalRegistry
+{
+public:
+    SignalRegistry();
+    explicit SignalRegistry(const Config &config);
+
+    std::shared_ptr<const SignalSet> current() const;
+    Config config() const;
+
+    ConfigDiff reload(const Config &config);
+
+private:
+    Config m_config;
+    std::shared_ptr<const SignalSet> m_current;
+
+    static std::shared_ptr<const SignalSet> build(const Config &config, const SignalSet &previous, const ConfigDiff &diff);
+};
+
+}
@@ -0,0 +1,247 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "signalruleengine.hpp"
+
+#include <cmath>
+#include <limits>
+
+namespace {
+
+qint64 toSigned(double value)
+{
+    if (value >= static_cast<double>(std::numeric_limits<qint64>::max()))
+    {
+        return std::numeric_limits<qint64>::max();
+    }
+
+    if (value <= static_cast<double>(std::numeric_limits<qint64>::min()))
+    {
+        return std::numeric_limits<qint64>::min();
+    }
+
+    return static_cast<qint64>(value);
+}
+
+quint64 toUnsigned(double value)
+{
+    if (value <= 0.0)
+    {
+        return 0;
+    }
+
+    if (value >= static_cast<double>(std::numeric_limits<quint64>::max()))
+    {
+        return std::numeric_limits<quint64>::max();
+    }
+
+    return static_cast<quint64>(value);
+}
+
+}
+
+CANObjects::SignalRuleEngine::SignalRuleEngine(const QVector<CanObject> &objects, bool useLimits) :
+    m_objects(objects)
+  , m_compiled(objects.size())
+{
+    if (!useLimits)
+    {
+        return;
+    }
+
+    for (int i = 0; i < m_objects.size(); ++i)
+    {
+        const CanObject &obj = m_objects[i];
+
+        if (obj.getType() == QMetaType::Type::Bool)
+        {
+            continue;
+        }
+
+        bool ok = false;
+        const double minVal = obj.getMinVal().toDouble(&ok);
+
+        if (ok && obj.getMinVal().isValid())
+        {
+            ThresholdRule rule;
+            rule.name = obj.getName() + " below minval";
+            rule.direction = ThresholdRule::Direction::Below;
+            rule.threshold = minVal;
+            addThreshold(i, rule);
+        }
+
+        const double maxVal = obj.getMaxVal().toDouble(&ok);
+
+        if (ok && obj.getMaxVal().isValid())
+        {
+            ThresholdRule rule;
+            rule.name = obj.getName() + " above maxval";
+            rule.direction = ThresholdRule::Direction::Above;
+            rule.threshold = maxVal;
+            addThreshold(i, rule);
+        }
+    }
+}
+
+int CANObjects::SignalRuleEngine::addThreshold(int signal, const ThresholdRule &rule)
+{
+    m_rules.push_back(rule);
+    m_active.push_back(false);
+    m_compiled[signal].push_back(compile(signal, m_rules.size() - 1));
+
+    return m_rules.size() - 1;
+}
+
+const CANObjects::ThresholdRule &CANObjects::SignalRuleEngine::rule(int rule) const
+{
+    return m_rules[rule];
+}
+
+bool CANObjects::SignalRuleEngine::isActive(int rule) const
+{
+    return m_active[rule];
+}
+
+void CANObjects::SignalRuleEngine::setFlightRecorder(FlightRecorder *recorder, const QString &directory, qint64 preUs, qint64 postUs)
+{
+    m_recorder = recorder;
+    m_dumpDirectory = directory;
+    m_dumpPreUs = preUs;
+    m_dumpPostUs = postUs;
+}
+
+void CANObjects::SignalRuleEngine::onSignal(const DecodedSignal &signal)
+{
+    for (const CompiledRule &compiled : m_compiled[signal.signal])
+    {
+        const bool active = m_active[compiled.rule];
+
+        if (check(compiled, signal, active) == active)
+        {
+            continue;
+        }
+
+        m_active[compiled.rule] = !active;
+
+        RuleViolation violation;
+        violation.signal = signal.signal;
+        violation.rule = compiled.rule;
+        violation.active = !active;
+        violation.value = signal.value;
+        violation.timestampUs = signal.timestampUs;
+        m_violations.push_back(violation);
+
+        //only transitions get here, the path is built once per raised violation
+        if (violation.active && m_recorder && m_rules[compiled.rule].dumpFlightRecorder)
+        {
+            const QString path = QStringLiteral("%1/flight-%2-%3.canflt").arg(m_dumpDirectory).arg(signal.timestampUs)
+                    .arg(m_rules[compiled.rule].name);
+            m_recorder->trigger(signal.timestampUs, m_dumpPreUs, m_dumpPostUs, path);
+        }
+    }
+}
+
+void CANObjects::SignalRuleEngine::takeViolations(QVector<RuleViolation> &violations)
+{
+    violations.clear();
+    violations.swap(m_violations);
+}
+
+CANObjects::SignalRuleEngine::CompiledRule CANObjects::SignalRuleEngine::compile(int signal, int rule) const
+{
+    const CanObject &obj = m_objects[signal];
+    const ThresholdRule &source = m_rules[rule];
+
+    CompiledRule compiled;
+    compiled.rule = rule;
+    compiled.above = source.direction == ThresholdRule::Direction::Above;
+
+    const double hysteresis = std::abs(source.hysteresis);
+    const double clear = compiled.above ? source.threshold - hysteresis : source.threshold + hysteresis;
+
+    //integers: v > t <=> v > floor(t), v < t <=> v < ceil(t)
+    const double raiseInt = compiled.above ? std::floor(source.threshold) : std::ceil(source.threshold);
+    const double clearInt = compiled.above ? std::ceil(clear) : std::floor(clear);
+
+    //thresholds of scaled signals are physical values, compared with the decoded value
+    switch (obj.isScaled() ? QMetaType::Type::Double : obj.getType()) {
+    case QMetaType::Type::Int:
+    case QMetaType::Type::LongLong:
+        compiled.domain = Domain::Signed;
+        compiled.signShift = static_cast<quint8>(obj.getSize() > 0 && obj.getSize() < 64 ? 64 - obj.getSize() : 0);
+        compiled.raiseSigned = toSigned(raiseInt);
+        compiled.clearSigned = toSigned(clearInt);
+        break;
+    case QMetaType::Type::UInt:
+    case QMetaType::Type::ULongLong:
+        compiled.domain = Domain::Unsigned;
+        compiled.raiseUnsigned = toUnsigned(raiseInt);
+        compiled.raiseAlways = compiled.above && raiseInt < 0.0;
+        compiled.clearUnsigned = toUnsigned(clearInt);
+        break;
+    default:
+        compiled.domain = Domain::Floating;
+        compiled.raiseFloating = source.threshold;
+        compiled.clearFloating = clear;
+        break;
+    }
+
+    return compiled;
+}
+
+bool CANObjects::SignalRuleEngine::check(const CompiledRule &compiled, const DecodedSignal &signal, bool active) const
+{
+    switch (compiled.domain) {
+    case Domain::Signed:
+    {
+        const qint64 value = static_cast<qint64>(signal.raw << compiled.signShift) >> compiled.signShift;
+
+        if (compiled.above)
+        {
+            return active ? value >= compiled.clearSigned : value > compiled.raiseSigned;
+        }
+
+        return active ? value <= compiled.clearSigned : value < compiled.raiseSigned;
+    }
+    case Domain::Unsigned:
+    {
+        const quint64 value = signal.raw;
+
+        if (compiled.above)
+        {
+            return active ? value >= compiled.clearUnsigned : (compiled.raiseAlways || value > compiled.raiseUnsigned);
+        }
+
+        //below 0 can never be raised for unsigned values
+        return active ? value <= compiled.clearUnsigned : (compiled.raiseUnsigned > 0 && value < compiled.raiseUnsigned);
+    }
+    case Domain::Floating:
+        if (compiled.above)
+        {
+            return active ? signal.value >= compiled.clearFloating : signal.value > compiled.raiseFloating;
+        }
+
+        return active ? signal.value <= compiled.clearFloating : signal.value < compiled.raiseFloating;
+    }
+
+    return active;
+}
@@ -0,0 +1,131 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include "canbase_global.hpp"
+
+#include "canobject.hpp"
+#include "flightrecorder.hpp"
+#include "signaldecoder.hpp"
+
+#include <QString>
+#include <QVector>
+
+namespace CANObjects {
+
+struct CANBASESHARED_EXPORT ThresholdRule
+{
+    enum class Direction
+    {
+        Above,
+        Below,
+    };
+
+    QString name;
+    Direction direction = Direction::Above;
+    double threshold = 0.0;
+    double hysteresis = 0.0;    //violation clears only after the value returns this far behind the threshold
+    bool dumpFlightRecorder = false;    //raising the violation triggers a dump, see SignalRuleEngine::setFlightRecorder()
+};
+
+struct CANBASESHARED_EXPORT RuleViolation
+{
+    int signal = -1;
+    int rule = -1;
+    bool active = false;    //false when the violation cleared
+    double value = 0.0;
+    qint64 timestampUs = 0;
+};
+
+/*
+ * Checks decoded values against minval/maxval of their CanObject and user
+ * thresholds with hysteresis.
+ *
+ * Rules are compiled to comparisons in the raw domain of the signal (signed,
+ * unsigned or floating) when added, the check in the decode loop is a couple
+ * of integer compares per rule. Only transitions are reported.
+ *
+ * Rules with dumpFlightRecorder trigger a dump of the frames around the
+ * raising sample, named after the rule, into the directory given to
+ * setFlightRecorder(). Limit rules never dump.
+ */
+class CANBASESHARED_EXPORT SignalRuleEngine : public SignalSink
+{
+public:
+    explicit SignalRuleEngine(const QVector<CanObject> &objects, bool useLimits = true);
+
+    //returns rule index used in RuleViolation
+    int addThreshold(int signal, const ThresholdRule &rule);
+
+    const ThresholdRule &rule(int rule) const;
+    bool isActive(int rule) const;
+
+    //dumps cover [raise - preUs, raise + postUs], the directory has to exist
+    void setFlightRecorder(FlightRecorder *recorder, const QString &directory, qint64 preUs, qint64 postUs);
+
+    void onSignal(const DecodedSignal &signal) override;
+
+    //swaps reported violations into violations, keeps both buffers allocated
+    void takeViolations(QVector<RuleViolation> &violations);
+
+private:
+    enum class Domain
+    {
+        Signed,
+        Unsigned,
+        Floating,
+    };
+
+    struct CompiledRule
+    {
+        int rule = -1;
+        Domain domain = Domain::Floating;
+        bool above = true;
+        quint8 signShift = 0;
+
+        //raise when beyond raise limit, clear when behind clear limit
+        qint64 raiseSigned = 0;
+        qint64 clearSigned = 0;
+        quint64 raiseUnsigned = 0;
+        quint64 clearUnsigned = 0;
+        bool raiseAlways = false;   //unsigned above a negative threshold, 0 exceeds it too
+        double raiseFloating = 0.0;
+        double clearFloating = 0.0;
+    };
+
+    QVector<CanObject> m_objects;
+    QVector<ThresholdRule> m_rules;
+    QVector<bool> m_active;
+    QVector<QVector<CompiledRule>> m_compiled;  //per signal
+    QVector<RuleViolation> m_violations;
+
+    FlightRecorder *m_recorder = nullptr;
+    QString m_dumpDirectory;
+    qint64 m_dumpPreUs = 0;
+    qint64 m_dumpPostUs = 0;
+
+    CompiledRule compile(int signal, int rule) const;
+    bool check(const CompiledRule &compiled, const DecodedSignal &signal, bool active) const;
+};
+
+}
@@ -0,0 +1,438 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "timestampingcansocket.hpp"
+
+#include <QSocketNotifier>
+
+#ifdef Q_OS_LINUX
+#include <net/if.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <linux/can.h>
+#include <linux/can/raw.h>
+#include <linux/errqueue.h>
+#include <linux/net_tstamp.h>
+#endif
+
+#include <vector>
+
+CANObjects::TimestampingCanSocket::TimestampingCanSocket(QObject *parent) :
+    QObject(parent)
+{
+
+}
+
+CANObjects::TimestampingCanSocket::~TimestampingCanSocket()
+{
+    close();
+}
+
+#ifdef Q_OS_LINUX
+
+namespace {
+
+constexpr int ControlSize = CMSG_SPACE(sizeof(scm_timestamping)) + CMSG_SPACE(sizeof(timeval));
+
+}
+
+bool CANObjects::TimestampingCanSocket::open(const QString &interface, const QList<QCanBusDevice::Filter> &filters)
+{
+    close();
+
+    m_socket = ::socket(PF_CAN, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, CAN_RAW);
+
+    if (m_socket < 0)
+    {
+        setError(QStringLiteral("socket"));
+        return false;
+    }
+
+    const int enable = 1;
+    ::setsockopt(m_socket, SOL_CAN_RAW, CAN_RAW_FD_FRAMES, &enable, sizeof(enable));
+
+    //hardware stamps need the driver to be configured (hwstamp_ctl), software stamps always work
+    const int flags = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE |
+                      SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE;
+    if (::setsockopt(m_socket, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) < 0)
+    {
+        ::setsockopt(m_socket, SOL_SOCKET, SO_TIMESTAMP, &enable, sizeof(enable));
+    }
+
+    if (!setFilters(filters))
+    {
+        close();
+        return false;
+    }
+
+    sockaddr_can address;
+    memset(&address, 0, sizeof(address));
+    address.can_family = AF_CAN;
+    address.can_ifindex = static_cast<int>(if_nametoindex(interface.toLatin1().constData()));
+
+    if (address.can_ifindex == 0 || ::bind(m_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0)
+    {
+        setError(QStringLiteral("bind ") + interface);
+        close();
+        return false;
+    }
+
+    m_frameBuffers.fill(0, BatchSize * static_cast<int>(sizeof(canfd_frame)));
+    m_controlBuffers.fill(0, BatchSize * ControlSize);
+    m_headers.fill(0, BatchSize * static_cast<int>(sizeof(mmsghdr)));
+    m_vectors.fill(0, BatchSize * static_cast<int>(sizeof(iovec)));
+    m_frames.reserve(BatchSize);
+
+    m_hardwareStamped = 0;
+    m_softwareStamped = 0;
+    m_source = Source::None;
+
+    m_notifier = new QSocketNotifier(m_socket, QSocketNotifier::Read, this);
+    connect(m_notifier, &QSocketNotifier::activated, this, &TimestampingCanSocket::onReadable);
+
+    return true;
+}
+
+void CANObjects::TimestampingCanSocket::close()
+{
+    delete m_notifier;
+    m_notifier = nullptr;
+
+    if (m_socket >= 0)
+    {
+        ::close(m_socket);
+        m_socket = -1;
+    }
+
+    m_frames.clear();
+    m_readIndex = 0;
+}
+
+bool CANObjects::TimestampingCanSocket::setFilters(const QList<QCanBusDevice::Filter> &filters)
+{
+    std::vector<can_filter> rawFilters;
+
+    for (const QCanBusDevice::Filter &filter : filters)
+    {
+        can_filter raw;
+        raw.can_id = filter.frameId;
+        raw.can_mask = filter.frameIdMask;
+
+        switch (filter.type)
+        {
+        case QCanBusFrame::RemoteRequestFrame:
+            raw.can_id |= CAN_RTR_FLAG;
+            raw.can_mask |= CAN_RTR_FLAG;
+            break;
+        case QCanBusFrame::DataFrame:
+            raw.can_mask |= CAN_RTR_FLAG;
+            break;
+        default:
+            break;
+        }
+
+        if (filter.format == QCanBusDevice::Filter::MatchBaseFormat)
+        {
+            raw.can_mask |= CAN_EFF_FLAG;
+        }
+        else if (filter.format == QCanBusDevice::Filter::MatchExtendedFormat)
+        {
+            raw.can_id |= CAN_EFF_FLAG;
+            raw.can_mask |= CAN_EFF_FLAG;
+        }
+
+        rawFilters.push_back(raw);
+    }
+
+    //no filter receives everything, same as QCanBusDevice
+    if (rawFilters.empty())
+    {
+        rawFilters.push_back({0, 0});
+    }
+
+    if (::setsockopt(m_socket, SOL_CAN_RAW, CAN_RAW_FILTER, rawFilters.data(),
+                     static_cast<socklen_t>(rawFilters.size() * sizeof(can_filter))) < 0)
+    {
+        setError(QStringLiteral("filter"));
+        return false;
+    }
+
+    return true;
+}
+
+bool CANObjects::TimestampingCanSocket::writeFrame(const QCanBusFrame &frame)
+{
+    if (m_socket < 0 || !frame.isValid())
+    {
+        return false;
+    }
+
+    canfd_frame raw;
+    memset(&raw, 0, sizeof(raw));
+
+    raw.can_id = frame.frameId();
+
+    if (frame.hasExtendedFrameFormat())
+    {
+        raw.can_id |= CAN_EFF_FLAG;
+    }
+
+    if (frame.frameType() == QCanBusFrame::RemoteRequestFrame)
+    {
+        raw.can_id |= CAN_RTR_FLAG;
+    }
+
+    const QByteArray payload = frame.payload();
+    raw.len = static_cast<__u8>(payload.size());
+    memcpy(raw.data, payload.constData(), static_cast<size_t>(payload.size()));
+
+    size_t size = CAN_MTU;
+
+    if (frame.hasFlexibleDataRateFormat())
+    {
+        size = CANFD_MTU;
+        raw.flags = (frame.hasBitrateSwitch() ? CANFD_BRS : 0) | (frame.hasErrorStateIndicator() ? CANFD_ESI : 0);
+    }
+
+    const ssize_t written = ::write(m_socket, &raw, size);
+
+    if (written != static_cast<ssize_t>(size))
+    {
+        if (errno != EAGAIN && errno != ENOBUFS)
+        {
+            setError(QStringLiteral("write"));
+        }
+
+        return false;
+    }
+
+    return true;
+}
+
+void CANObjects::TimestampingCanSocket::onReadable()
+{
+    canfd_frame *frames = reinterpret_cast<canfd_frame*>(m_frameBuffers.data());
+    mmsghdr *headers = reinterpret_cast<mmsghdr*>(m_headers.data());
+    iovec *vectors = reinterpret_cast<iovec*>(m_vectors.data());
+
+    //unread frames of the last batch are kept in front
+    m_frames.erase(m_frames.begin(), m_frames.begin() + m_readIndex);
+    m_readIndex = 0;
+
+    for (int i = 0; i < BatchSize; ++i)
+    {
+        vectors[i].iov_base = &frames[i];
+        vectors[i].iov_len = sizeof(canfd_frame);
+
+        headers[i].msg_hdr.msg_name = nullptr;
+        headers[i].msg_hdr.msg_namelen = 0;
+        headers[i].msg_hdr.msg_iov = &vectors[i];
+        headers[i].msg_hdr.msg_iovlen = 1;
+        headers[i].msg_hdr.msg_control = m_controlBuffers.data() + i * ControlSize;
+        headers[i].msg_hdr.msg_controllen = ControlSize;
+        headers[i].msg_hdr.msg_flags = 0;
+    }
+
+    const int count = ::recvmmsg(m_socket, headers, BatchSize, MSG_DONTWAIT, nullptr);
+
+    if (count <= 0)
+    {
+        if (count < 0 && errno != EAGAIN)
+        {
+            setError(QStringLiteral("recvmmsg"));
+        }
+
+        return;
+    }
+
+    for (int i = 0; i < count; ++i)
+    {
+        const canfd_frame &raw = frames[i];
+        const bool fd = headers[i].msg_len == CANFD_MTU;
+
+        QCanBusFrame frame;
+        frame.setExtendedFrameFormat(raw.can_id & CAN_EFF_FLAG);
+        frame.setFrameId(raw.can_id & (raw.can_id & CAN_EFF_FLAG ? CAN_EFF_MASK : CAN_SFF_MASK));
+        frame.setFlexibleDataRateFormat(fd);
+
+        if (raw.can_id & CAN_ERR_FLAG)
+        {
+            frame.setFrameType(QCanBusFrame::ErrorFrame);
+            frame.setError(QCanBusFrame::FrameErrors(QFlag(static_cast<int>(raw.can_id & CAN_ERR_MASK))));
+        }
+        else if (raw.can_id & CAN_RTR_FLAG)
+        {
+            frame.setFrameType(QCanBusFrame::RemoteRequestFrame);
+        }
+
+        if (fd)
+        {
+            frame.setBitrateSwitch(raw.flags & CANFD_BRS);
+            frame.setErrorStateIndicator(raw.flags & CANFD_ESI);
+        }
+
+        frame.setPayload(QByteArray(reinterpret_cast<const char*>(raw.data), raw.len));
+        frame.setLocalEcho(headers[i].msg_hdr.msg_flags & MSG_DONTROUTE);
+
+        //hardware stamp wins, software stamp otherwise
+        qint64 seconds = 0;
+        qint64 microSeconds = 0;
+        Source source = Source::None;
+
+        for (cmsghdr *cmsg = CMSG_FIRSTHDR(&headers[i].msg_hdr); cmsg; cmsg = CMSG_NXTHDR(&headers[i].msg_hdr, cmsg))
+        {
+            if (cmsg->cmsg_level != SOL_SOCKET)
+            {
+                continue;
+            }
+
+            if (cmsg->cmsg_type == SO_TIMESTAMPING)
+            {
+                scm_timestamping stamps;
+                memcpy(&stamps, CMSG_DATA(cmsg), sizeof(stamps));
+
+                //ts[0] software, ts[2] raw hardware
+                const bool hardware = stamps.ts[2].tv_sec != 0 || stamps.ts[2].tv_nsec != 0;
+                const timespec &stamp = hardware ? stamps.ts[2] : stamps.ts[0];
+
+                source = hardware ? Source::Hardware : Source::Software;
+                seconds = stamp.tv_sec;
+                microSeconds = stamp.tv_nsec / 1000;
+            }
+            else if (cmsg->cmsg_type == SO_TIMESTAMP)
+            {
+                timeval stamp;
+                memcpy(&stamp, CMSG_DATA(cmsg), sizeof(stamp));
+
+                source = Source::Software;
+                seconds = stamp.tv_sec;
+                microSeconds = stamp.tv_usec;
+            }
+        }
+
+        if (source == Source::Hardware)
+        {
+            ++m_hardwareStamped;
+        }
+        else if (source == Source::Software)
+        {
+            ++m_softwareStamped;
+        }
+
+        m_source = source;
+        frame.setTimeStamp(QCanBusFrame::TimeStamp(seconds, microSeconds));
+        m_frames.push_back(frame);
+    }
+
+    emit framesReceived();
+}
+
+void CANObjects::TimestampingCanSocket::setError(const QString &context)
+{
+    m_errorString = context + QStringLiteral(": ") + QString::fromLocal8Bit(strerror(errno));
+}
+
+#else
+
+bool CANObjects::TimestampingCanSocket::open(const QString &interface, const QList<QCanBusDevice::Filter> &filters)
+{
+    Q_UNUSED(interface)
+    Q_UNUSED(filters)
+
+    m_errorString = QStringLiteral("kernel timestamps need SocketCAN");
+    return false;
+}
+
+void CANObjects::TimestampingCanSocket::close()
+{
+    m_frames.clear();
+    m_readIndex = 0;
+}
+
+bool CANObjects::TimestampingCanSocket::setFilters(const QList<QCanBusDevice::Filter> &filters)
+{
+    Q_UNUSED(filters)
+    return false;
+}
+
+bool CANObjects::TimestampingCanSocket::writeFrame(const QCanBusFrame &frame)
+{
+    Q_UNUSED(frame)
+    return false;
+}
+
+void CANObjects::TimestampingCanSocket::onReadable()
+{
+
+}
+
+void CANObjects::TimestampingCanSocket::setError(const QString &context)
+{
+    m_errorString = context;
+}
+
+#endif
+
+bool CANObjects::TimestampingCanSocket::isOpen() const
+{
+    return m_socket >= 0;
+}
+
+QString CANObjects::TimestampingCanSocket::errorString() const
+{
+    return m_errorString;
+}
+
+qint64 CANObjects::TimestampingCanSocket::framesAvailable() const
+{
+    return m_frames.size() - m_readIndex;
+}
+
+QCanBusFrame CANObjects::TimestampingCanSocket::readFrame()
+{
+    if (m_readIndex >= m_frames.size())
+    {
+        return QCanBusFrame(QCanBusFrame::InvalidFrame);
+    }
+
+    return m_frames[m_readIndex++];
+}
+
+CANObjects::TimestampingCanSocket::Source CANObjects::TimestampingCanSocket::timestampSource() const
+{
+    return m_source;
+}
+
+quint64 CANObjects::TimestampingCanSocket::hardwareStamped() const
+{
+    return m_hardwareStamped;
+}
+
+quint64 CANObjects::TimestampingCanSocket::softwareStamped() const
+{
+    return m_softwareStamped;
+}
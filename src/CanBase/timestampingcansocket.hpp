@@ -0,0 +1,113 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include "canbase_global.hpp"
+
+#include <QCanBusDevice>
+#include <QCanBusFrame>
+#include <QObject>
+#include <QVector>
+
+class QSocketNotifier;
+
+namespace CANObjects {
+
+/*
+ * Raw SocketCAN socket receiving kernel timestamps.
+ *
+ * Every received frame carries the time it was stamped by the driver in
+ * QCanBusFrame::timeStamp(): SO_TIMESTAMPING raw hardware time when the
+ * controller provides it, kernel software time otherwise. Hardware time runs
+ * on the controller clock. Everything keyed off the frame timestamp sees
+ * arrival time instead of the time the event loop read the frame. Frames are
+ * read in batches with recvmmsg into preallocated buffers.
+ *
+ * Sends through the same socket, so own frames are not received back on vcan
+ * while frames of other local applications are.
+ *
+ * Linux only, open() fails elsewhere.
+ */
+class CANBASESHARED_EXPORT TimestampingCanSocket : public QObject
+{
+    Q_OBJECT
+
+public:
+    enum class Source
+    {
+        None,
+        Software,
+        Hardware
+    };
+
+    explicit TimestampingCanSocket(QObject *parent = nullptr);
+    ~TimestampingCanSocket();
+
+    bool open(const QString &interface, const QList<QCanBusDevice::Filter> &filters = {});
+    void close();
+    bool isOpen() const;
+
+    bool setFilters(const QList<QCanBusDevice::Filter> &filters);
+    QString errorString() const;
+
+    //false when the socket buffer is full
+    bool writeFrame(const QCanBusFrame &frame);
+
+    qint64 framesAvailable() const;
+    QCanBusFrame readFrame();
+
+    //source of the newest frame timestamp, counts since open
+    Source timestampSource() const;
+    quint64 hardwareStamped() const;
+    quint64 softwareStamped() const;
+
+signals:
+    void framesReceived();
+
+private slots:
+    void onReadable();
+
+private:
+    static constexpr int BatchSize = 64;
+
+    int m_socket = -1;
+    QSocketNotifier *m_notifier = nullptr;
+    QString m_errorString;
+
+    QVector<QCanBusFrame> m_frames;
+    int m_readIndex = 0;
+
+    //recvmmsg buffers, sized once in open()
+    QByteArray m_frameBuffers;
+    QByteArray m_controlBuffers;
+    QByteArray m_headers;
+    QByteArray m_vectors;
+
+    Source m_source = Source::None;
+    quint64 m_hardwareStamped = 0;
+    quint64 m_softwareStamped = 0;
+
+    void setError(const QString &context);
+};
+
+}
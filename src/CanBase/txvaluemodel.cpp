@@ -0,0 +1,175 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "txvaluemodel.hpp"
+
+#include <cmath>
+
+CANObjects::TxValueModel::TxValueModel(const QVector<CanObject> &objects) :
+    m_objects(objects)
+  , m_raw(objects.size(), 0)
+  , m_enabled(objects.size(), true)
+  , m_changed(objects.size(), false)
+{
+    m_changes.reserve(objects.size());
+}
+
+int CANObjects::TxValueModel::signalCount() const
+{
+    return m_objects.size();
+}
+
+bool CANObjects::TxValueModel::setText(int signal, const QString &text)
+{
+    bool ok = false;
+    QVariant value;
+    quint64 raw = 0;
+
+    const CanObject &obj = m_objects[signal];
+
+    if (obj.rawOfName(text, raw))
+    {
+        setRaw(signal, raw);
+        return true;
+    }
+
+    switch (obj.isScaled() ? QMetaType::Type::Double : obj.getType())
+    {
+    case QMetaType::Type::Float:
+        value = QVariant(text.toFloat(&ok));
+        break;
+    case QMetaType::Type::Double:
+        value = QVariant(text.toDouble(&ok));
+        break;
+    case QMetaType::Type::Bool:
+        value = QVariant(text.toInt(&ok) != 0);
+        break;
+    case QMetaType::Type::Int:
+        value = QVariant(static_cast<int>(std::nearbyint(text.toFloat(&ok))));
+        break;
+    case QMetaType::Type::UInt:
+        value = QVariant(static_cast<uint>(std::nearbyint(text.toFloat(&ok))));
+        break;
+    case QMetaType::Type::LongLong:
+        //exact integer text first, doubles lose precision above 2^53
+        value = QVariant(text.toLongLong(&ok));
+        if (!ok)
+        {
+            value = QVariant(static_cast<qlonglong>(std::nearbyint(text.toDouble(&ok))));
+        }
+        break;
+    case QMetaType::Type::ULongLong:
+        value = QVariant(text.toULongLong(&ok));
+        if (!ok)
+        {
+            value = QVariant(static_cast<qulonglong>(std::nearbyint(text.toDouble(&ok))));
+        }
+        break;
+    default:
+        break;
+    }
+
+    if (ok)
+    {
+        setValue(signal, value);
+    }
+
+    return ok;
+}
+
+void CANObjects::TxValueModel::setValue(int signal, const QVariant &value)
+{
+    setRaw(signal, m_objects[signal].encodeRaw(value));
+}
+
+void CANObjects::TxValueModel::setRaw(int signal, quint64 raw)
+{
+    if (m_raw[signal] != raw)
+    {
+        m_raw[signal] = raw;
+        markChanged(signal);
+    }
+}
+
+void CANObjects::TxValueModel::setEnabled(int signal, bool enabled)
+{
+    if (enabled && !m_enabled[signal])
+    {
+        markChanged(signal);
+    }
+
+    m_enabled[signal] = enabled;
+}
+
+bool CANObjects::TxValueModel::isEnabled(int signal) const
+{
+    return m_enabled[signal];
+}
+
+quint64 CANObjects::TxValueModel::raw(int signal) const
+{
+    return m_raw[signal];
+}
+
+QVariant CANObjects::TxValueModel::value(int signal) const
+{
+    return m_objects[signal].decodeRaw(m_raw[signal]);
+}
+
+void CANObjects::TxValueModel::applyChanges(FrameComposer &composer)
+{
+    for (const int signal : m_changes)
+    {
+        if (m_enabled[signal])
+        {
+            composer.writeRaw(signal, m_raw[signal]);
+        }
+
+        m_changed[signal] = false;
+    }
+
+    m_changes.clear();
+}
+
+void CANObjects::TxValueModel::applyAll(FrameComposer &composer)
+{
+    for (int signal = 0; signal < m_raw.size(); ++signal)
+    {
+        if (m_enabled[signal])
+        {
+            composer.writeRaw(signal, m_raw[signal]);
+        }
+
+        m_changed[signal] = false;
+    }
+
+    m_changes.clear();
+}
+
+void CANObjects::TxValueModel::markChanged(int signal)
+{
+    if (!m_changed[signal])
+    {
+        m_changed[signal] = true;
+        m_changes.push_back(signal);
+    }
+}
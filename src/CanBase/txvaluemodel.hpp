@@ -0,0 +1,78 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include "canbase_global.hpp"
+
+#include "canobject.hpp"
+#include "framecomposer.hpp"
+
+#include <QString>
+#include <QVariant>
+#include <QVector>
+
+namespace CANObjects {
+
+/*
+ * Values of TX signals, kept encoded.
+ *
+ * An edit is parsed in the type of the signal and encoded to its raw bits
+ * once, the send tick passes only changed raw values to the FrameComposer,
+ * which merges them into the frame payloads with its precomputed masks.
+ */
+class CANBASESHARED_EXPORT TxValueModel
+{
+public:
+    TxValueModel(){}
+    explicit TxValueModel(const QVector<CanObject> &objects);
+
+    int signalCount() const;
+
+    //false when text is no number, the previous value is kept
+    bool setText(int signal, const QString &text);
+    void setValue(int signal, const QVariant &value);
+    void setRaw(int signal, quint64 raw);
+
+    //disabled signals are not written, their bits stay in the frame
+    void setEnabled(int signal, bool enabled);
+    bool isEnabled(int signal) const;
+
+    quint64 raw(int signal) const;
+    QVariant value(int signal) const;
+
+    //writes enabled signals changed since the last call
+    void applyChanges(FrameComposer &composer);
+    //writes every enabled signal, for a new composer
+    void applyAll(FrameComposer &composer);
+
+private:
+    QVector<CanObject> m_objects;
+    QVector<quint64> m_raw;
+    QVector<bool> m_enabled;
+    QVector<bool> m_changed;
+    QVector<int> m_changes;     //signals with m_changed set
+
+    void markChanged(int signal);
+};
+
+}
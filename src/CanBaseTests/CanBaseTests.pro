@@ -20,9 +20,13 @@ QT       += testlib serialbus
 QT       -= gui
 
 TARGET = tst_canobjecttest
-CONFIG   += console c++14
+CONFIG   += console
 CONFIG   -= app_bundle
-CONFIG += c++17
+
+#C++20 for the coroutine API of AsyncSignalBus, needs GCC 8 or Clang 6 for -std=c++2a
+#testAsyncSignalWait runs from GCC 10 on and is skipped by compilers without coroutines
+CONFIG += c++2a
+gcc:!clang:equals(QMAKE_GCC_MAJOR_VERSION, 10): QMAKE_CXXFLAGS += -fcoroutines
 
 TEMPLATE = app
 
@@ -30,11 +34,16 @@ DEFINES += QT_DEPRECATED_WARNINGS
 DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
-        tst_canobjecttest.cpp
+        tst_canobjecttest.cpp \
+    ../CanGen/valuegenerator.cpp
+
+HEADERS += \
+    ../CanGen/valuegenerator.hpp
 
 unix:!macx: LIBS += -L$$OUT_PWD/../CanBase/ -lCanBase
+unix: LIBS += -lrt
 
-INCLUDEPATH += $$PWD/../CanBase
+INCLUDEPATH += $$PWD/../CanBase $$PWD/../CanGen
 DEPENDPATH += $$PWD/../CanBase
 
 RESOURCES += \
@@ -25,9 +25,73 @@
 
 #include <canobject.hpp>
 #include <framerange.hpp>
+#include <framecomposer.hpp>
+#include <framesnapshottable.hpp>
+#include <framedispatcher.hpp>
+#include <sharedsignalwriter.hpp>
+#include <sharedsignalreader.hpp>
+#include <signalregistry.hpp>
+#include <signaldecoder.hpp>
+#include <signalaggregator.hpp>
+#include <signalruleengine.hpp>
+#include <busloadestimator.hpp>
+#include <latencyprobe.hpp>
+#include <columnarexporter.hpp>
+#include <columnarreader.hpp>
+#include <asyncsignalbus.hpp>
+#include <e2eprotection.hpp>
+#include <cangateway.hpp>
+#include <isotptransport.hpp>
+#include <frameindex.hpp>
+#include <framebatch.hpp>
+#include <framesupervisor.hpp>
+#include <flightrecorder.hpp>
+#include <txvaluemodel.hpp>
+#include <canbusengine.hpp>
+#include <timestampingcansocket.hpp>
+#include <valuegenerator.hpp>
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
 
 using CANObjects::CanObject;
 using CANObjects::FrameRange;
+using CANObjects::FrameComposer;
+using CANObjects::FrameDispatcher;
+using CANObjects::FrameSnapshot;
+using CANObjects::FrameSnapshotTable;
+using CANObjects::SharedSignalWriter;
+using CANObjects::Config;
+using CANObjects::ConfigDiff;
+using CANObjects::SignalRegistry;
+using CANObjects::SignalDecoder;
+using CANObjects::SignalAggregator;
+using CANObjects::WindowRecord;
+using CANObjects::SignalRuleEngine;
+using CANObjects::ThresholdRule;
+using CANObjects::RuleViolation;
+using CANObjects::BusLoadEstimator;
+using CANObjects::LatencyHistogram;
+using CANObjects::LatencyProbe;
+using CANObjects::ColumnarExporter;
+using CANObjects::ColumnarReader;
+using CANObjects::AsyncSignalBus;
+using CANObjects::DecodedSignal;
+using CANObjects::E2EProfile;
+using CANObjects::E2EProtection;
+using CANObjects::IsoTpTransport;
+using CANObjects::FrameIndex;
+using CANObjects::FrameBatch;
+using CANObjects::FrameCycle;
+using CANObjects::FrameSupervisor;
+using CANObjects::FlightRecord;
+using CANObjects::FlightRecorder;
+using CANObjects::TxValueModel;
+using CANObjects::BusConfig;
+using CANObjects::CanBusEngine;
+using CANObjects::TimestampingCanSocket;
+using CANObjects::ValueGenerator;
 
 class CanObjectTest : public QObject
 {
@@ -55,6 +119,93 @@ private Q_SLOTS:
     void testWriteUintPartial();
     void testWriteFloat();
 
+    //composer
+    void testComposerMatchesWriteData();
+    void testComposerSendsOnChangeOrPeriod();
+
+    //snapshot table
+    void testSnapshotTableReadData();
+    void testSnapshotTableConsistentRead();
+
+    //shared memory
+    void testSharedSignalsRoundTrip();
+
+    //reload
+    void testRegistryReload();
+
+    //multiplexing
+    void testMultiplexedDispatch();
+
+    //aggregation
+    void testTumblingAggregation();
+    void testSlidingAggregation();
+
+    //rules
+    void testRuleEngineLimits();
+    void testRuleEngineHysteresis();
+
+    //value generator
+    void testValueGenerator();
+
+    //bus load
+    void testFrameBits();
+    void testBusLoad();
+
+    //latency
+    void testLatencyHistogram();
+    void testLatencyProbe();
+
+    //receive timestamps
+    void testTimestampingSocket();
+
+    //columnar export
+    void testColumnarRoundTrip();
+
+    //async waits
+    void testAsyncSignalWait();
+
+    //E2E protection
+    void testE2EProtection();
+
+    //parallel decode
+    void testParallelDecode();
+    void benchmarkParallelDecode_data();
+    void benchmarkParallelDecode();
+
+    //gateway
+    void testGatewayRouting();
+
+    //ISO-TP
+    void testIsoTp();
+
+    //frame index
+    void testFrameIndex();
+    void benchmarkFrameLookup_data();
+    void benchmarkFrameLookup();
+
+    //lossless batches
+    void testFrameBatch();
+
+    //timeout supervision
+    void testFrameSupervisor();
+
+    //flight recorder
+    void testFlightRecorder();
+
+    //TX values
+    void testTxValueModel();
+
+    //64-bit integers
+    void testReadLongLong();
+    void testWriteLongLongPartial();
+
+    //physical values
+    void testScaledSignals();
+
+    //multiple buses
+    void testBusConfig();
+    void testCanBusEngine();
+
 private:
     template <class T> QCanBusFrame prepareFrame(const T val, const quint32 canID) const;
     template <class T> T getFrameValue(const QCanBusFrame &frame) const;
@@ -321,6 +472,1835 @@ void CanObjectTest::testWriteFloat()
     QCOMPARE(getFrameValue<float>(outputFrames[frameID]),writeVal);
 }
 
+void CanObjectTest::testComposerMatchesWriteData()
+{
+    quint32 frameID = 1;
+
+    CanObject wheel("wheel",QMetaType::Type::UInt,{FrameRange(frameID,0,0,7),FrameRange(frameID,1,0,3)}, 0,4095);
+    CanObject blinker("blinker",QMetaType::Type::Bool,{FrameRange(frameID,3,1,1)}, false,true);
+    CanObject steering("steering",QMetaType::Type::Int,{FrameRange(frameID,4,0,7),FrameRange(frameID,5,0,7)}, -32768,32767);
+
+    QHash<quint32, QCanBusFrame> outputFrames;
+    wheel.writeData(QVariant(3000u),outputFrames);
+    blinker.writeData(QVariant(true),outputFrames);
+    steering.writeData(QVariant(-1234),outputFrames);
+
+    FrameComposer composer({wheel,blinker,steering});
+    composer.writeValue(0,QVariant(3000u));
+    composer.writeValue(1,QVariant(true));
+    composer.writeValue(2,QVariant(-1234));
+
+    QCOMPARE(composer.frame(frameID).payload(), outputFrames[frameID].payload());
+    QCOMPARE(steering.readData({{frameID,composer.frame(frameID)}}).toInt(), -1234);
+    QCOMPARE(wheel.readData({{frameID,composer.frame(frameID)}}).toUInt(), 3000u);
+}
+
+void CanObjectTest::testComposerSendsOnChangeOrPeriod()
+{
+    CanObject fast("fast",QMetaType::Type::UInt,{FrameRange(1,0,0,7)}, 0,255);
+    CanObject slow("slow",QMetaType::Type::UInt,{FrameRange(2,0,0,7)}, 0,255);
+
+    FrameComposer composer({fast,slow}, 100);
+    composer.setPeriod(2, 0);
+
+    QVector<QCanBusFrame> frames;
+    composer.writeValue(0,QVariant(1u));
+    composer.writeValue(1,QVariant(1u));
+    composer.compose(0,frames);
+    QCOMPARE(frames.size(), 2);
+
+    //nothing changed, period not elapsed
+    frames.clear();
+    composer.writeValue(0,QVariant(1u));
+    composer.compose(50,frames);
+    QCOMPARE(frames.size(), 0);
+
+    //period of frame 1 elapsed, frame 2 is on change only
+    frames.clear();
+    composer.compose(100,frames);
+    QCOMPARE(frames.size(), 1);
+    QCOMPARE(frames[0].frameId(), 1u);
+
+    frames.clear();
+    composer.writeValue(1,QVariant(2u));
+    composer.compose(120,frames);
+    QCOMPARE(frames.size(), 1);
+    QCOMPARE(frames[0].frameId(), 2u);
+}
+
+void CanObjectTest::testSnapshotTableReadData()
+{
+    FrameSnapshotTable table(16);
+
+    const int val = -100;
+    const QCanBusFrame frame = prepareFrame(val,1);
+
+    CanObject canObj("",QMetaType::Type::Int,{FrameRange(1,0,0,7),FrameRange(1,1,0,7),
+                                              FrameRange(1,2,0,7),FrameRange(1,3,0,7)}, 0,255);
+
+    QVERIFY(table.readData(canObj).isNull());
+
+    QVERIFY(table.write(frame));
+    QCOMPARE(table.readData(canObj).toInt(), val);
+    QCOMPARE(canObj.readData(table.snapshot({1})).toInt(), val);
+    QVERIFY(!table.snapshot({2}).contains(2));
+}
+
+void CanObjectTest::testSnapshotTableConsistentRead()
+{
+    FrameSnapshotTable table(16);
+    table.write(1, 0, 8, 0);
+
+    std::atomic<bool> stop(false);
+    std::atomic<int> torn(0);
+
+    std::thread reader([&table,&stop,&torn]()
+    {
+        FrameSnapshot snap;
+
+        while (!stop.load())
+        {
+            //payload and timestamp are written together
+            if (table.read(1, snap) && snap.payload != static_cast<quint64>(snap.timestampUs))
+            {
+                ++torn;
+            }
+        }
+    });
+
+    for (qint64 i = 1; i < 200000; ++i)
+    {
+        table.write(1, static_cast<quint64>(i), 8, i);
+    }
+
+    stop.store(true);
+    reader.join();
+
+    QCOMPARE(torn.load(), 0);
+}
+
+void CanObjectTest::testSharedSignalsRoundTrip()
+{
+    namespace Shm = CANObjects::SharedSignals;
+
+    const QVector<CanObject> objects = {
+        CanObject("gear",QMetaType::Type::UInt,{FrameRange(5,1,0,2)}, 0U,7U),
+        CanObject("steering",QMetaType::Type::Int,{FrameRange(6,0,0,7),FrameRange(6,1,0,7)}, -32768,32767)
+    };
+
+    SharedSignalWriter writer(objects);
+    QVERIFY(writer.open("/CanBaseTests"));
+
+    Shm::Reader reader;
+    QVERIFY(reader.open("/CanBaseTests", SharedSignalWriter::layoutHash(objects)));
+    QCOMPARE(reader.signalCount(), 2);
+    QCOMPARE(reader.frameCount(), 2);
+
+    const int steering = reader.indexOf("steering");
+    QCOMPARE(steering, 1);
+
+    Shm::SignalValue value;
+    QVERIFY(!reader.read(steering, value));
+
+    const int16_t val = -1234;
+    writer.publish(prepareFrame(val,6));
+
+    QVERIFY(reader.read(steering, value));
+    QCOMPARE(value.value, -1234.0);
+    QCOMPARE(reader.signalType(steering), Shm::ValueType::Int);
+
+    Shm::FrameValue frame;
+    QVERIFY(!reader.readFrame(0, frame));
+    QVERIFY(reader.readFrame(1, frame));
+    QCOMPARE(frame.frameID, 6u);
+
+    //closed writer, the mapping of the reader stays valid
+    QVERIFY(reader.isReady());
+    writer.close();
+    QVERIFY(!reader.isReady());
+    QVERIFY(reader.read(steering, value));
+    QCOMPARE(value.value, -1234.0);
+}
+
+void CanObjectTest::testRegistryReload()
+{
+    Config oldCfg;
+    oldCfg.canDeviceName = "vcan0";
+    oldCfg.canObjects = {
+        CanObject("gear",QMetaType::Type::UInt,{FrameRange(5,1,0,2)}, 0U,7U),
+        CanObject("brake",QMetaType::Type::UInt,{FrameRange(6,0,0,7)}, 0U,255U),
+        CanObject("horn",QMetaType::Type::Bool,{FrameRange(7,0,0,0)}, false,true)
+    };
+
+    SignalRegistry registry(oldCfg);
+    const std::shared_ptr<const CANObjects::SignalSet> before = registry.current();
+    QCOMPARE(before->dispatcher.signalsOf(6), QVector<int>({1}));
+
+    Config newCfg = oldCfg;
+    newCfg.canObjects[1] = CanObject("brake",QMetaType::Type::UInt,{FrameRange(8,0,0,7)}, 0U,255U);
+
+    const ConfigDiff diff = registry.reload(newCfg);
+    QCOMPARE(diff.changedSignals, QStringList({"brake"}));
+    QVERIFY(diff.addedSignals.isEmpty());
+    QVERIFY(diff.removedSignals.isEmpty());
+    QVERIFY(!diff.deviceChanged);
+    QCOMPARE(diff.addedFrames, QVector<quint32>({8}));
+    QCOMPARE(diff.removedFrames, QVector<quint32>({6}));
+
+    const std::shared_ptr<const CANObjects::SignalSet> after = registry.current();
+    QVERIFY(after != before);
+    QVERIFY(after->dispatcher.signalsOf(6).isEmpty());
+    QCOMPARE(after->dispatcher.signalsOf(8), QVector<int>({1}));
+    QCOMPARE(after->dispatcher.signalsOf(5), QVector<int>({0}));
+
+    //old set stays valid for readers still holding it
+    QCOMPARE(before->objects[1].getRanges().first().frameID, 6u);
+
+    //identical config does not publish a new set
+    QVERIFY(registry.reload(newCfg).isEmpty());
+    QVERIFY(registry.current() == after);
+}
+
+void CanObjectTest::testMultiplexedDispatch()
+{
+    const quint32 frameID = 7;
+
+    CanObject page("page",QMetaType::Type::UInt,{FrameRange(frameID,0,0,7)}, 0U,255U);
+    page.setMultiplexor(true);
+
+    CanObject temperature("temperature",QMetaType::Type::Int,{FrameRange(frameID,1,0,7),FrameRange(frameID,2,0,7)}, -40,215);
+    temperature.setMuxValue(1);
+    temperature.linkMultiplexor(page);
+
+    CanObject pressure("pressure",QMetaType::Type::UInt,{FrameRange(frameID,1,0,7),FrameRange(frameID,2,0,7)}, 0U,65535U);
+    pressure.setMuxValue(2);
+    pressure.linkMultiplexor(page);
+
+    const QVector<CanObject> objects = {page,temperature,pressure};
+
+    FrameComposer composer(objects);
+    composer.writeValue(2,QVariant(4000u));
+
+    const QCanBusFrame frame = composer.frame(frameID);
+    const quint64 word = CANObjects::payloadToWord(frame.payload());
+
+    QCOMPARE(page.readData({{frameID,frame}}).toUInt(), 2u);
+    QCOMPARE(pressure.readData({{frameID,frame}}).toUInt(), 4000u);
+    QVERIFY(temperature.readData({{frameID,frame}}).isNull());
+
+    FrameDispatcher dispatcher(objects);
+    QCOMPARE(dispatcher.signalsOf(frameID), QVector<int>({0,1,2}));
+    QCOMPARE(dispatcher.plainSignalsOf(frameID), QVector<int>({0}));
+    QCOMPARE(dispatcher.muxSignalsOf(frameID, word), QVector<int>({2}));
+    QVERIFY(dispatcher.muxSignalsOf(frameID, 0).isEmpty());
+
+    //writeData selects the layout as well
+    QHash<quint32, QCanBusFrame> outputFrames;
+    temperature.writeData(QVariant(-20),outputFrames);
+    QCOMPARE(page.readData(outputFrames).toUInt(), 1u);
+    QCOMPARE(temperature.readData(outputFrames).toInt(), -20);
+
+    //mux value without a multiplexor in its frame is a plain signal everywhere
+    CanObject orphan("orphan",QMetaType::Type::UInt,{FrameRange(9,0,0,7)}, 0U,255U);
+    orphan.setMuxValue(3);
+    QVERIFY(orphan.muxMatches(0));
+
+    outputFrames.clear();
+    orphan.writeData(QVariant(42u),outputFrames);
+    QCOMPARE(outputFrames.keys(), QList<quint32>({9u}));
+    QCOMPARE(orphan.readData(outputFrames).toUInt(), 42u);
+
+    FrameBatch batch;
+    batch.setIndex(FrameIndex({9}));
+    batch.append(9, CANObjects::payloadToWord(outputFrames[9].payload()), 8, 1);
+    QCOMPARE(batch.readData(orphan).toUInt(), 42u);
+}
+
+void CanObjectTest::testTumblingAggregation()
+{
+    CanObject speed("speed",QMetaType::Type::Int,{FrameRange(3,0,0,7)}, -128,127);
+
+    SignalDecoder decoder({speed});
+    SignalAggregator aggregator(1, 1000);
+    decoder.addSink(&aggregator);
+
+    const QVector<qint8> values = {5, -3, 10};
+
+    for (int i = 0; i < values.size(); ++i)
+    {
+        decoder.decode(3, CANObjects::payloadToWord(QByteArray(1, static_cast<char>(values[i]))), i * 300);
+    }
+
+    QVector<WindowRecord> records;
+    aggregator.takeRecords(records);
+    QVERIFY(records.isEmpty());
+
+    //first sample of the next window closes the previous one
+    decoder.decode(3, 0, 1000);
+    aggregator.takeRecords(records);
+
+    QCOMPARE(records.size(), 1);
+    QCOMPARE(records[0].startUs, Q_INT64_C(0));
+    QCOMPARE(records[0].endUs, Q_INT64_C(1000));
+    QCOMPARE(records[0].count, 3u);
+    QCOMPARE(records[0].min, -3.0);
+    QCOMPARE(records[0].max, 10.0);
+    QCOMPARE(records[0].sum, 12.0);
+    QCOMPARE(records[0].last, 10.0);
+
+    aggregator.flush(5000);
+    aggregator.takeRecords(records);
+    QCOMPARE(records.size(), 1);
+    QCOMPARE(records[0].count, 1u);
+    QCOMPARE(records[0].mean(), 0.0);
+}
+
+void CanObjectTest::testSlidingAggregation()
+{
+    //1000us window sliding by 500us
+    SignalAggregator aggregator(1, 1000, 2);
+
+    aggregator.add(0, 1.0, 100);
+    aggregator.add(0, 2.0, 600);
+    aggregator.add(0, 4.0, 1100);
+
+    QVector<WindowRecord> records;
+    aggregator.takeRecords(records);
+
+    QCOMPARE(records.size(), 2);
+    QCOMPARE(records[0].endUs, Q_INT64_C(500));
+    QCOMPARE(records[0].count, 1u);
+    QCOMPARE(records[1].startUs, Q_INT64_C(0));
+    QCOMPARE(records[1].endUs, Q_INT64_C(1000));
+    QCOMPARE(records[1].count, 2u);
+    QCOMPARE(records[1].max, 2.0);
+
+    aggregator.flush(1500);
+    aggregator.takeRecords(records);
+    QCOMPARE(records.size(), 1);
+    QCOMPARE(records[0].startUs, Q_INT64_C(500));
+    QCOMPARE(records[0].count, 2u);
+    QCOMPARE(records[0].sum, 6.0);
+}
+
+void CanObjectTest::testRuleEngineLimits()
+{
+    CanObject temperature("temperature",QMetaType::Type::Int,{FrameRange(3,0,0,7)}, -40,100);
+
+    SignalDecoder decoder({temperature});
+    SignalRuleEngine engine(decoder.objects());
+    decoder.addSink(&engine);
+
+    auto send = [&decoder](qint8 value, qint64 timestampUs)
+    {
+        decoder.decode(3, CANObjects::payloadToWord(QByteArray(1, static_cast<char>(value))), timestampUs);
+    };
+
+    send(20, 10);
+    send(-41, 20);
+    send(-45, 30);
+    send(101, 40);
+
+    QVector<RuleViolation> violations;
+    engine.takeViolations(violations);
+
+    QCOMPARE(violations.size(), 3);
+    QVERIFY(engine.rule(violations[0].rule).direction == ThresholdRule::Direction::Below);
+    QVERIFY(violations[0].active);
+    QCOMPARE(violations[0].value, -41.0);
+    QCOMPARE(violations[0].timestampUs, Q_INT64_C(20));
+    QVERIFY(!violations[1].active);
+    QCOMPARE(violations[1].timestampUs, Q_INT64_C(40));
+    QVERIFY(engine.rule(violations[2].rule).direction == ThresholdRule::Direction::Above);
+    QVERIFY(violations[2].active);
+
+    //every unsigned value is above a negative threshold, none below it
+    CanObject level("level",QMetaType::Type::UInt,{FrameRange(4,0,0,7)}, 0U,255U);
+    SignalRuleEngine unsignedEngine({level}, false);
+
+    ThresholdRule aboveNegative;
+    aboveNegative.threshold = -0.5;
+    const int above = unsignedEngine.addThreshold(0, aboveNegative);
+
+    ThresholdRule belowNegative = aboveNegative;
+    belowNegative.direction = ThresholdRule::Direction::Below;
+    const int below = unsignedEngine.addThreshold(0, belowNegative);
+
+    CANObjects::DecodedSignal zero;
+    zero.signal = 0;
+    zero.timestampUs = 50;
+    unsignedEngine.onSignal(zero);
+
+    QVERIFY(unsignedEngine.isActive(above));
+    QVERIFY(!unsignedEngine.isActive(below));
+}
+
+void CanObjectTest::testRuleEngineHysteresis()
+{
+    CanObject speed("speed",QMetaType::Type::UInt,{FrameRange(3,0,0,7)}, 0U,255U);
+
+    SignalRuleEngine engine({speed}, false);
+
+    ThresholdRule overspeed;
+    overspeed.threshold = 130.0;
+    overspeed.hysteresis = 5.0;
+    const int rule = engine.addThreshold(0, overspeed);
+
+    auto value = [](quint64 raw, qint64 timestampUs)
+    {
+        CANObjects::DecodedSignal decoded;
+        decoded.signal = 0;
+        decoded.raw = raw;
+        decoded.value = raw;
+        decoded.timestampUs = timestampUs;
+        return decoded;
+    };
+
+    engine.onSignal(value(130, 1));
+    QVERIFY(!engine.isActive(rule));
+    engine.onSignal(value(131, 2));
+    QVERIFY(engine.isActive(rule));
+    engine.onSignal(value(126, 3));
+    QVERIFY(engine.isActive(rule));
+    engine.onSignal(value(125, 4));
+    QVERIFY(engine.isActive(rule));
+    engine.onSignal(value(124, 5));
+    QVERIFY(!engine.isActive(rule));
+
+    QVector<RuleViolation> violations;
+    engine.takeViolations(violations);
+    QCOMPARE(violations.size(), 2);
+    QCOMPARE(violations[1].timestampUs, Q_INT64_C(5));
+}
+
+void CanObjectTest::testValueGenerator()
+{
+    CanObject speed("speed",QMetaType::Type::UInt,{FrameRange(1,0,0,7)}, 0,200);
+    CanObject steering("steering",QMetaType::Type::Int,{FrameRange(1,1,0,7)}, -100,100);
+
+    //ramp restarts every period
+    ValueGenerator ramp(speed, ValueGenerator::Mode::Ramp, 2.0);
+    QVERIFY(ramp.value(0.0).userType() == QMetaType::UInt);
+    QCOMPARE(ramp.value(0.0).toUInt(), 0u);
+    QCOMPARE(ramp.value(1.0).toUInt(), 100u);
+    QCOMPARE(ramp.value(1.5).toUInt(), 150u);
+    QCOMPARE(ramp.value(2.0).toUInt(), 0u);
+    QCOMPARE(ramp.value(3.0).toUInt(), 100u);
+
+    //sine starts in the middle, peaks after a quarter period
+    ValueGenerator sine(steering, ValueGenerator::Mode::Sine, 4.0);
+    QVERIFY(sine.value(0.0).userType() == QMetaType::Int);
+    QCOMPARE(sine.value(0.0).toInt(), 0);
+    QCOMPARE(sine.value(1.0).toInt(), 100);
+    QCOMPARE(sine.value(3.0).toInt(), -100);
+    QCOMPARE(sine.value(5.0).toInt(), 100);
+
+    //random stays within minval and maxval, seeded by the signal name
+    ValueGenerator random(steering, ValueGenerator::Mode::Random, 1.0);
+    ValueGenerator sameSeed(steering, ValueGenerator::Mode::Random, 1.0);
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        const int value = random.value(i).toInt();
+        QVERIFY(value >= -100);
+        QVERIFY(value <= 100);
+        QCOMPARE(sameSeed.value(i).toInt(), value);
+    }
+
+    //replay ignores the time and wraps around
+    ValueGenerator replay(speed, ValueGenerator::Mode::Replay, 1.0);
+    replay.setReplayValues({3.0, 1.0, 2.0});
+    QCOMPARE(replay.value(5.0).toUInt(), 3u);
+    QCOMPARE(replay.value(0.0).toUInt(), 1u);
+    QCOMPARE(replay.value(0.0).toUInt(), 2u);
+    QCOMPARE(replay.value(0.0).toUInt(), 3u);
+
+    ValueGenerator::Mode mode = ValueGenerator::Mode::Ramp;
+    QVERIFY(ValueGenerator::modeFromString("sine", mode));
+    QVERIFY(mode == ValueGenerator::Mode::Sine);
+    QVERIFY(!ValueGenerator::modeFromString("square", mode));
+}
+
+void CanObjectTest::testFrameBits()
+{
+    using Stuffing = BusLoadEstimator::Stuffing;
+
+    const QByteArray data(8, 0x55);
+
+    QCOMPARE(BusLoadEstimator::classicFrameBits(0x123, false, data, false, Stuffing::None), 111);
+    QCOMPARE(BusLoadEstimator::classicFrameBits(0x123, false, data, false, Stuffing::WorstCase), 135);
+    QCOMPARE(BusLoadEstimator::classicFrameBits(0x123, true, data, false, Stuffing::WorstCase), 160);
+
+    //alternating data does not need stuffing, all zeros does
+    const int alternating = BusLoadEstimator::classicFrameBits(0x555, false, data, false, Stuffing::Actual);
+    const int zeros = BusLoadEstimator::classicFrameBits(0, false, QByteArray(8, 0), false, Stuffing::Actual);
+    QVERIFY(alternating >= 111 && alternating < zeros);
+    QVERIFY(zeros <= 135);
+
+    //remote frame carries no data
+    QCOMPARE(BusLoadEstimator::classicFrameBits(0x123, false, QByteArray(), true, Stuffing::None), 47);
+
+    //FD with bitrate switch is shorter than without
+    QVERIFY(BusLoadEstimator::fdFrameBits(false, 64, 0.25, Stuffing::WorstCase) <
+            BusLoadEstimator::fdFrameBits(false, 64, 1.0, Stuffing::WorstCase));
+
+    //FD payloads are padded to the next DLC size
+    QCOMPARE(BusLoadEstimator::fdFrameBits(false, 9, 1.0, Stuffing::None),
+             BusLoadEstimator::fdFrameBits(false, 12, 1.0, Stuffing::None));
+    QCOMPARE(BusLoadEstimator::fdFrameBits(false, 33, 0.25, Stuffing::WorstCase),
+             BusLoadEstimator::fdFrameBits(false, 48, 0.25, Stuffing::WorstCase));
+    QVERIFY(BusLoadEstimator::fdFrameBits(false, 8, 1.0, Stuffing::None) <
+            BusLoadEstimator::fdFrameBits(false, 9, 1.0, Stuffing::None));
+
+    QCanBusFrame fd(0x123, QByteArray(10, 0));
+    fd.setFlexibleDataRateFormat(true);
+    QCOMPARE(BusLoadEstimator().frameBits(fd, Stuffing::WorstCase),
+             BusLoadEstimator::fdFrameBits(false, 12, 1.0, Stuffing::WorstCase));
+}
+
+void CanObjectTest::testBusLoad()
+{
+    using Stuffing = BusLoadEstimator::Stuffing;
+
+    BusLoadEstimator estimator(500000);
+    const QCanBusFrame frame(0x123, QByteArray(8, 0x55));
+    const int bits = BusLoadEstimator::classicFrameBits(0x123, false, frame.payload(), false, Stuffing::Actual);
+
+    //1000 frames within one second
+    for (int i = 0; i < 1000; ++i)
+    {
+        estimator.addFrame(frame, i * 1000);
+    }
+
+    QVERIFY(qAbs(estimator.load(999999) - bits * 1000.0 / 500000) < 0.01);
+
+    //window moved past all frames
+    QCOMPARE(estimator.load(5000000), 0.0);
+
+    QCOMPARE(estimator.predictedLoad({frame}, {100.0}, Stuffing::WorstCase), 135.0 * 100 / 500000);
+}
+
+void CanObjectTest::testLatencyHistogram()
+{
+    //buckets are contiguous and hold their values
+    for (quint64 value = 0; value < 100000; value += 7)
+    {
+        const int bucket = LatencyHistogram::bucketOf(value);
+        QVERIFY(LatencyHistogram::bucketLowerBound(bucket) <= value);
+        QVERIFY(LatencyHistogram::bucketUpperBound(bucket) >= value);
+    }
+
+    LatencyHistogram histogram;
+
+    for (int i = 1; i <= 1000; ++i)
+    {
+        histogram.record(i);
+    }
+
+    QCOMPARE(histogram.count(), Q_UINT64_C(1000));
+    QCOMPARE(histogram.min(), Q_INT64_C(1));
+    QCOMPARE(histogram.max(), Q_INT64_C(1000));
+    QCOMPARE(histogram.mean(), 500.5);
+
+    //within bucket precision
+    QVERIFY(qAbs(histogram.percentile(50.0) - 500) <= 32);
+    QVERIFY(qAbs(histogram.percentile(99.0) - 990) <= 64);
+    QCOMPARE(histogram.percentile(100.0), Q_INT64_C(1000));
+
+    //buckets counted elsewhere
+    QVector<quint64> counts(LatencyHistogram::BucketCount, 0);
+    counts[LatencyHistogram::bucketOf(5)] = 2;
+    counts[LatencyHistogram::bucketOf(2000)] = 1;
+
+    LatencyHistogram external;
+    external.merge(counts.constData(), 5, 2000, 2010.0);
+    QCOMPARE(external.count(), Q_UINT64_C(3));
+    QCOMPARE(external.min(), Q_INT64_C(5));
+    QCOMPARE(external.max(), Q_INT64_C(2000));
+    QCOMPARE(external.percentile(50.0), Q_INT64_C(5));
+}
+
+void CanObjectTest::testLatencyProbe()
+{
+    CanObject counter("counter",QMetaType::Type::UInt,{FrameRange(9,0,0,7)}, 0U,255U);
+
+    FrameComposer composer({counter});
+    SignalDecoder decoder({counter});
+    LatencyProbe probe(0, counter.getSize(), 16);
+    decoder.addSink(&probe);
+
+    //tag, send and receive back in order
+    for (int i = 0; i < 3; ++i)
+    {
+        const quint64 sequence = probe.nextSequence();
+        composer.writeRaw(0, sequence);
+        const QCanBusFrame frame = composer.frame(9);
+
+        const qint64 txUs = LatencyProbe::nowUs();
+        probe.onSent(sequence, txUs);
+        decoder.decode(9, CANObjects::payloadToWord(frame.payload()), txUs + 100);
+    }
+
+    QCOMPARE(probe.txToRx().count(), Q_UINT64_C(3));
+    QCOMPARE(probe.txToRx().min(), Q_INT64_C(100));
+    QCOMPARE(probe.txToRx().max(), Q_INT64_C(100));
+    QCOMPARE(probe.unmatched(), Q_UINT64_C(0));
+
+    //a sequence received twice is matched once
+    probe.reset();
+    probe.onSent(7, 1000);
+    probe.onReceived(7, 1050, 1080);
+    probe.onReceived(7, 1050, 1080);
+
+    QCOMPARE(probe.txToRx().percentile(50.0), Q_INT64_C(50));
+    QCOMPARE(probe.rxToDecode().percentile(50.0), Q_INT64_C(30));
+    QCOMPARE(probe.txToDecode().percentile(50.0), Q_INT64_C(80));
+    QCOMPARE(probe.unmatched(), Q_UINT64_C(1));
+
+    //a frame never received is counted lost once its slot is reused
+    probe.onSent(8, 2000);
+    probe.onSent(24, 2100);
+    QCOMPARE(probe.lost(), Q_UINT64_C(1));
+}
+
+void CanObjectTest::testTimestampingSocket()
+{
+    TimestampingCanSocket receiver;
+
+    if (!receiver.open("vcan0"))
+    {
+        QSKIP("vcan0 is not available");
+    }
+
+    //a socket does not receive its own frames
+    TimestampingCanSocket sender;
+    QVERIFY(sender.open("vcan0"));
+
+    const qint64 beforeUs = LatencyProbe::nowUs();
+
+    for (int i = 0; i < 3; ++i)
+    {
+        QByteArray payload = QByteArray::fromHex("0102030405060708");
+        payload[0] = static_cast<char>(i);
+        QVERIFY(sender.writeFrame(QCanBusFrame(0x123, payload)));
+    }
+
+    QTRY_COMPARE(receiver.framesAvailable(), Q_INT64_C(3));
+    const qint64 afterUs = LatencyProbe::nowUs();
+
+    for (int i = 0; i < 3; ++i)
+    {
+        const QCanBusFrame frame = receiver.readFrame();
+        QCOMPARE(frame.frameId(), 0x123u);
+        QCOMPARE(static_cast<int>(frame.payload().at(0)), i);
+
+        //vcan has no controller clock, stamps are kernel time of the send
+        const qint64 stampUs = FrameSnapshotTable::timestampUs(frame);
+        QVERIFY(stampUs >= beforeUs);
+        QVERIFY(stampUs <= afterUs);
+    }
+
+    QVERIFY(receiver.timestampSource() == TimestampingCanSocket::Source::Software);
+    QCOMPARE(receiver.softwareStamped(), Q_UINT64_C(3));
+    QCOMPARE(receiver.hardwareStamped(), Q_UINT64_C(0));
+}
+
+void CanObjectTest::testColumnarRoundTrip()
+{
+    CanObject speed("speed",QMetaType::Type::Int,{FrameRange(3,0,0,7)}, -128,127);
+    CanObject level("level",QMetaType::Type::Float,{FrameRange(4,0,0,7),FrameRange(4,1,0,7),FrameRange(4,2,0,7),FrameRange(4,3,0,7)}, 0.0f,1.0f);
+
+    SignalDecoder decoder({speed, level});
+    ColumnarExporter exporter(decoder.objects(), 4);
+    decoder.addSink(&exporter);
+
+    QBuffer buffer;
+    buffer.open(QIODevice::ReadWrite);
+    QVERIFY(exporter.open(&buffer));
+
+    for (int i = 0; i < 10; ++i)
+    {
+        const qint8 value = static_cast<qint8>(i * 5 - 20);
+        decoder.decode(3, CANObjects::payloadToWord(QByteArray(1, static_cast<char>(value))), 1000 + i * 10);
+    }
+
+    const QCanBusFrame levelFrame = prepareFrame<float>(0.25f, 4);
+    decoder.decode(levelFrame.frameId(), CANObjects::payloadToWord(levelFrame.payload()), 5000);
+
+    //full chunks are written while streaming
+    QCOMPARE(exporter.chunks().size(), 2);
+    QVERIFY(exporter.finish());
+
+    ColumnarReader reader;
+    QVERIFY(reader.open(&buffer));
+    QCOMPARE(reader.signalInfos().size(), 2);
+    QCOMPARE(reader.indexOf("level"), 1);
+    QCOMPARE(reader.chunks().size(), 4);
+
+    QVector<qint64> timestamps;
+    QVector<double> values;
+    QVector<double> speeds;
+
+    for (int chunk = 0; chunk < reader.chunks().size(); ++chunk)
+    {
+        QVERIFY(reader.readChunk(chunk, timestamps, values));
+
+        if (reader.chunks()[chunk].signal == 0)
+        {
+            QCOMPARE(reader.chunks()[chunk].minValue, values.first());
+            QCOMPARE(reader.chunks()[chunk].maxValue, values.last());
+            QCOMPARE(reader.chunks()[chunk].minTimestampUs, timestamps.first());
+            speeds += values;
+        }
+        else
+        {
+            QCOMPARE(values, QVector<double>({0.25}));
+            QCOMPARE(timestamps, QVector<qint64>({5000}));
+        }
+    }
+
+    QCOMPARE(speeds.size(), 10);
+    QCOMPARE(speeds.first(), -20.0);
+    QCOMPARE(speeds.last(), 25.0);
+}
+
+void CanObjectTest::testAsyncSignalWait()
+{
+#ifdef CANBASE_HAS_COROUTINES
+    CanObject blinker("blinker left",QMetaType::Type::Bool,{FrameRange(8,0,0,0)}, false,true);
+
+    SignalDecoder decoder({blinker});
+    AsyncSignalBus bus(1);
+    decoder.addSink(&bus);
+
+    std::optional<DecodedSignal> first;
+    std::optional<DecodedSignal> on;
+    std::optional<DecodedSignal> off;
+    bool done = false;
+
+    const auto script = [&]() -> AsyncSignalBus::Task {
+        first = co_await bus.next(0);
+        on = co_await bus.until(0, [](const DecodedSignal &signal){ return signal.value != 0.0; });
+        off = co_await bus.until(0, [](const DecodedSignal &signal){ return signal.value == 0.0; }, 500);
+        done = true;
+    };
+
+    script();
+    QCOMPARE(bus.pending(), 1);
+
+    //frames of other IDs do not wake anything
+    decoder.decode(9, 0, 1);
+    QVERIFY(!first);
+
+    decoder.decode(8, 0, 2);
+    QVERIFY(first && first->timestampUs == 2);
+
+    decoder.decode(8, 0, 3);
+    QVERIFY(!on);
+
+    decoder.decode(8, Q_UINT64_C(1) << 63, 4);
+    QVERIFY(on && on->timestampUs == 4);
+
+    //no matching frame within the timeout
+    QVERIFY(bus.nextDeadline() >= 0);
+    bus.expire(AsyncSignalBus::nowMs() + 1000);
+
+    QVERIFY(done);
+    QVERIFY(!off);
+    QCOMPARE(bus.pending(), 0);
+#else
+    QSKIP("compiler without C++20 coroutines");
+#endif
+}
+
+void CanObjectTest::testE2EProtection()
+{
+    //CRC8 SAE J1850 check value
+    const QByteArray check("123456789");
+    QCOMPARE(CANObjects::Crc8(0x1D).compute(reinterpret_cast<const quint8*>(check.constData()), check.size(), 0xFF) ^ 0xFF, 0x4B);
+
+    E2EProfile profile;
+    profile.frameID = 544;
+    profile.crcByte = 0;
+    profile.counter = FrameRange(544,1,4,7);
+    profile.dataID = 544;
+
+    CanObject brake("brake",QMetaType::Type::UInt,{FrameRange(544,4,0,7)}, 0U,255U);
+
+    E2EProtection txProtection({profile});
+    FrameComposer composer({brake});
+    composer.setProtection(&txProtection);
+
+    E2EProtection rxProtection({profile});
+    SignalDecoder decoder({brake});
+    decoder.setProtection(&rxProtection);
+
+    SignalAggregator received(1, 1000000);
+    decoder.addSink(&received);
+
+    QVector<QCanBusFrame> frames;
+
+    for (quint32 i = 0; i < 3; ++i)
+    {
+        composer.writeRaw(0, 10 + i);
+        composer.compose(i, frames);
+    }
+
+    QCOMPARE(frames.size(), 3);
+
+    //counter runs in the low nibble of byte 1
+    QCOMPARE(static_cast<quint8>(frames[2].payload().at(1)), quint8(2));
+
+    decoder.decode(frames[0]);
+    decoder.decode(frames[0]);
+    QCOMPARE(rxProtection.counters(544).repeated, Q_UINT64_C(1));
+
+    //corrupted payload is dropped
+    QByteArray corrupted = frames[1].payload();
+    corrupted[4] = 99;
+    decoder.decode(QCanBusFrame(544, corrupted));
+    QCOMPARE(rxProtection.counters(544).crcErrors, Q_UINT64_C(1));
+
+    //frame 1 lost
+    QVERIFY(rxProtection.check(544, CANObjects::payloadToWord(frames[2].payload())) == E2EProtection::Status::WrongSequence);
+    QCOMPARE(rxProtection.counters(544).sequenceErrors, Q_UINT64_C(1));
+
+    QVector<CANObjects::WindowRecord> records;
+    received.flush(2000000);
+    received.takeRecords(records);
+
+    QCOMPARE(records.size(), 1);
+    QCOMPARE(records[0].count, 1u);
+    QCOMPARE(records[0].max, 10.0);
+}
+
+void CanObjectTest::testParallelDecode()
+{
+    struct Collector : CANObjects::SignalSink
+    {
+        QVector<DecodedSignal> values;
+
+        void onSignal(const DecodedSignal &signal) override
+        {
+            values.push_back(signal);
+        }
+    };
+
+    //a byte signal in every byte of 32 frames, one signal across two frames
+    QVector<CanObject> objects;
+
+    for (quint32 frameID = 0; frameID < 32; ++frameID)
+    {
+        for (quint8 byte = 0; byte < 8; ++byte)
+        {
+            objects.push_back(CanObject(QString("s%1_%2").arg(frameID).arg(byte),QMetaType::Type::UInt,
+                                        {FrameRange(frameID,byte,0,7)}, 0U,255U));
+        }
+    }
+
+    objects.push_back(CanObject("spanning",QMetaType::Type::UInt,{FrameRange(0,0,0,7),FrameRange(1,0,0,7)}, 0U,65535U));
+
+    QVector<QCanBusFrame> frames;
+
+    for (int i = 0; i < 100; ++i)
+    {
+        QByteArray payload(8, 0);
+
+        for (int byte = 0; byte < 8; ++byte)
+        {
+            payload[byte] = static_cast<char>(i + byte);
+        }
+
+        frames.push_back(QCanBusFrame(static_cast<quint32>(i % 32), payload));
+    }
+
+    SignalDecoder serial(objects);
+    Collector serialValues;
+    serial.addSink(&serialValues);
+
+    CANObjects::DecodePool pool(2);
+    SignalDecoder parallel(objects);
+    Collector parallelValues;
+    parallel.addSink(&parallelValues);
+    parallel.setPool(&pool, 1);
+
+    serial.decode(frames);
+    parallel.decode(frames);
+
+    QCOMPARE(parallelValues.values.size(), serialValues.values.size());
+
+    for (int i = 0; i < serialValues.values.size(); ++i)
+    {
+        QCOMPARE(parallelValues.values[i].signal, serialValues.values[i].signal);
+        QCOMPARE(parallelValues.values[i].raw, serialValues.values[i].raw);
+        QCOMPARE(parallelValues.values[i].value, serialValues.values[i].value);
+    }
+
+    //batches go through the pool as well, spanning signals read the payloads of their time
+    QVector<quint32> frameIDs;
+    for (quint32 frameID = 0; frameID < 32; ++frameID)
+    {
+        frameIDs.push_back(frameID);
+    }
+
+    FrameBatch batch(FrameIndex(frameIDs), frames.size());
+    for (const QCanBusFrame &frame : frames)
+    {
+        batch.append(frame.frameId(), CANObjects::payloadToWord(frame.payload()), 8, 0);
+    }
+
+    SignalDecoder serialBatch(objects);
+    Collector serialBatchValues;
+    serialBatch.addSink(&serialBatchValues);
+
+    SignalDecoder parallelBatch(objects);
+    Collector parallelBatchValues;
+    parallelBatch.addSink(&parallelBatchValues);
+    parallelBatch.setPool(&pool, 1);
+
+    serialBatch.decode(batch);
+    parallelBatch.decode(batch);
+
+    QCOMPARE(parallelBatchValues.values.size(), serialValues.values.size());
+    QCOMPARE(serialBatchValues.values.size(), serialValues.values.size());
+
+    for (int i = 0; i < serialValues.values.size(); ++i)
+    {
+        QCOMPARE(parallelBatchValues.values[i].signal, serialBatchValues.values[i].signal);
+        QCOMPARE(parallelBatchValues.values[i].raw, serialBatchValues.values[i].raw);
+    }
+}
+
+void CanObjectTest::benchmarkParallelDecode_data()
+{
+    QTest::addColumn<bool>("parallel");
+
+    QTest::newRow("serial") << false;
+    QTest::newRow("DecodePool") << true;
+}
+
+void CanObjectTest::benchmarkParallelDecode()
+{
+    QFETCH(bool, parallel);
+
+    struct Counter : CANObjects::SignalSink
+    {
+        quint64 count = 0;
+
+        void onSignal(const DecodedSignal &signal) override
+        {
+            Q_UNUSED(signal)
+            ++count;
+        }
+    };
+
+    //scaled byte signals in every byte of 256 frames, spanning pairs of frames
+    QVector<CanObject> objects;
+    QVector<quint32> frameIDs;
+
+    for (quint32 frameID = 0; frameID < 256; ++frameID)
+    {
+        frameIDs.push_back(frameID);
+
+        for (quint8 byte = 0; byte < 8; ++byte)
+        {
+            CanObject obj(QString("s%1_%2").arg(frameID).arg(byte),QMetaType::Type::UInt,
+                          {FrameRange(frameID,byte,0,7)}, 0U,255U);
+            obj.setScaling(0.5, -10.0);
+            objects.push_back(obj);
+        }
+
+        objects.push_back(CanObject(QString("spanning%1").arg(frameID),QMetaType::Type::UInt,
+                                    {FrameRange(frameID,0,0,7),FrameRange((frameID + 1) % 256,1,0,7)}, 0U,65535U));
+    }
+
+    FrameBatch batch(FrameIndex(frameIDs), 2048);
+    for (int i = 0; i < 2048; ++i)
+    {
+        batch.append(static_cast<quint32>(i % 256), Q_UINT64_C(0x0102030405060708) * static_cast<quint64>(i), 8, i);
+    }
+
+    CANObjects::DecodePool pool;
+    SignalDecoder decoder(objects);
+    Counter counter;
+    decoder.addSink(&counter);
+
+    if (parallel)
+    {
+        decoder.setPool(&pool);
+    }
+
+    QBENCHMARK
+    {
+        decoder.decode(batch);
+    }
+
+    QVERIFY(counter.count > 0);
+}
+
+void CanObjectTest::testGatewayRouting()
+{
+    CanObject speed("speed",QMetaType::Type::UInt,{FrameRange(1,0,0,7),FrameRange(1,1,0,3)}, 0U,4095U);
+    CanObject bodySpeed("body speed",QMetaType::Type::UInt,{FrameRange(2,3,0,7),FrameRange(2,4,0,3)}, 0U,4095U);
+    CanObject bodyLight("body light",QMetaType::Type::Bool,{FrameRange(2,0,0,0)}, false,true);
+    //same name on the other bus, copies must not pick it up
+    CanObject bodyWheel("speed",QMetaType::Type::UInt,{FrameRange(3,0,0,7)}, 0U,255U);
+
+    BusConfig pt;
+    pt.name = "powertrain";
+    pt.canDeviceName = "pt";
+    pt.canObjects = {speed};
+
+    BusConfig body;
+    body.name = "body";
+    body.canDeviceName = "body";
+    body.canObjects = {bodySpeed, bodyLight, bodyWheel};
+
+    CANObjects::GatewayConfig config;
+
+    CANObjects::GatewayRoute route;
+    route.from = "pt";
+    route.to = "body";
+    route.frameID = 1;
+    route.remap = 0x101;
+    config.routes.push_back(route);
+
+    CANObjects::GatewaySignalCopy copy;
+    copy.from = "pt";
+    copy.to = "body";
+    copy.source = "speed";
+    copy.target = "body speed";
+    config.copies.push_back(copy);
+
+    //target signal lives on the body bus only
+    CANObjects::GatewaySignalCopy wrongBus = copy;
+    wrongBus.to = "pt";
+    config.copies.push_back(wrongBus);
+
+    CANObjects::CanGateway gateway(config, {pt, body});
+    QCOMPARE(gateway.routeCount(), 2);
+    QCOMPARE(gateway.devices(), QStringList({"pt", "body"}));
+
+    CANObjects::GatewayOutput outputs[4];
+    const quint64 payload = CANObjects::payloadToWord(QByteArray::fromHex("abc0000000000000"));
+
+    QCOMPARE(gateway.apply(0, 1, payload, 8, outputs, 4), 2);
+
+    QCOMPARE(outputs[0].device, 1);
+    QCOMPARE(outputs[0].frameID, 0x101u);
+    QCOMPARE(outputs[0].payload, payload);
+
+    //0xabc lands in byte 3 and the high nibble of byte 4
+    QCOMPARE(outputs[1].frameID, 2u);
+    QCOMPARE(CANObjects::wordToPayload(outputs[1].payload), QByteArray::fromHex("000000abc0000000"));
+
+    //frames of other IDs or devices are not routed
+    QCOMPARE(gateway.apply(0, 2, payload, 8, outputs, 4), 0);
+    QCOMPARE(gateway.apply(1, 1, payload, 8, outputs, 4), 0);
+    QCOMPARE(gateway.latency(0).count(), Q_UINT64_C(0));
+
+    //the forwarding thread polls a fixed number of devices
+    CANObjects::GatewayConfig wide;
+
+    for (int i = 0; i < CANObjects::CanGateway::MaxDevices; ++i)
+    {
+        CANObjects::GatewayRoute fanOut;
+        fanOut.from = "pt";
+        fanOut.to = QString("out%1").arg(i);
+        fanOut.frameID = 1;
+        wide.routes.push_back(fanOut);
+    }
+
+    CANObjects::CanGateway tooWide(wide, {pt});
+    QCOMPARE(tooWide.devices().size(), CANObjects::CanGateway::MaxDevices + 1);
+    QVERIFY(!tooWide.start());
+    QVERIFY(!tooWide.isRunning());
+}
+
+void CanObjectTest::testIsoTp()
+{
+    CANObjects::IsoTpChannelConfig tester;
+    tester.rxID = 0x7E8;
+    tester.txID = 0x7E0;
+
+    CANObjects::IsoTpChannelConfig ecu;
+    ecu.rxID = 0x7E0;
+    ecu.txID = 0x7E8;
+    ecu.blockSize = 2;
+
+    IsoTpTransport client({tester});
+    IsoTpTransport server({ecu});
+
+    QByteArray received;
+    int errors = 0;
+    server.setMessageHandler([&](int, const QByteArray &message) { received = QByteArray(message.constData(), message.size()); });
+    server.setErrorHandler([&](int, IsoTpTransport::Result) { ++errors; });
+
+    //single frame
+    QVERIFY(client.send(0, QByteArray::fromHex("1003"), 0) == IsoTpTransport::Result::Ok);
+    QVector<QCanBusFrame> frames;
+    client.poll(0, frames);
+    QCOMPARE(frames.size(), 1);
+    QCOMPARE(frames[0].frameId(), 0x7E0u);
+    QCOMPARE(frames[0].payload(), QByteArray::fromHex("021003cccccccccc"));
+    QVERIFY(server.receive(frames[0], 0));
+    QCOMPARE(received, QByteArray::fromHex("1003"));
+
+    //100 bytes: first frame, 14 consecutive frames, flow control every 2 of them
+    QByteArray message(100, 0);
+    for (int i = 0; i < message.size(); ++i)
+    {
+        message[i] = static_cast<char>(i);
+    }
+
+    QVERIFY(client.send(0, message, 0) == IsoTpTransport::Result::Ok);
+    QVERIFY(client.send(0, message, 0) == IsoTpTransport::Result::Busy);
+
+    int sent = 0;
+    int flowControls = 0;
+    for (int round = 0; round < 32 && client.isSending(0); ++round)
+    {
+        frames.clear();
+        client.poll(round, frames);
+        sent += frames.size();
+        for (const QCanBusFrame &frame : frames)
+        {
+            server.receive(frame, round);
+        }
+
+        frames.clear();
+        server.poll(round, frames);
+        flowControls += frames.size();
+        for (const QCanBusFrame &frame : frames)
+        {
+            client.receive(frame, round);
+        }
+    }
+
+    QCOMPARE(sent, 15);
+    QCOMPARE(flowControls, 7);
+    QCOMPARE(received, message);
+    QCOMPARE(errors, 0);
+
+    //frames of other IDs are not ours
+    QVERIFY(!server.receive(QCanBusFrame(0x123, QByteArray(8, 0)), 0));
+
+    //no flow control within N_Bs
+    QVERIFY(client.send(0, message, 0) == IsoTpTransport::Result::Ok);
+    IsoTpTransport::Result clientError = IsoTpTransport::Result::Ok;
+    client.setErrorHandler([&](int, IsoTpTransport::Result error) { clientError = error; });
+    frames.clear();
+    client.poll(0, frames);
+    client.poll(IsoTpTransport::TimeoutUs + 1, frames);
+    QVERIFY(clientError == IsoTpTransport::Result::Timeout);
+    QVERIFY(!client.isSending(0));
+
+    //malformed first frames are ignored, no flow control is sent for them
+    received.clear();
+    errors = 0;
+    QVERIFY(server.receive(QCanBusFrame(0x7E0, QByteArray::fromHex("1000000000000000")), 0));
+    QVERIFY(server.receive(QCanBusFrame(0x7E0, QByteArray::fromHex("1007010203040506")), 0));
+    QVERIFY(server.receive(QCanBusFrame(0x7E0, QByteArray::fromHex("2107080900000000")), 0));
+    frames.clear();
+    server.poll(0, frames);
+    QVERIFY(frames.isEmpty());
+    QVERIFY(received.isEmpty());
+    QCOMPARE(errors, 0);
+
+    //buffers hold at least a first frame
+    CANObjects::IsoTpChannelConfig tiny = ecu;
+    tiny.maxSize = 1;
+    IsoTpTransport small({tiny});
+    small.setMessageHandler([&](int, const QByteArray &message) { received = QByteArray(message.constData(), message.size()); });
+    QVERIFY(small.receive(QCanBusFrame(0x7E0, QByteArray::fromHex("1008010203040506")), 0));
+    QVERIFY(small.receive(QCanBusFrame(0x7E0, QByteArray::fromHex("2107080000000000")), 0));
+    QCOMPARE(received, QByteArray::fromHex("0102030405060708"));
+
+    QCOMPARE(IsoTpTransport::stMinToUs(0x0A), Q_INT64_C(10000));
+    QCOMPARE(IsoTpTransport::stMinToUs(0xF5), Q_INT64_C(500));
+}
+
+void CanObjectTest::testFrameIndex()
+{
+    //11 bit IDs close to each other
+    const FrameIndex dense({0x100, 0x7FF, 0x220});
+    QVERIFY(dense.isDense());
+    QCOMPARE(dense.slotOf(0x100), 0);
+    QCOMPARE(dense.slotOf(0x7FF), 1);
+    QCOMPARE(dense.slotOf(0x220), 2);
+    QCOMPARE(dense.slotOf(0x221), -1);
+    QCOMPARE(dense.slotOf(0xFF), -1);
+    QCOMPARE(dense.slotOf(0x800), -1);
+
+    //29 bit J1939 style IDs
+    QVector<quint32> frameIDs;
+    QSet<quint32> known;
+    quint32 seed = 1;
+    while (frameIDs.size() < 500)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        const quint32 frameID = seed & 0x1FFFFFFF;
+        if (!known.contains(frameID))
+        {
+            known.insert(frameID);
+            frameIDs.push_back(frameID);
+        }
+    }
+
+    const FrameIndex sparse(frameIDs);
+    QVERIFY(!sparse.isDense());
+    QCOMPARE(sparse.size(), 500);
+
+    for (int i = 0; i < frameIDs.size(); ++i)
+    {
+        QCOMPARE(sparse.slotOf(frameIDs[i]), i);
+    }
+
+    for (quint32 frameID = 0; frameID < 10000; ++frameID)
+    {
+        QCOMPARE(sparse.slotOf(frameID), known.contains(frameID) ? frameIDs.indexOf(frameID) : -1);
+    }
+
+    QCOMPARE(FrameIndex().slotOf(0), -1);
+
+    //repeated IDs keep their first slot
+    const FrameIndex repeatedDense({0x100, 0x220, 0x100});
+    QCOMPARE(repeatedDense.size(), 2);
+    QCOMPARE(repeatedDense.slotOf(0x100), 0);
+    QCOMPARE(repeatedDense.slotOf(0x220), 1);
+
+    const FrameIndex repeatedSparse({0x18FEF100, 0x0CF00400, 0x18FEF100, 0x1FFFFFFF, 0x0CF00400});
+    QVERIFY(!repeatedSparse.isDense());
+    QCOMPARE(repeatedSparse.size(), 3);
+    QCOMPARE(repeatedSparse.frameIDs(), QVector<quint32>({0x18FEF100, 0x0CF00400, 0x1FFFFFFF}));
+    QCOMPARE(repeatedSparse.slotOf(0x18FEF100), 0);
+    QCOMPARE(repeatedSparse.slotOf(0x0CF00400), 1);
+    QCOMPARE(repeatedSparse.slotOf(0x1FFFFFFF), 2);
+    QCOMPARE(repeatedSparse.slotOf(0x18FEF101), -1);
+}
+
+void CanObjectTest::benchmarkFrameLookup_data()
+{
+    QTest::addColumn<bool>("frameIndex");
+
+    QTest::newRow("QHash") << false;
+    QTest::newRow("FrameIndex") << true;
+}
+
+void CanObjectTest::benchmarkFrameLookup()
+{
+    QFETCH(bool, frameIndex);
+
+    //500 29 bit IDs, received in random order
+    QVector<quint32> frameIDs;
+    QHash<quint32, int> hash;
+    quint32 seed = 7;
+    while (frameIDs.size() < 500)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        const quint32 frameID = seed & 0x1FFFFFFF;
+        if (!hash.contains(frameID))
+        {
+            hash.insert(frameID, frameIDs.size());
+            frameIDs.push_back(frameID);
+        }
+    }
+
+    QVector<quint32> received;
+    for (int i = 0; i < 10000; ++i)
+    {
+        seed = seed * 1664525u + 1013904223u;
+        received.push_back(frameIDs[static_cast<int>(seed % 500)]);
+    }
+
+    const FrameIndex index(frameIDs);
+    qint64 sum = 0;
+
+    if (frameIndex)
+    {
+        QBENCHMARK
+        {
+            for (const quint32 frameID : received)
+            {
+                sum += index.slotOf(frameID);
+            }
+        }
+    }
+    else
+    {
+        QBENCHMARK
+        {
+            for (const quint32 frameID : received)
+            {
+                sum += hash.value(frameID, -1);
+            }
+        }
+    }
+
+    QVERIFY(sum > 0);
+}
+
+void CanObjectTest::testFrameBatch()
+{
+    struct Collector : CANObjects::SignalSink
+    {
+        bool latest = false;
+        QVector<quint64> values;
+
+        void onSignal(const DecodedSignal &signal) override
+        {
+            values.push_back(signal.raw);
+        }
+
+        bool latestOnly() const override
+        {
+            return latest;
+        }
+    };
+
+    CanObject speed("speed",QMetaType::Type::UInt,{FrameRange(1,0,0,7)}, 0U,255U);
+    CanObject gear("gear",QMetaType::Type::UInt,{FrameRange(2,0,0,7)}, 0U,255U);
+
+    FrameBatch batch(FrameIndex({1, 2}), 2);
+    batch.append(1, Q_UINT64_C(10) << 56, 8, 100);
+    batch.append(2, Q_UINT64_C(3) << 56, 8, 200);
+    batch.append(1, Q_UINT64_C(20) << 56, 8, 300);
+    batch.append(7, 0, 8, 400);
+
+    //all frames kept in arrival order, buffer grew once
+    QCOMPARE(batch.size(), 4);
+    QCOMPARE(batch.capacity(), 4);
+    QCOMPARE(batch.at(2).timestampUs, Q_INT64_C(300));
+    QVERIFY(!batch.isLatest(0));
+    QVERIFY(batch.isLatest(1));
+    QVERIFY(batch.isLatest(2));
+    QVERIFY(batch.isLatest(3));
+    QCOMPARE(batch.latestOf(1)->timestampUs, Q_INT64_C(300));
+    QVERIFY(!batch.latestOf(7));
+    QCOMPARE(batch.readData(speed).toUInt(), 20u);
+
+    SignalDecoder decoder({speed, gear});
+    Collector every;
+    Collector latest;
+    latest.latest = true;
+    decoder.addSink(&every);
+    decoder.addSink(&latest);
+    decoder.decode(batch);
+
+    QCOMPARE(every.values, QVector<quint64>({10, 3, 20}));
+    QCOMPARE(latest.values, QVector<quint64>({3, 20}));
+
+    //only last-value sinks left, older occurrences are not decoded at all
+    decoder.removeSink(&every);
+    latest.values.clear();
+    decoder.decode(batch);
+    QCOMPARE(latest.values, QVector<quint64>({3, 20}));
+
+    //reused without reallocation
+    batch.clear();
+    QVERIFY(batch.isEmpty());
+    QVERIFY(!batch.latestOf(1));
+    QVERIFY(batch.readData(speed).isNull());
+    batch.append(2, 0, 8, 500);
+    QCOMPARE(batch.capacity(), 4);
+    QVERIFY(batch.isLatest(0));
+}
+
+void CanObjectTest::testFrameSupervisor()
+{
+    //default timeout is one and a half cycles
+    QCOMPARE(FrameCycle(1, 100).timeoutMs, 150);
+
+    //1 ms ticks, 1 s timeout is two revolutions of the wheel
+    FrameSupervisor supervisor({FrameCycle(1, 10), FrameCycle(2, 100, 1000), FrameCycle(3, 10)});
+    QVector<quint32> timedOut;
+
+    QVERIFY(!supervisor.onFrame(1, 0));
+    QVERIFY(!supervisor.onFrame(2, 0));
+    QVERIFY(!supervisor.onFrame(7, 0));
+    QVERIFY(!supervisor.isSupervised(7));
+
+    //frame 3 was never received and is not supervised yet
+    supervisor.advance(14000, timedOut);
+    QVERIFY(timedOut.isEmpty());
+
+    supervisor.onFrame(1, 10000);
+    supervisor.advance(24999, timedOut);
+    QVERIFY(timedOut.isEmpty());
+
+    supervisor.advance(25000, timedOut);
+    QCOMPARE(timedOut, QVector<quint32>({1}));
+    QVERIFY(supervisor.isTimedOut(1));
+
+    //reported once
+    timedOut.clear();
+    supervisor.advance(500000, timedOut);
+    QVERIFY(timedOut.isEmpty());
+
+    supervisor.advance(1000000, timedOut);
+    QCOMPARE(timedOut, QVector<quint32>({2}));
+    QCOMPARE(supervisor.timedOutCount(), 2);
+
+    QVERIFY(supervisor.onFrame(1, 1000100));
+    QVERIFY(!supervisor.isTimedOut(1));
+    QCOMPARE(supervisor.timedOutCount(), 1);
+
+    timedOut.clear();
+    supervisor.arm(1000100);
+    supervisor.advance(1020000, timedOut);
+    std::sort(timedOut.begin(), timedOut.end());
+    QCOMPARE(timedOut, QVector<quint32>({1, 3}));
+
+    //decoder passes the last value on marked stale
+    struct Collector : CANObjects::SignalSink
+    {
+        QVector<DecodedSignal> values;
+
+        void onSignal(const DecodedSignal &signal) override
+        {
+            values.push_back(signal);
+        }
+
+        bool wantsStale() const override { return true; }
+    };
+
+    CanObject speed("speed",QMetaType::Type::UInt,{FrameRange(1,0,0,7)}, 0U,255U);
+    CanObject spanning("spanning",QMetaType::Type::UInt,{FrameRange(1,1,0,7),FrameRange(2,0,0,7)}, 0U,65535U);
+
+    FrameSupervisor decoderSupervisor({FrameCycle(1, 10), FrameCycle(2, 10)});
+    SignalDecoder decoder({speed, spanning});
+    Collector values;
+    decoder.addSink(&values);
+    decoder.setSupervisor(&decoderSupervisor);
+
+    decoder.decode(1, Q_UINT64_C(0x2A01) << 48, 0);
+    decoder.decode(2, Q_UINT64_C(0x02) << 56, 0);
+    decoder.decode(1, Q_UINT64_C(0x2A01) << 48, 10000);
+    values.values.clear();
+
+    //sinks not opting in never see the replay
+    SignalAggregator aggregator(2, 1000);
+    decoder.addSink(&aggregator);
+
+    decoder.expire(16000);
+    QCOMPARE(values.values.size(), 1);
+    QCOMPARE(values.values[0].signal, 1);
+    QVERIFY(values.values[0].stale);
+
+    QVector<WindowRecord> records;
+    aggregator.flush(1000000);
+    aggregator.takeRecords(records);
+    QVERIFY(records.isEmpty());
+    decoder.removeSink(&aggregator);
+
+    //fresh frame of a signal that still depends on a timed out one
+    values.values.clear();
+    decoder.decode(1, Q_UINT64_C(0x2B01) << 48, 17000);
+    QCOMPARE(values.values.size(), 2);
+    QCOMPARE(values.values[0].raw, Q_UINT64_C(0x2B));
+    QVERIFY(!values.values[0].stale);
+    QCOMPARE(values.values[1].raw, Q_UINT64_C(0x0102));
+    QVERIFY(values.values[1].stale);
+}
+
+void CanObjectTest::testFlightRecorder()
+{
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+
+    {
+        FlightRecorder recorder(60);
+        QCOMPARE(recorder.capacity(), 64);
+
+        for (quint32 i = 0; i < 100; ++i)
+        {
+            recorder.record(i, i * 3, 8, 0, i * 1000);
+        }
+
+        QCOMPARE(recorder.recorded(), Q_UINT64_C(100));
+
+        //oldest slot is never handed out, it may be in rewrite
+        QVector<FlightRecord> records;
+        recorder.snapshot(0, std::numeric_limits<qint64>::max(), records);
+        QCOMPARE(records.size(), 63);
+        QCOMPARE(records.first().frameID, 37u);
+        QCOMPARE(records.last().payload, Q_UINT64_C(297));
+
+        //post window long passed, dump is written right away
+        const QString path = dir.filePath("fault.canflt");
+        recorder.trigger(80000, 10000, 5000, path);
+        QVERIFY(recorder.waitForDumps(5000));
+        QCOMPARE(recorder.dumpsWritten(), 1);
+
+        QFile file(path);
+        QVERIFY(file.open(QIODevice::ReadOnly));
+        qint64 triggerUs = 0;
+        QVERIFY(CANObjects::FlightLog::read(&file, records, &triggerUs));
+        QCOMPARE(triggerUs, Q_INT64_C(80000));
+        QCOMPARE(records.size(), 16);
+        QCOMPARE(records.first().frameID, 70u);
+        QCOMPARE(records.last().frameID, 85u);
+
+        //truncated dump claiming far more records than it holds
+        file.seek(0);
+        QByteArray truncated = file.read(CANObjects::FlightLog::MagicSize + 4 + 8 + 4 + CANObjects::FlightLog::RecordSize);
+        truncated.replace(CANObjects::FlightLog::MagicSize + 4 + 8, 4, QByteArray(4, '\xFF'));
+        QBuffer corrupt(&truncated);
+        QVERIFY(corrupt.open(QIODevice::ReadOnly));
+        QVERIFY(!CANObjects::FlightLog::read(&corrupt, records));
+        QCOMPARE(records.size(), 1);
+
+        //rules raise dumps named after them
+        SignalRuleEngine engine({CanObject("oil temperature",QMetaType::Type::UInt,{FrameRange(3,0,0,7)}, 0U,255U)}, false);
+        ThresholdRule overheat;
+        overheat.name = "overheat";
+        overheat.threshold = 100.0;
+        overheat.dumpFlightRecorder = true;
+        engine.addThreshold(0, overheat);
+        engine.setFlightRecorder(&recorder, dir.path(), 10000, 5000);
+
+        DecodedSignal decoded;
+        decoded.signal = 0;
+        decoded.raw = 120;
+        decoded.value = 120.0;
+        decoded.timestampUs = 60000;
+        engine.onSignal(decoded);
+        QVERIFY(recorder.waitForDumps(5000));
+        QCOMPARE(recorder.dumpsWritten(), 2);
+        QVERIFY(QFile::exists(dir.filePath("flight-60000-overheat.canflt")));
+
+        //the post window ends with the first frame past it, not on the local clock
+        recorder.trigger(99000, 1000, 10000000, dir.filePath("late.canflt"));
+        QVERIFY(!recorder.waitForDumps(50));
+        recorder.record(200, 0, 8, 0, 10100000);
+        QVERIFY(recorder.waitForDumps(5000));
+        QCOMPARE(recorder.dumpsWritten(), 3);
+    }
+
+    //file backed ring keeps its records for the next run
+    const QString ringPath = dir.filePath("ring");
+
+    {
+        FlightRecorder recorder(16);
+        QVERIFY(recorder.open(ringPath));
+        QVERIFY(recorder.isFileBacked());
+        recorder.record(0x18FEF100, Q_UINT64_C(0x1122334455667788), 8, FlightRecord::Extended, 42);
+    }
+
+    FlightRecorder recovered(16);
+    QVERIFY(recovered.open(ringPath));
+    QCOMPARE(recovered.recorded(), Q_UINT64_C(1));
+
+    QVector<FlightRecord> records;
+    recovered.snapshot(0, 100, records);
+    QCOMPARE(records.size(), 1);
+    QCOMPARE(records[0].frameID, 0x18FEF100u);
+    QCOMPARE(records[0].payload, Q_UINT64_C(0x1122334455667788));
+    QCOMPARE(records[0].flags, static_cast<quint8>(FlightRecord::Extended));
+}
+
+void CanObjectTest::testTxValueModel()
+{
+    quint32 frameID = 1;
+
+    CanObject wheel("wheel",QMetaType::Type::UInt,{FrameRange(frameID,0,0,7),FrameRange(frameID,1,0,3)}, 0,4095);
+    CanObject blinker("blinker",QMetaType::Type::Bool,{FrameRange(frameID,3,1,1)}, false,true);
+    CanObject steering("steering",QMetaType::Type::Int,{FrameRange(frameID,4,0,7),FrameRange(frameID,5,0,7)}, -32768,32767);
+
+    TxValueModel values({wheel,blinker,steering});
+    QVERIFY(values.setText(0, "2999.6"));
+    QVERIFY(values.setText(1, "1"));
+    QVERIFY(values.setText(2, "-1234"));
+    QVERIFY(!values.setText(2, "abc"));
+    QCOMPARE(values.value(0).toUInt(), 3000u);
+    QCOMPARE(values.value(2).toInt(), -1234);
+
+    //same payload as written from the values directly
+    FrameComposer expected({wheel,blinker,steering});
+    expected.writeValue(0,QVariant(3000u));
+    expected.writeValue(1,QVariant(true));
+    expected.writeValue(2,QVariant(-1234));
+
+    FrameComposer composer({wheel,blinker,steering}, 100);
+    values.applyChanges(composer);
+    QCOMPARE(composer.frame(frameID).payload(), expected.frame(frameID).payload());
+
+    QVector<QCanBusFrame> frames;
+    composer.compose(0,frames);
+    QCOMPARE(frames.size(), 1);
+
+    //no edit, nothing changes until the period elapsed
+    frames.clear();
+    values.applyChanges(composer);
+    composer.compose(50,frames);
+    QCOMPARE(frames.size(), 0);
+
+    //disabled signal keeps its bits in the frame
+    values.setEnabled(1, false);
+    values.setText(1, "0");
+    values.setText(0, "100");
+    values.applyChanges(composer);
+    QCOMPARE(wheel.readData({{frameID,composer.frame(frameID)}}).toUInt(), 100u);
+    QCOMPARE(blinker.readData({{frameID,composer.frame(frameID)}}).toBool(), true);
+
+    //a new composer gets every enabled value
+    FrameComposer restarted({wheel,blinker,steering}, 100);
+    values.applyAll(restarted);
+    QCOMPARE(steering.readData({{frameID,restarted.frame(frameID)}}).toInt(), -1234);
+    QCOMPARE(blinker.readData({{frameID,restarted.frame(frameID)}}).toBool(), false);
+}
+
+void CanObjectTest::testReadLongLong()
+{
+    qint64 val = std::numeric_limits<qint64>::min();
+    QCanBusFrame frame = prepareFrame(val,1);
+
+    QVector<FrameRange> ranges;
+    for (quint8 byte = 0; byte < 8; ++byte)
+    {
+        ranges.push_back(FrameRange(1,byte,0,7));
+    }
+
+    CanObject canObj("",QMetaType::Type::LongLong,ranges, 0,255);
+    QCOMPARE(canObj.readData({{1,frame}}).toLongLong(), val);
+
+    val = -123456789012LL;
+    frame = prepareFrame(val,1);
+    QCOMPARE(canObj.readData({{1,frame}}).toLongLong(), val);
+
+    const quint64 uval = std::numeric_limits<quint64>::max();
+    frame = prepareFrame(uval,1);
+    CanObject canObjU("",QMetaType::Type::ULongLong,ranges, 0,255);
+    QCOMPARE(canObjU.readData({{1,frame}}).toULongLong(), uval);
+}
+
+void CanObjectTest::testWriteLongLongPartial()
+{
+    quint32 frameID = 1;
+
+    //40 bits over five bytes, the last range only half a byte
+    CanObject canObj("",QMetaType::Type::LongLong,{FrameRange(frameID,0,0,7),FrameRange(frameID,1,0,7),
+                                                   FrameRange(frameID,2,0,7),FrameRange(frameID,3,0,7),
+                                                   FrameRange(frameID,4,4,7),FrameRange(frameID,5,0,3)}, 0,255);
+    QCOMPARE(canObj.getSize(), static_cast<quint8>(40));
+
+    QHash<quint32, QCanBusFrame> frames;
+    const qint64 val = -(Q_INT64_C(1) << 39);
+    canObj.writeData(QVariant::fromValue(val),frames);
+    QCOMPARE(canObj.readData(frames).toLongLong(), val);
+    QCOMPARE(static_cast<quint8>(frames[frameID].payload().at(0)), static_cast<quint8>(0x80));
+
+    canObj.writeData(QVariant::fromValue(Q_INT64_C(-2)),frames);
+    QCOMPARE(canObj.readData(frames).toLongLong(), Q_INT64_C(-2));
+    QCOMPARE(canObj.encodeRaw(QVariant::fromValue(Q_INT64_C(-2))), (Q_UINT64_C(1) << 40) - 2);
+    QCOMPARE(canObj.decodeDouble(canObj.encodeRaw(QVariant::fromValue(Q_INT64_C(-2)))), -2.0);
+
+    //unsigned values keep their top bit
+    CanObject canObjU("",QMetaType::Type::ULongLong,{FrameRange(frameID,6,0,7),FrameRange(frameID,7,0,7)}, 0,65535);
+    canObjU.writeData(QVariant::fromValue(Q_UINT64_C(0xFFFE)),frames);
+    QCOMPARE(canObjU.readData(frames).toULongLong(), Q_UINT64_C(0xFFFE));
+    QCOMPARE(canObj.readData(frames).toLongLong(), Q_INT64_C(-2));
+
+    //config type names
+    const QVariantMap map{{"name","odometer"},{"type","qlonglong"},{"minval",0},{"maxval",255},
+                          {"ranges",QVariantList{QVariantMap{{"frameid",frameID},{"byteid",0},{"startbit",0},{"endbit",7}}}}};
+    QVERIFY(CanObject(map).getType() == QMetaType::Type::LongLong);
+}
+
+void CanObjectTest::testScaledSignals()
+{
+    quint32 frameID = 1;
+
+    const QVariantMap map{{"name","coolant"},{"type","int"},{"minval",-40},{"maxval",215},{"factor",0.5},{"offset",-40},
+                          {"ranges",QVariantList{QVariantMap{{"frameid",frameID},{"byteid",0},{"startbit",0},{"endbit",7}},
+                                                 QVariantMap{{"frameid",frameID},{"byteid",1},{"startbit",0},{"endbit",3}}}}};
+    CanObject coolant(map);
+    QVERIFY(coolant.isScaled());
+    QCOMPARE(coolant.getFactor(), 0.5);
+
+    //inverse on write, the raw value is rounded
+    QHash<quint32, QCanBusFrame> frames;
+    coolant.writeData(QVariant(21.6),frames);
+    QCOMPARE(coolant.encodeRaw(QVariant(21.6)), Q_UINT64_C(123));
+    QCOMPARE(coolant.readData(frames).toDouble(), 21.5);
+    coolant.writeData(QVariant(-30.0),frames);
+    QCOMPARE(coolant.readData(frames).toDouble(), -30.0);
+
+    //limits and the raw range of the signal bound what is written
+    QCOMPARE(coolant.encodeRaw(QVariant(-1000.0)), Q_UINT64_C(0));
+    QCOMPARE(coolant.encodeRaw(QVariant(1000.0)), Q_UINT64_C(510));
+
+    CanObject unbounded("unbounded",QMetaType::Type::Int,{FrameRange(frameID,4,0,7),FrameRange(frameID,5,0,3)}, QVariant(),QVariant());
+    unbounded.setScaling(0.5, 0.0);
+    QCOMPARE(unbounded.encodeRaw(QVariant(1e6)), Q_UINT64_C(0x7FF));
+    QCOMPARE(unbounded.encodeRaw(QVariant(-1e30)), Q_UINT64_C(0x800));
+
+    //shared memory readers notice a change of scaling
+    CanObject rescaled = coolant;
+    rescaled.setScaling(0.25, -40.0);
+    QVERIFY(SharedSignalWriter::layoutHash({coolant}) != SharedSignalWriter::layoutHash({rescaled}));
+
+    //batch decode matches the single one, for both signs
+    const QVector<quint64> raws{0u, 123u, 2047u, 2048u, 4095u};
+    QVector<double> values(raws.size());
+    coolant.decodeDoubles(raws.constData(), values.data(), raws.size());
+
+    for (int i = 0; i < raws.size(); ++i)
+    {
+        QCOMPARE(values[i], coolant.decodeDouble(raws[i]));
+    }
+
+    QCOMPARE(values[4], -40.5);
+
+    //unscaled signals keep their type
+    CanObject plain("plain",QMetaType::Type::UInt,{FrameRange(frameID,2,0,7)}, 0U,255U);
+    QVERIFY(!plain.isScaled());
+    plain.writeData(QVariant(200U),frames);
+    QVERIFY(plain.readData(frames).userType() == QMetaType::UInt);
+    QCOMPARE(plain.readData(frames).toUInt(), 200u);
+
+    //value names are written back by name
+    CanObject gear("gear",QMetaType::Type::UInt,{FrameRange(frameID,3,0,2)}, 0U,7U);
+    gear.setValueNames({{0u,"P"},{1u,"R"},{2u,"N"},{3u,"D"}});
+    gear.writeData(QVariant(QString("D")),frames);
+    QCOMPARE(gear.readData(frames).toUInt(), 3u);
+    QCOMPARE(gear.valueName(2u), QString("N"));
+    QVERIFY(gear.valueName(5u).isEmpty());
+
+    TxValueModel model({gear});
+    QVERIFY(model.setText(0, "R"));
+    QCOMPARE(model.raw(0), Q_UINT64_C(1));
+
+    //columns store raw keys, read back physical
+    SignalDecoder decoder({coolant});
+    ColumnarExporter exporter(decoder.objects(), 4);
+    decoder.addSink(&exporter);
+
+    QBuffer buffer;
+    buffer.open(QIODevice::ReadWrite);
+    QVERIFY(exporter.open(&buffer));
+    decoder.decode(frameID, CANObjects::payloadToWord(frames[frameID].payload()), 1000);
+    QVERIFY(exporter.finish());
+
+    ColumnarReader reader;
+    QVERIFY(reader.open(&buffer));
+
+    QVector<qint64> timestamps;
+    QVERIFY(reader.readChunk(0, timestamps, values));
+    QCOMPARE(values, QVector<double>({-30.0}));
+    QCOMPARE(reader.chunks().first().minValue, -30.0);
+}
+
+void CanObjectTest::testBusConfig()
+{
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    file.write(R"({
+        "buses": [
+            {"name": "powertrain", "device": {"name": "can0", "plugin": "socketcan"},
+             "canobjects": [{"name": "speed", "type": "uint", "minval": 0, "maxval": 255,
+                             "ranges": [{"frameid": 256, "byteid": 0, "startbit": 0, "endbit": 7}]}]},
+            {"name": "body", "device": {"name": "can1", "plugin": "socketcan"},
+             "canobjects": [{"name": "door", "type": "bool", "minval": false, "maxval": true,
+                             "ranges": [{"frameid": 256, "byteid": 1, "startbit": 0, "endbit": 0}]}],
+             "cycles": [{"frameid": 256, "cycletime": 100}]}
+        ]
+    })");
+    file.close();
+
+    const Config config = CANObjects::ConfigLoader::loadConfig(file.fileName());
+    QCOMPARE(config.buses.size(), 2);
+    QCOMPARE(config.buses[1].name, QString("body"));
+    QCOMPARE(config.buses[1].canDeviceName, QString("can1"));
+    QCOMPARE(config.buses[1].frameCycles.size(), 1);
+
+    //top level describes the first bus
+    QCOMPARE(config.canDeviceName, QString("can0"));
+    QCOMPARE(config.canObjects.size(), 1);
+    QCOMPARE(config.canObjects.first().getName(), QString("speed"));
+
+    Config changed = config;
+    changed.buses[1].canDeviceName = "can2";
+    QVERIFY(CANObjects::ConfigLoader::diff(config, changed).busesChanged);
+    QVERIFY(!CANObjects::ConfigLoader::diff(config, changed).deviceChanged);
+}
+
+void CanObjectTest::testCanBusEngine()
+{
+    struct Collector : CANObjects::SignalSink
+    {
+        QVector<DecodedSignal> decoded;
+
+        void onSignal(const DecodedSignal &signal) override
+        {
+            decoded.push_back(signal);
+        }
+    };
+
+    //the same frame ID carries different signals on the two buses
+    BusConfig powertrain;
+    powertrain.name = "powertrain";
+    powertrain.canObjects = {CanObject("speed",QMetaType::Type::UInt,{FrameRange(0x100,0,0,7)}, 0U,255U)};
+
+    BusConfig body;
+    body.name = "body";
+    body.canObjects = {CanObject("door",QMetaType::Type::Bool,{FrameRange(0x100,1,0,0)}, false,true),
+                       CanObject("window.left",QMetaType::Type::UInt,{FrameRange(0x200,0,0,7)}, 0U,255U)};
+
+    CanBusEngine engine({powertrain, body});
+    QCOMPARE(engine.busCount(), 2);
+    QCOMPARE(engine.qualifiedName(1, 1), QString("body.window.left"));
+
+    int bus = -1;
+    int signal = -1;
+    QVERIFY(engine.find("body.window.left", bus, signal));
+    QCOMPARE(bus, 1);
+    QCOMPARE(signal, 1);
+    QVERIFY(!engine.find("powertrain.door", bus, signal));
+    QVERIFY(!engine.find("speed", bus, signal));
+
+    Collector sinks[2];
+    engine.addSink(0, &sinks[0]);
+    engine.addSink(1, &sinks[1]);
+
+    QVector<QCanBusFrame> frames[2];
+
+    for (int i = 0; i < 1000; ++i)
+    {
+        frames[0].push_back(QCanBusFrame(0x100, QByteArray(1, static_cast<char>(i))));
+        frames[1].push_back(QCanBusFrame(0x100, QByteArray::fromHex(i % 2 ? "0080" : "0000")));
+    }
+
+    //every bus runs on its own thread without touching the other
+    std::thread threads[2];
+
+    for (int i = 0; i < 2; ++i)
+    {
+        threads[i] = std::thread([&engine, &frames, i]() { engine.process(i, frames[i]); });
+    }
+
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+
+    QCOMPARE(engine.received(0), Q_UINT64_C(1000));
+    QCOMPARE(engine.received(1), Q_UINT64_C(1000));
+    QCOMPARE(sinks[0].decoded.size(), 1000);
+    QCOMPARE(sinks[1].decoded.size(), 1000);
+
+    QCOMPARE(sinks[0].decoded.last().bus, 0);
+    QCOMPARE(sinks[0].decoded.last().raw, Q_UINT64_C(999) & 0xFF);
+    QCOMPARE(sinks[1].decoded.last().bus, 1);
+    QCOMPARE(sinks[1].decoded.last().signal, 0);
+    QCOMPARE(sinks[1].decoded.last().raw, Q_UINT64_C(1));
+
+    FrameSnapshot snapshot;
+    QVERIFY(engine.latestFrames(1).read(0x100, snapshot));
+    QCOMPARE(snapshot.payload, Q_UINT64_C(0x0080) << 48);
+    QVERIFY(!engine.latestFrames(0).read(0x200, snapshot));
+}
+
 template<class T>
 QCanBusFrame CanObjectTest::prepareFrame(const T val,const quint32 canID) const
 {
@@ -0,0 +1,209 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include <canconfigloader.hpp>
+#include <columnarexporter.hpp>
+#include <decodepool.hpp>
+#include <signaldecoder.hpp>
+#include <timestampingcansocket.hpp>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QTextStream>
+#include <QTimer>
+
+#include <memory>
+
+namespace {
+
+//candump -l format: (seconds.micros) interface ID#DATA or ID##<flags>DATA for FD
+bool parseLogLine(const QString &line, QCanBusFrame &frame)
+{
+    const QStringList parts = line.split(' ', Qt::SkipEmptyParts);
+
+    if (parts.size() < 3 || !parts[0].startsWith('(') || !parts[0].endsWith(')'))
+    {
+        return false;
+    }
+
+    const QStringList stamp = parts[0].mid(1, parts[0].size() - 2).split('.');
+    const int separator = parts[2].indexOf('#');
+
+    if (stamp.size() != 2 || separator < 0)
+    {
+        return false;
+    }
+
+    bool ok = false;
+    const QString id = parts[2].left(separator);
+    frame = QCanBusFrame(id.toUInt(&ok, 16), QByteArray());
+
+    if (!ok)
+    {
+        return false;
+    }
+
+    frame.setExtendedFrameFormat(id.size() > 3);
+
+    QString data = parts[2].mid(separator + 1);
+
+    if (data.startsWith('#'))
+    {
+        frame.setFlexibleDataRateFormat(true);
+        data = data.mid(2);
+    }
+    else if (data.startsWith('R'))
+    {
+        frame.setFrameType(QCanBusFrame::RemoteRequestFrame);
+        data.clear();
+    }
+
+    frame.setPayload(QByteArray::fromHex(data.toLatin1()));
+    frame.setTimeStamp(QCanBusFrame::TimeStamp(stamp[0].toLongLong(), stamp[1].toLongLong()));
+
+    return true;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("CanExport");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Exports decoded signals into a columnar file");
+    parser.addHelpOption();
+    parser.addPositionalArgument("config", "CanObjects JSON config");
+    parser.addPositionalArgument("output", "Columnar output file");
+
+    const QCommandLineOption logOption({"l", "log"}, "Replays a candump log instead of receiving live.", "file");
+    const QCommandLineOption deviceOption({"d", "device"}, "Overrides device name of the config.", "name");
+    const QCommandLineOption durationOption({"t", "duration"}, "Live export length.", "sec", "60");
+    const QCommandLineOption chunkOption({"c", "chunk"}, "Rows per signal chunk.", "rows", "4096");
+    const QCommandLineOption threadsOption({"j", "threads"}, "Decode large batches on a pool of threads.", "count");
+
+    parser.addOptions({logOption, deviceOption, durationOption, chunkOption, threadsOption});
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 2)
+    {
+        parser.showHelp(1);
+    }
+
+    CANObjects::Config config = CANObjects::ConfigLoader::loadConfig(parser.positionalArguments().at(0));
+
+    if (parser.isSet(deviceOption))
+    {
+        config.canDeviceName = parser.value(deviceOption);
+    }
+
+    CANObjects::SignalDecoder decoder(config.canObjects);
+    CANObjects::ColumnarExporter exporter(config.canObjects, parser.value(chunkOption).toInt());
+
+    if (!exporter.open(parser.positionalArguments().at(1)))
+    {
+        qWarning() << "could not open output" << parser.positionalArguments().at(1);
+        return 1;
+    }
+
+    decoder.addSink(&exporter);
+
+    std::unique_ptr<CANObjects::DecodePool> pool;
+
+    if (parser.isSet(threadsOption))
+    {
+        pool.reset(new CANObjects::DecodePool(parser.value(threadsOption).toInt()));
+        decoder.setPool(pool.get());
+    }
+
+    if (parser.isSet(logOption))
+    {
+        QFile file(parser.value(logOption));
+
+        if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+        {
+            qWarning() << "could not open log" << file.fileName();
+            return 1;
+        }
+
+        QTextStream stream(&file);
+        QVector<QCanBusFrame> batch;
+        QCanBusFrame frame;
+        QString line;
+
+        while (stream.readLineInto(&line))
+        {
+            if (parseLogLine(line, frame))
+            {
+                batch.push_back(frame);
+            }
+
+            if (batch.size() == 4096 || stream.atEnd())
+            {
+                decoder.decode(batch);
+                batch.clear();
+            }
+        }
+    }
+    else
+    {
+        CANObjects::TimestampingCanSocket socket;
+
+        if (!socket.open(config.canDeviceName, {config.filter}))
+        {
+            qWarning() << "could not open" << config.canDeviceName << socket.errorString();
+            return 1;
+        }
+
+        QVector<QCanBusFrame> batch;
+
+        QObject::connect(&socket, &CANObjects::TimestampingCanSocket::framesReceived, [&]() {
+            batch.clear();
+
+            while (socket.framesAvailable())
+            {
+                batch.push_back(socket.readFrame());
+            }
+
+            decoder.decode(batch);
+        });
+
+        QTimer::singleShot(parser.value(durationOption).toInt() * 1000, &app, &QCoreApplication::quit);
+        app.exec();
+    }
+
+    const quint64 rows = exporter.rows();
+    const int chunks = exporter.finish() ? exporter.chunks().size() : -1;
+
+    if (chunks < 0)
+    {
+        qWarning() << "could not write output";
+        return 1;
+    }
+
+    qInfo() << "exported" << rows << "values in" << chunks << "chunks";
+
+    return 0;
+}
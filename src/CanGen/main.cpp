@@ -0,0 +1,162 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "trafficgenerator.hpp"
+#include "valuegenerator.hpp"
+
+#include <canconfigloader.hpp>
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDebug>
+#include <QFile>
+#include <QHash>
+#include <QTextStream>
+
+namespace {
+
+//first row holds signal names, every next row one value per signal
+QHash<QString, QVector<double>> readReplay(const QString &path)
+{
+    QHash<QString, QVector<double>> columns;
+
+    QFile file(path);
+
+    if (!file.open(QIODevice::ReadOnly | QIODevice::Text))
+    {
+        qWarning() << "could not open replay file" << path;
+        return columns;
+    }
+
+    QTextStream stream(&file);
+    const QStringList names = stream.readLine().split(',');
+
+    while (!stream.atEnd())
+    {
+        const QStringList values = stream.readLine().split(',');
+
+        for (int i = 0; i < names.size() && i < values.size(); ++i)
+        {
+            columns[names[i].trimmed()].push_back(values[i].toDouble());
+        }
+    }
+
+    return columns;
+}
+
+}
+
+int main(int argc, char *argv[])
+{
+    using CANObjects::ValueGenerator;
+    using CANObjects::TrafficGenerator;
+
+    QCoreApplication app(argc, argv);
+    QCoreApplication::setApplicationName("CanGen");
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription("Synthetic CAN traffic generator");
+    parser.addHelpOption();
+    parser.addPositionalArgument("config", "CanObjects JSON config");
+
+    const QCommandLineOption deviceOption({"d", "device"}, "Overrides device name of the config.", "name");
+    const QCommandLineOption modeOption({"m", "mode"}, "Default generator: ramp, sine, random or replay.", "mode", "ramp");
+    const QCommandLineOption signalOption({"s", "signal"}, "Generator of one signal, repeatable.", "name=mode");
+    const QCommandLineOption rateOption({"r", "rate"}, "Target frames per second.", "fps", "1000");
+    const QCommandLineOption loadOption({"l", "load"}, "Target bus load in percent, overrides rate.", "percent");
+    const QCommandLineOption bitrateOption({"b", "bitrate"}, "Bus bitrate for the load target.", "bps", "500000");
+    const QCommandLineOption durationOption({"t", "duration"}, "Stop after seconds.", "sec", "0");
+    const QCommandLineOption periodOption({"p", "period"}, "Period of ramp and sine.", "sec", "10");
+    const QCommandLineOption replayOption("replay", "CSV with a column of values per signal.", "file");
+    const QCommandLineOption latencyOption("latency", "Sequence counter signal, measures TX to RX latency over loopback.", "name");
+
+    parser.addOptions({deviceOption, modeOption, signalOption, rateOption, loadOption,
+                       bitrateOption, durationOption, periodOption, replayOption, latencyOption});
+    parser.process(app);
+
+    if (parser.positionalArguments().size() != 1)
+    {
+        parser.showHelp(1);
+    }
+
+    CANObjects::Config config = CANObjects::ConfigLoader::loadConfig(parser.positionalArguments().first());
+
+    if (parser.isSet(deviceOption))
+    {
+        config.canDeviceName = parser.value(deviceOption);
+    }
+
+    ValueGenerator::Mode defaultMode;
+
+    if (!ValueGenerator::modeFromString(parser.value(modeOption), defaultMode))
+    {
+        qWarning() << "unknown mode" << parser.value(modeOption);
+        return 1;
+    }
+
+    QHash<QString, ValueGenerator::Mode> signalModes;
+
+    for (const QString &value : parser.values(signalOption))
+    {
+        const QStringList parts = value.split('=');
+        ValueGenerator::Mode mode;
+
+        if (parts.size() != 2 || !ValueGenerator::modeFromString(parts[1], mode))
+        {
+            qWarning() << "invalid signal generator" << value;
+            return 1;
+        }
+
+        signalModes.insert(parts[0], mode);
+    }
+
+    const QHash<QString, QVector<double>> replay = parser.isSet(replayOption) ?
+                readReplay(parser.value(replayOption)) : QHash<QString, QVector<double>>();
+
+    const double periodSec = parser.value(periodOption).toDouble();
+
+    QVector<ValueGenerator> generators;
+
+    for (const CANObjects::CanObject &obj : config.canObjects)
+    {
+        ValueGenerator generator(obj, signalModes.value(obj.getName(), defaultMode), periodSec);
+        generator.setReplayValues(replay.value(obj.getName()));
+        generators.push_back(generator);
+    }
+
+    TrafficGenerator::Options options;
+    options.framesPerSec = parser.value(rateOption).toDouble();
+    options.busLoadPercent = parser.value(loadOption).toDouble();
+    options.bitrate = parser.value(bitrateOption).toInt();
+    options.durationSec = parser.value(durationOption).toInt();
+    options.latencySignal = parser.value(latencyOption);
+
+    TrafficGenerator trafficGenerator(config, generators, options);
+    QObject::connect(&trafficGenerator, &TrafficGenerator::finished, &app, &QCoreApplication::quit);
+
+    if (!trafficGenerator.start())
+    {
+        return 1;
+    }
+
+    return app.exec();
+}
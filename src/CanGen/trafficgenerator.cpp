@@ -0,0 +1,290 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "trafficgenerator.hpp"
+
+#include <busloadestimator.hpp>
+#include <framedispatcher.hpp>
+
+#include <QCanBus>
+#include <QDebug>
+
+#include <algorithm>
+
+
+CANObjects::TrafficGenerator::TrafficGenerator(const Config &config, const QVector<ValueGenerator> &generators,
+                                               const Options &options, QObject *parent) :
+    QObject(parent)
+  , m_config(config)
+  , m_options(options)
+  , m_generators(generators)
+  , m_composer(config.canObjects)
+  , m_frameIDs(FrameDispatcher(config.canObjects).frameIDs())
+  , m_protection(config.e2eProfiles)
+  , m_decoder(config.canObjects)
+{
+    std::sort(m_frameIDs.begin(), m_frameIDs.end());
+
+    m_decoder.setProtection(&m_protection);
+
+    m_tickTimer.setTimerType(Qt::PreciseTimer);
+    m_tickTimer.setInterval(1);
+
+    m_reportTimer.setInterval(1000);
+
+    connect(&m_tickTimer, &QTimer::timeout, this, &TrafficGenerator::onTick);
+    connect(&m_reportTimer, &QTimer::timeout, this, &TrafficGenerator::onReport);
+}
+
+CANObjects::TrafficGenerator::~TrafficGenerator()
+{
+    if (m_device)
+    {
+        m_device->disconnectDevice();
+        delete m_device;
+    }
+}
+
+bool CANObjects::TrafficGenerator::start()
+{
+    if (m_frameIDs.isEmpty())
+    {
+        qWarning() << "config has no frames to send";
+        return false;
+    }
+
+    if (!m_options.latencySignal.isEmpty() && !setupProbe())
+    {
+        return false;
+    }
+
+    QString errorString;
+    m_device = QCanBus::instance()->createDevice(m_config.canDevicePlugin, m_config.canDeviceName, &errorString);
+
+    if (!m_device)
+    {
+        qWarning() << "could not create device:" << errorString;
+        return false;
+    }
+
+    connect(m_device, &QCanBusDevice::errorOccurred, this, &TrafficGenerator::onErrorOccurred);
+
+    //generator only sends, unless own frames come back for the latency probe
+    m_device->setConfigurationParameter(QCanBusDevice::ReceiveOwnKey, m_probe != nullptr);
+
+    if (m_probe)
+    {
+        m_device->setConfigurationParameter(QCanBusDevice::LoopbackKey, true);
+        connect(m_device, &QCanBusDevice::framesReceived, this, &TrafficGenerator::onFramesReceived);
+    }
+
+    if (!m_device->connectDevice())
+    {
+        qWarning() << "could not connect to device:" << m_config.canDeviceName;
+        return false;
+    }
+
+    m_framesPerSec = m_options.framesPerSec;
+
+    if (m_options.busLoadPercent > 0.0)
+    {
+        m_framesPerSec = m_options.busLoadPercent / 100.0 * m_options.bitrate / averageFrameBits();
+    }
+
+    qInfo() << "sending" << m_frameIDs.size() << "frame IDs at" << m_framesPerSec << "frames/s on" << m_config.canDeviceName;
+
+    m_clock.start();
+    m_tickTimer.start();
+    m_reportTimer.start();
+
+    return true;
+}
+
+void CANObjects::TrafficGenerator::onTick()
+{
+    const qint64 elapsedMs = m_clock.elapsed();
+
+    if (m_options.durationSec > 0 && elapsedMs >= m_options.durationSec * 1000)
+    {
+        m_tickTimer.stop();
+        onReport();
+        m_reportTimer.stop();
+        emit finished();
+        return;
+    }
+
+    //frames due since start, a late tick catches up by at most 10ms of traffic
+    const double dueTotal = m_framesPerSec * elapsedMs / 1000.0;
+    qint64 due = static_cast<qint64>(dueTotal) - static_cast<qint64>(m_sent + m_failed);
+    due = std::min<qint64>(due, std::max<qint64>(1, static_cast<qint64>(m_framesPerSec / 100.0)));
+
+    for (qint64 i = 0; i < due; ++i)
+    {
+        if (m_nextFrame == 0)
+        {
+            refreshValues(elapsedMs / 1000.0);
+        }
+
+        const quint32 frameID = m_frameIDs[m_nextFrame];
+        const bool tagged = m_probe && frameID == m_probeFrameID;
+        const quint64 sequence = tagged ? m_probe->nextSequence() : 0;
+
+        if (tagged)
+        {
+            m_composer.writeRaw(m_probe->signal(), sequence);
+        }
+
+        QCanBusFrame frame = m_composer.frame(frameID);
+        m_protection.protect(frame);
+        const qint64 txUs = LatencyProbe::nowUs();
+
+        if (!m_device->writeFrame(frame))
+        {
+            //socket buffer full, retry in the next tick
+            ++m_failed;
+            break;
+        }
+
+        if (tagged)
+        {
+            m_probe->onSent(sequence, txUs);
+        }
+
+        ++m_sent;
+        m_nextFrame = (m_nextFrame + 1) % m_frameIDs.size();
+    }
+}
+
+void CANObjects::TrafficGenerator::onFramesReceived()
+{
+    while (m_device->framesAvailable())
+    {
+        m_decoder.decode(m_device->readFrame());
+    }
+}
+
+void CANObjects::TrafficGenerator::onReport()
+{
+    const qint64 nowMs = m_clock.elapsed();
+    const qint64 spanMs = std::max<qint64>(1, nowMs - m_reportAtMs);
+
+    const double achieved = (m_sent - m_sentAtReport) * 1000.0 / spanMs;
+
+    qInfo().noquote() << QString("%1 s: %2 frames/s (target %3), sent %4, backpressure %5, queued %6")
+                         .arg(nowMs / 1000.0, 0, 'f', 1)
+                         .arg(achieved, 0, 'f', 0)
+                         .arg(m_framesPerSec, 0, 'f', 0)
+                         .arg(m_sent)
+                         .arg(m_failed)
+                         .arg(m_device->framesToWrite());
+
+    m_sentAtReport = m_sent;
+    m_reportAtMs = nowMs;
+
+    if (m_probe)
+    {
+        reportLatency();
+    }
+}
+
+void CANObjects::TrafficGenerator::onErrorOccurred(QCanBusDevice::CanBusError error)
+{
+    //write errors are counted as backpressure
+    if (error != QCanBusDevice::CanBusError::WriteError)
+    {
+        qWarning() << "error occured" << error << m_device->errorString();
+    }
+}
+
+void CANObjects::TrafficGenerator::refreshValues(double t)
+{
+    for (int i = 0; i < m_generators.size(); ++i)
+    {
+        const QVariant value = m_generators[i].value(t);
+
+        if (value.isValid())
+        {
+            m_composer.writeValue(i, value);
+        }
+    }
+}
+
+double CANObjects::TrafficGenerator::averageFrameBits() const
+{
+    const BusLoadEstimator estimator(m_options.bitrate);
+    double bits = 0.0;
+
+    for (const quint32 frameID : m_frameIDs)
+    {
+        bits += estimator.frameBits(m_composer.frame(frameID), BusLoadEstimator::Stuffing::WorstCase);
+    }
+
+    return bits / m_frameIDs.size();
+}
+
+bool CANObjects::TrafficGenerator::setupProbe()
+{
+    const int signal = m_composer.indexOf(m_options.latencySignal);
+
+    if (signal < 0)
+    {
+        qWarning() << "unknown latency signal" << m_options.latencySignal;
+        return false;
+    }
+
+    const CanObject &obj = m_config.canObjects[signal];
+    m_probeFrameID = obj.getRanges().first().frameID;
+
+    for (const FrameRange &range : obj.getRanges())
+    {
+        if (range.frameID != m_probeFrameID)
+        {
+            qWarning() << "latency signal must be in one frame" << m_options.latencySignal;
+            return false;
+        }
+    }
+
+    m_probe.reset(new LatencyProbe(signal, obj.getSize()));
+    m_decoder.addSink(m_probe.get());
+
+    return true;
+}
+
+void CANObjects::TrafficGenerator::reportLatency()
+{
+    const auto line = [](const char *name, const LatencyHistogram &histogram) {
+        return QString("  %1: p50 %2 us, p99 %3 us, p99.9 %4 us, max %5 us")
+                .arg(name)
+                .arg(histogram.percentile(50.0))
+                .arg(histogram.percentile(99.0))
+                .arg(histogram.percentile(99.9))
+                .arg(histogram.max());
+    };
+
+    qInfo().noquote() << QString("latency over %1 frames, lost %2, unmatched %3")
+                         .arg(m_probe->txToDecode().count())
+                         .arg(m_probe->lost())
+                         .arg(m_probe->unmatched());
+    qInfo().noquote() << line("tx to kernel rx", m_probe->txToRx());
+    qInfo().noquote() << line("kernel rx to decode", m_probe->rxToDecode());
+    qInfo().noquote() << line("tx to decode", m_probe->txToDecode());
+}
@@ -0,0 +1,101 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include "valuegenerator.hpp"
+
+#include <canconfigloader.hpp>
+#include <framecomposer.hpp>
+#include <latencyprobe.hpp>
+#include <signaldecoder.hpp>
+
+#include <QCanBusDevice>
+#include <QElapsedTimer>
+#include <QObject>
+#include <QTimer>
+
+#include <memory>
+
+namespace CANObjects {
+
+class TrafficGenerator : public QObject
+{
+    Q_OBJECT
+
+public:
+    struct Options
+    {
+        double framesPerSec = 1000.0;
+        double busLoadPercent = 0.0;    //overrides framesPerSec when set
+        int bitrate = 500000;
+        int durationSec = 0;            //0 runs until interrupted
+        QString latencySignal;          //sequence counter signal, frames are received back to measure latency
+    };
+
+    TrafficGenerator(const Config &config, const QVector<ValueGenerator> &generators,
+                     const Options &options, QObject *parent = nullptr);
+    ~TrafficGenerator();
+
+    bool start();
+
+signals:
+    void finished();
+
+private slots:
+    void onTick();
+    void onFramesReceived();
+    void onReport();
+    void onErrorOccurred(QCanBusDevice::CanBusError error);
+
+private:
+    Config m_config;
+    Options m_options;
+    QVector<ValueGenerator> m_generators;
+
+    QCanBusDevice *m_device = nullptr;
+    FrameComposer m_composer;
+    QVector<quint32> m_frameIDs;
+    int m_nextFrame = 0;
+    double m_framesPerSec = 0.0;
+
+    E2EProtection m_protection;
+    SignalDecoder m_decoder;
+    std::unique_ptr<LatencyProbe> m_probe;
+    quint32 m_probeFrameID = 0;
+
+    QElapsedTimer m_clock;
+    QTimer m_tickTimer;
+    QTimer m_reportTimer;
+
+    quint64 m_sent = 0;
+    quint64 m_failed = 0;
+    quint64 m_sentAtReport = 0;
+    qint64 m_reportAtMs = 0;
+
+    void refreshValues(double t);
+    double averageFrameBits() const;
+    bool setupProbe();
+    void reportLatency();
+};
+
+}
@@ -0,0 +1,117 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#include "valuegenerator.hpp"
+
+#include <cmath>
+
+CANObjects::ValueGenerator::ValueGenerator(const CanObject &obj, Mode mode, double periodSec) :
+    m_type(obj.isScaled() ? QMetaType::Type::Double : obj.getType()) //physical value, encodeRaw rounds it
+  , m_mode(mode)
+  , m_min(obj.getMinVal().toDouble())
+  , m_max(obj.getMaxVal().toDouble())
+  , m_periodSec(periodSec > 0.0 ? periodSec : 1.0)
+  , m_random(static_cast<quint32>(qHash(obj.getName())))
+{
+
+}
+
+void CANObjects::ValueGenerator::setReplayValues(const QVector<double> &values)
+{
+    m_replay = values;
+    m_replayPos = 0;
+}
+
+QVariant CANObjects::ValueGenerator::value(double t)
+{
+    const double phase = std::fmod(t, m_periodSec) / m_periodSec;
+    double val = m_min;
+
+    switch (m_mode) {
+    case Mode::Ramp:
+        val = m_min + (m_max - m_min) * phase;
+        break;
+    case Mode::Sine:
+        val = m_min + (m_max - m_min) * (0.5 + 0.5 * std::sin(2.0 * M_PI * phase));
+        break;
+    case Mode::Random:
+        val = m_min + (m_max - m_min) * m_random.generateDouble();
+        break;
+    case Mode::Replay:
+        if (!m_replay.isEmpty())
+        {
+            val = m_replay[m_replayPos];
+            m_replayPos = (m_replayPos + 1) % m_replay.size();
+        }
+        break;
+    }
+
+    return typed(val);
+}
+
+bool CANObjects::ValueGenerator::modeFromString(const QString &name, Mode &mode)
+{
+    if (name == "ramp")
+    {
+        mode = Mode::Ramp;
+    }
+    else if (name == "sine")
+    {
+        mode = Mode::Sine;
+    }
+    else if (name == "random")
+    {
+        mode = Mode::Random;
+    }
+    else if (name == "replay")
+    {
+        mode = Mode::Replay;
+    }
+    else
+    {
+        return false;
+    }
+
+    return true;
+}
+
+QVariant CANObjects::ValueGenerator::typed(double value) const
+{
+    switch (m_type) {
+    case QMetaType::Type::Bool:
+        return QVariant(value >= 0.5);
+    case QMetaType::Type::Int:
+        return QVariant(static_cast<int>(std::nearbyint(value)));
+    case QMetaType::Type::UInt:
+        return QVariant(static_cast<uint>(std::nearbyint(value < 0.0 ? 0.0 : value)));
+    case QMetaType::Type::LongLong:
+        return QVariant(static_cast<qlonglong>(std::nearbyint(value)));
+    case QMetaType::Type::ULongLong:
+        return QVariant(static_cast<qulonglong>(std::nearbyint(value < 0.0 ? 0.0 : value)));
+    case QMetaType::Type::Float:
+        return QVariant(static_cast<float>(value));
+    case QMetaType::Type::Double:
+        return QVariant(value);
+    default:
+        return QVariant();
+    }
+}
@@ -0,0 +1,69 @@
+/*
+ *
+ * Copyright (C) 2019  Miroslav Krajicek (https://github.com/kaajo).
+ * All Rights Reserved.
+ *
+ * This file is part of CanObjects.
+ *
+ * CanObjects is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU LGPL version 3 as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * CanObjects is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU LGPL version 3
+ * along with CanObjects. If not, see <http://www.gnu.org/licenses/lgpl-3.0.txt>.
+ *
+ */
+
+#pragma once
+
+#include <canobject.hpp>
+
+#include <QRandomGenerator>
+#include <QString>
+#include <QVector>
+
+namespace CANObjects {
+
+class ValueGenerator
+{
+public:
+    enum class Mode
+    {
+        Ramp,
+        Sine,
+        Random,
+        Replay,
+    };
+
+    ValueGenerator(){}
+    ValueGenerator(const CanObject &obj, Mode mode, double periodSec);
+
+    void setReplayValues(const QVector<double> &values);
+
+    //value of the generator at time t, typed for CanObject::encodeRaw
+    QVariant value(double t);
+
+    static bool modeFromString(const QString &name, Mode &mode);
+
+private:
+    QMetaType::Type m_type = QMetaType::Type::UnknownType;
+    Mode m_mode = Mode::Ramp;
+    double m_min = 0.0;
+    double m_max = 0.0;
+    double m_periodSec = 1.0;
+
+    QVector<double> m_replay;
+    int m_replayPos = 0;
+
+    QRandomGenerator m_random;
+
+    QVariant typed(double value) const;
+};
+
+}
@@ -20,8 +20,12 @@ TEMPLATE = subdirs
 
 SUBDIRS += \
     CanSim \
+    CanGen \
+    CanExport \
     CanBase \
     CanBaseTests \
 
 CanSim.depends = CanBase
+CanGen.depends = CanBase
+CanExport.depends = CanBase
 CanBaseTests.depends = CanBase
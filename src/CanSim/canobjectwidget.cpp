@@ -25,12 +25,11 @@
 
 #include <QDebug>
 
-#include <cmath>
-
-CANObjects::CanObjectWidget::CanObjectWidget(CanObject &obj, QWidget *parent) :
+CANObjects::CanObjectWidget::CanObjectWidget(const CanObject &obj, int signalIndex, QWidget *parent) :
     QWidget(parent)
   , ui(new Ui::CanObjectWidget)
   , m_object(obj)
+  , m_signalIndex(signalIndex)
 {
     ui->setupUi(this);
 
@@ -64,42 +63,35 @@ CANObjects::CanObjectWidget::~CanObjectWidget()
     delete ui;
 }
 
-void CANObjects::CanObjectWidget::sendValue(QHash<quint32, QCanBusFrame> &outputFrames)
+const CANObjects::CanObject &CANObjects::CanObjectWidget::getObject() const
 {
-    if (!ui->useCheckbox->isChecked())
-    {
-        return;
-    }
+    return m_object;
+}
 
-    QVariant var;
+void CANObjects::CanObjectWidget::setSignalIndex(int signalIndex)
+{
+    m_signalIndex = signalIndex;
+}
 
-    bool ok = false;
-    QString text = ui->value->text();
+void CANObjects::CanObjectWidget::setStale(bool stale)
+{
+    ui->value->setEnabled(!stale);
+}
 
-    switch (m_object.getType())
+void CANObjects::CanObjectWidget::setValueModel(TxValueModel *model)
+{
+    m_valueModel = model;
+
+    if (m_valueModel)
     {
-    case QMetaType::Type::Float:
-        var = QVariant(ui->value->text().toFloat(&ok));
-        break;
-    case QMetaType::Type::Bool:
-        var = QVariant(ui->value->text().toInt(&ok) == 0 ? false : true);
-        break;
-    case QMetaType::Type::Int:
-        var = QVariant(static_cast<int>(std::nearbyint(ui->value->text().toFloat(&ok))));
-        break;
-    case QMetaType::Type::UInt:
-        var = QVariant(static_cast<uint>(std::nearbyint(ui->value->text().toFloat(&ok))));
-        break;
-    default:
-        break;
+        m_valueModel->setText(m_signalIndex, ui->value->text());
+        m_valueModel->setEnabled(m_signalIndex, ui->useCheckbox->isChecked());
     }
-
-    m_object.writeData(var,outputFrames);
 }
 
-void CANObjects::CanObjectWidget::receiveValue(const QHash<quint32, QCanBusFrame> &inputFrames)
+void CANObjects::CanObjectWidget::receiveValue(const FrameBatch &inputFrames)
 {
-    QVariant value = m_object.readData(inputFrames);
+    QVariant value = inputFrames.readData(m_object);
 
     if (value.isNull()) return;
 
@@ -111,6 +103,12 @@ void CANObjects::CanObjectWidget::receiveValue(const QHash<quint32, QCanBusFrame
         ui->valueSlider->setValue(range * (value.toFloat() - m_object.getMinVal().toFloat())/
                                   (m_object.getMaxVal().toFloat() - m_object.getMinVal().toFloat()));
         break;
+    case QMetaType::Type::LongLong:
+    case QMetaType::Type::ULongLong:
+        //64-bit spans do not fit the int slider, position is proportional
+        ui->valueSlider->setValue(static_cast<int>(range * (value.toDouble() - m_object.getMinVal().toDouble())/
+                                                   (m_object.getMaxVal().toDouble() - m_object.getMinVal().toDouble())));
+        break;
     case QMetaType::Type::Bool:
         ui->valueSlider->setValue(value.toBool() ? 1 : 0);
         break;
@@ -122,7 +120,16 @@ void CANObjects::CanObjectWidget::receiveValue(const QHash<quint32, QCanBusFrame
         break;
     }
 
-    ui->value->setText(value.toString());
+    //named raw values are shown by name, the model parses the name back
+    const QString name = m_object.valueName(m_object.encodeRaw(value));
+    ui->value->setText(name.isEmpty() ? value.toString() : name);
+    setStale(false);
+
+    //the shown value is the one sent, as typed value without parsing
+    if (m_valueModel)
+    {
+        m_valueModel->setValue(m_signalIndex, value);
+    }
 
 }
 
@@ -131,4 +138,18 @@ void CANObjects::CanObjectWidget::on_valueSlider_sliderMoved(int position)
     const double range = ui->valueSlider->maximum() - ui->valueSlider->minimum();
     const QString newValue = QVariant(m_object.getMinVal().toDouble() + (position/range) * (m_object.getMaxVal().toDouble() - m_object.getMinVal().toDouble())).toString();
     ui->value->setText(newValue);
+
+    //parsed and encoded once here, not on every send tick
+    if (m_valueModel)
+    {
+        m_valueModel->setText(m_signalIndex, newValue);
+    }
+}
+
+void CANObjects::CanObjectWidget::on_useCheckbox_toggled(bool checked)
+{
+    if (m_valueModel)
+    {
+        m_valueModel->setEnabled(m_signalIndex, checked);
+    }
 }
@@ -23,6 +23,8 @@
 #pragma once
 
 #include <canobject.hpp>
+#include <framebatch.hpp>
+#include <txvaluemodel.hpp>
 
 #include <QWidget>
 
@@ -37,20 +39,31 @@ class CanObjectWidget : public QWidget
     Q_OBJECT
 
 public:
-    explicit CanObjectWidget(CanObject &obj, QWidget *parent = nullptr);
+    explicit CanObjectWidget(const CanObject &obj, int signalIndex, QWidget *parent = nullptr);
     ~CanObjectWidget();
 
+    const CanObject &getObject() const;
+    void setSignalIndex(int signalIndex);
+
+    //frame of the signal timed out, the shown value is the last one received
+    void setStale(bool stale);
+
+    //edits go to the model, which is filled with the current state right away
+    void setValueModel(TxValueModel *model);
+
 public slots:
-    void sendValue(QHash<quint32, QCanBusFrame> &outputFrames);
-    void receiveValue(const QHash<quint32, QCanBusFrame> &inputFrames);
+    void receiveValue(const FrameBatch &inputFrames);
 
 private slots:
     void on_valueSlider_sliderMoved(int position);
+    void on_useCheckbox_toggled(bool checked);
 
 private:
     Ui::CanObjectWidget *ui;
 
-    CanObject &m_object;
+    CanObject m_object;
+    int m_signalIndex = 0;
+    TxValueModel *m_valueModel = nullptr;
 };
 
 }
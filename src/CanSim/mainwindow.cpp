@@ -26,11 +26,18 @@
 #include "canobjectwidget.hpp"
 
 #include <canconfigloader.hpp>
+#include <framedispatcher.hpp>
+#include <latencyprobe.hpp>
 
 #include <QDebug>
+#include <QDir>
 #include <QCanBus>
 #include <QFileDialog>
 #include <QSettings>
+#include <QStandardPaths>
+
+#include <algorithm>
+#include <limits>
 
 CANObjects::MainWindow::MainWindow(QWidget *parent) :
     QMainWindow(parent),
@@ -40,18 +47,19 @@ CANObjects::MainWindow::MainWindow(QWidget *parent) :
     ui->scrollAreaWidgetContents->setLayout(new QVBoxLayout);
 
     connect(&m_sendTimer, &QTimer::timeout, this, &MainWindow::onSendTimer);
+    connect(&m_supervisionTimer, &QTimer::timeout, this, &MainWindow::onSupervisionTimer);
+    connect(&m_socket, &TimestampingCanSocket::framesReceived, this, &MainWindow::onFramesReceived);
+
+    //created once, dumps are triggered from the receive path
+    m_dumpDirectory = QStandardPaths::writableLocation(QStandardPaths::AppLocalDataLocation);
+    QDir().mkpath(m_dumpDirectory);
 }
 
 CANObjects::MainWindow::~MainWindow()
 {
     delete ui;
 
-    if (m_device->state() == QCanBusDevice::CanBusDeviceState::ConnectedState)
-    {
-        m_device->disconnectDevice();
-    }
-
-    m_device->deleteLater();
+    closeCAN();
 }
 
 void CANObjects::MainWindow::onErrorOccurred(QCanBusDevice::CanBusError error)
@@ -61,29 +69,93 @@ void CANObjects::MainWindow::onErrorOccurred(QCanBusDevice::CanBusError error)
 
 void CANObjects::MainWindow::onFramesReceived()
 {
-    QHash<quint32,QCanBusFrame> receivedFrames;
+    //every frame is kept in arrival order, widgets take the latest of each ID
+    m_receivedFrames.clear();
+    qint64 newestUs = 0;
+    const qint64 readUs = FrameSupervisor::nowUs();
+
+    //frames carry their kernel receive time, not the time they are read here
+    while (framesAvailable()) {
+        const QCanBusFrame frame = readFrame();
+        newestUs = std::max(newestUs, FrameSnapshotTable::timestampUs(frame));
+
+        m_busLoad.addFrame(frame);
+        m_flightRecorder.record(frame);
+
+        //corrupted or stale protected frames are not used
+        if (E2EProtection::isCorrupted(m_protection.check(frame.frameId(), payloadToWord(frame.payload()))))
+        {
+            dumpFlightRecorder(FrameSnapshotTable::timestampUs(frame), QStringLiteral("e2e-%1").arg(frame.frameId()));
+            continue;
+        }
+
+        m_latestFrames.write(frame);
+        m_supervisor.onFrame(frame.frameId(), readUs);
+
+        if (m_sharedSignals)
+        {
+            m_sharedSignals->publish(frame);
+        }
+
+        m_receivedFrames.append(frame);
+    }
+
+    for (CanObjectWidget *widget : m_canWidgets)
+    {
+        widget->receiveValue(m_receivedFrames);
+    }
 
-    while (m_device->framesAvailable()) {
-        const QCanBusFrame frame = m_device->readFrame();
+    QString status = tr("bus load: %1 %").arg(m_busLoad.load() * 100.0, 0, 'f', 1);
 
-        receivedFrames[frame.frameId()] = frame;
+    if (m_predictedTxLoad >= 0.0)
+    {
+        status += tr(", predicted TX load: %1 %").arg(m_predictedTxLoad * 100.0, 0, 'f', 1);
     }
 
-    for (CanObjectWidget *widget : m_canWidgets)
+    //hardware stamps run on the controller clock
+    if (m_socket.isOpen() && m_socket.timestampSource() == TimestampingCanSocket::Source::Software && newestUs > 0)
     {
-        widget->receiveValue(receivedFrames);
+        const qint64 delayUs = LatencyProbe::nowUs() - newestUs;
+        m_readDelay.record(delayUs);
+        status += tr(", read %1 us after arrival, p99 %2 us").arg(delayUs).arg(m_readDelay.percentile(99.0));
     }
 
+    ui->statusBar->showMessage(status);
+
     /*
     for (const CanObject &obj : m_canObjects)
     {
-        QVariant var = obj.readData(receivedFrames);
+        QVariant var = m_receivedFrames.readData(obj);
 
         if (var.isValid()) qDebug() << var;
     }
     */
 }
 
+void CANObjects::MainWindow::onSupervisionTimer()
+{
+    m_timedOutFrames.clear();
+    m_supervisor.advance(FrameSupervisor::nowUs(), m_timedOutFrames);
+
+    for (const quint32 frameID : m_timedOutFrames)
+    {
+        qDebug() << "frame" << frameID << "timed out";
+        dumpFlightRecorder(LatencyProbe::nowUs(), QStringLiteral("timeout-%1").arg(frameID));
+
+        for (CanObjectWidget *widget : m_canWidgets)
+        {
+            for (const FrameRange &range : widget->getObject().getRanges())
+            {
+                if (range.frameID == frameID)
+                {
+                    widget->setStale(true);
+                    break;
+                }
+            }
+        }
+    }
+}
+
 void CANObjects::MainWindow::onFramesWritten(qint64 framesCount)
 {
     qDebug() << "frames written:" << framesCount;
@@ -96,18 +168,17 @@ void CANObjects::MainWindow::onStateChanged(QCanBusDevice::CanBusDeviceState sta
 
 void CANObjects::MainWindow::onSendTimer()
 {
-    qDebug() << "send frames";
+    //values are encoded when edited, only changed raw bits are merged here
+    m_txValues.applyChanges(m_composer);
 
-    QHash<quint32, QCanBusFrame> outputFrames;
-
-    for (int i = 0; i < m_canWidgets.size(); ++i)
-    {
-        m_canWidgets[i]->sendValue(outputFrames);
-    }
+    //ticks instead of wall clock, timer jitter must not skip a period
+    ++m_sendTicks;
+    m_outputFrames.clear();
+    m_composer.compose(m_sendTicks * m_sendTimer.interval(), m_outputFrames);
 
-    for (const QCanBusFrame &frame : outputFrames)
+    for (const QCanBusFrame &frame : m_outputFrames)
     {
-        m_device->writeFrame(frame);
+        writeFrame(frame);
     }
 }
 
@@ -140,6 +211,19 @@ bool CANObjects::MainWindow::setupCAN(const QString &deviceName, const QString &
 
     qDebug() << "connecting to: " << deviceName;
 
+    //own socket for kernel receive timestamps
+    if (plugin == QStringLiteral("socketcan"))
+    {
+        if (!m_socket.open(deviceName, {filter}))
+        {
+            qDebug() << "could not open socket:" << m_socket.errorString();
+            return false;
+        }
+
+        m_readDelay.reset();
+        return true;
+    }
+
     m_device = QCanBus::instance()->createDevice(plugin, deviceName, &errorString);
 
     if (!m_device)
@@ -166,19 +250,96 @@ bool CANObjects::MainWindow::setupCAN(const QString &deviceName, const QString &
     return true;
 }
 
+void CANObjects::MainWindow::closeCAN()
+{
+    m_socket.close();
+
+    if (!m_device)
+    {
+        return;
+    }
+
+    if (m_device->state() == QCanBusDevice::CanBusDeviceState::ConnectedState)
+    {
+        m_device->disconnectDevice();
+    }
+
+    m_device->deleteLater();
+    m_device = nullptr;
+}
+
+bool CANObjects::MainWindow::isCANOpen() const
+{
+    return m_socket.isOpen() || m_device;
+}
+
+qint64 CANObjects::MainWindow::framesAvailable() const
+{
+    return m_socket.isOpen() ? m_socket.framesAvailable() : m_device->framesAvailable();
+}
+
+QCanBusFrame CANObjects::MainWindow::readFrame()
+{
+    return m_socket.isOpen() ? m_socket.readFrame() : m_device->readFrame();
+}
+
+bool CANObjects::MainWindow::writeFrame(const QCanBusFrame &frame)
+{
+    if (m_socket.isOpen())
+    {
+        return m_socket.writeFrame(frame);
+    }
+
+    return m_device && m_device->writeFrame(frame);
+}
+
+void CANObjects::MainWindow::dumpFlightRecorder(qint64 timestampUs, const QString &reason)
+{
+    //10 s before and 2 s after the fault, one dump per window
+    constexpr qint64 PreUs = 10000000;
+    constexpr qint64 PostUs = 2000000;
+
+    if (timestampUs - m_lastDumpUs < PostUs)
+    {
+        return;
+    }
+
+    m_lastDumpUs = timestampUs;
+
+    const QString path = QStringLiteral("%1/flight-%2-%3.canflt").arg(m_dumpDirectory).arg(timestampUs).arg(reason);
+    m_flightRecorder.trigger(timestampUs, PreUs, PostUs, path);
+    qDebug() << "flight recorder dump" << path;
+}
+
 void CANObjects::MainWindow::on_startStopButton_clicked(bool checked)
 {
     if (checked)
     {
         ui->startStopButton->setText("Stop");
         ui->frequencySpinBox->setDisabled(true);
-        m_sendTimer.start(1000 / ui->frequencySpinBox->value());
+        m_sendTimer.setInterval(1000 / ui->frequencySpinBox->value());
+        m_composer = FrameComposer(m_canObjects, m_sendTimer.interval());
+        m_composer.setProtection(&m_protection);
+        m_txValues.applyAll(m_composer);
+        m_sendTicks = 0;
+        m_sendTimer.start();
+
+        QVector<QCanBusFrame> frames;
+
+        for (const quint32 frameID : FrameDispatcher(m_canObjects).frameIDs())
+        {
+            frames.push_back(m_composer.frame(frameID));
+        }
+
+        m_predictedTxLoad = m_busLoad.predictedLoad(frames, QVector<double>(frames.size(), ui->frequencySpinBox->value()));
+        ui->statusBar->showMessage(tr("predicted TX load: %1 %").arg(m_predictedTxLoad * 100.0, 0, 'f', 1));
     }
     else
     {
         ui->startStopButton->setText("Start");
         ui->frequencySpinBox->setDisabled(false);
         m_sendTimer.stop();
+        m_predictedTxLoad = -1.0;
     }
 }
 
@@ -200,15 +361,124 @@ void CANObjects::MainWindow::on_actionOpen_triggered()
 void CANObjects::MainWindow::readCANConfig(const QString& path)
 {
     const Config cfg = ConfigLoader::loadConfig(path);
+    const ConfigDiff diff = m_registry.reload(cfg);
+
+    m_canObjects = m_registry.current()->objects;
+    //alive counters keep running across reloads, receivers would drop repeated ones
+    if (diff.e2eChanged)
+    {
+        m_protection = E2EProtection(cfg.e2eProfiles);
+    }
 
-    m_canObjects = cfg.canObjects;
+    m_composer = FrameComposer(m_canObjects, m_sendTimer.interval());
+    m_composer.setProtection(&m_protection);
+    m_receivedFrames.setIndex(FrameIndex(FrameDispatcher(m_canObjects).frameIDs()));
 
-    for (CanObject &canObj : m_canObjects)
+    //supervision ticks at a tenth of the shortest timeout
+    if (diff.cyclesChanged)
     {
-        CanObjectWidget *canWidget = new CanObjectWidget(canObj);
-        ui->scrollAreaWidgetContents->layout()->addWidget(canWidget);
-        m_canWidgets.push_back(canWidget);
+        m_supervisor = FrameSupervisor(cfg.frameCycles);
+        m_supervisor.arm(FrameSupervisor::nowUs());
+        m_supervisionTimer.stop();
+
+        int shortestMs = std::numeric_limits<int>::max();
+
+        for (const FrameCycle &cycle : cfg.frameCycles)
+        {
+            shortestMs = std::min(shortestMs, cycle.timeoutMs);
+        }
+
+        if (!cfg.frameCycles.isEmpty())
+        {
+            m_supervisionTimer.start(std::max(shortestMs / 10, 1));
+        }
+    }
+
+    if (!m_sharedSignals || !diff.addedSignals.isEmpty() || !diff.removedSignals.isEmpty() || !diff.changedSignals.isEmpty())
+    {
+        m_sharedSignals.reset(new SharedSignalWriter(m_canObjects));
+        m_sharedSignals->open(QStringLiteral("/CanSim"));
+    }
+
+    m_txValues = TxValueModel(m_canObjects);
+    updateWidgets(diff);
+    m_txValues.applyAll(m_composer);
+
+    //gateway forwards on its own sockets and thread, its copies depend on the signals of every bus
+    if (diff.gatewayChanged || diff.busesChanged || (!m_gateway && !cfg.gateway.isEmpty()))
+    {
+        m_gateway.reset();
+
+        if (!cfg.gateway.isEmpty())
+        {
+            m_gateway.reset(new CanGateway(cfg.gateway, cfg.buses));
+
+            if (!m_gateway->start())
+            {
+                qDebug() << "could not start gateway:" << m_gateway->errorString();
+            }
+        }
+    }
+
+    //same device keeps running, only the filter is replaced
+    if (!isCANOpen() || diff.deviceChanged)
+    {
+        closeCAN();
+        setupCAN(cfg.canDeviceName,cfg.canDevicePlugin,cfg.filter);
+    }
+    else if (diff.filterChanged)
+    {
+        QList<QCanBusDevice::Filter> filterList = {cfg.filter};
+
+        if (m_socket.isOpen())
+        {
+            m_socket.setFilters(filterList);
+        }
+        else
+        {
+            m_device->setConfigurationParameter(QCanBusDevice::RawFilterKey, QVariant::fromValue(filterList));
+        }
+    }
+}
+
+void CANObjects::MainWindow::updateWidgets(const ConfigDiff &diff)
+{
+    QLayout *layout = ui->scrollAreaWidgetContents->layout();
+    QHash<QString, CanObjectWidget*> widgets;
+
+    for (CanObjectWidget *widget : m_canWidgets)
+    {
+        layout->removeWidget(widget);
+
+        const QString name = widget->getObject().getName();
+
+        if (diff.removedSignals.contains(name) || diff.changedSignals.contains(name))
+        {
+            widget->deleteLater();
+        }
+        else
+        {
+            widgets.insert(name, widget);
+        }
     }
 
-    setupCAN(cfg.canDeviceName,cfg.canDevicePlugin,cfg.filter);
+    m_canWidgets.clear();
+
+    for (int i = 0; i < m_canObjects.size(); ++i)
+    {
+        CanObjectWidget *canWidget = widgets.value(m_canObjects[i].getName(), nullptr);
+
+        if (canWidget)
+        {
+            canWidget->setSignalIndex(i);
+        }
+        else
+        {
+            canWidget = new CanObjectWidget(m_canObjects[i], i);
+        }
+
+        canWidget->setValueModel(&m_txValues);
+        layout->addWidget(canWidget);
+        m_canWidgets.push_back(canWidget);
+    }
 }
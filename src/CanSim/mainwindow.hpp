@@ -24,12 +24,26 @@
 
 #include "canobjectwidget.hpp"
 
+#include <busloadestimator.hpp>
+#include <cangateway.hpp>
 #include <canobject.hpp>
+#include <framebatch.hpp>
+#include <framecomposer.hpp>
+#include <framesnapshottable.hpp>
+#include <framesupervisor.hpp>
+#include <flightrecorder.hpp>
+#include <latencyhistogram.hpp>
+#include <sharedsignalwriter.hpp>
+#include <signalregistry.hpp>
+#include <timestampingcansocket.hpp>
+#include <txvaluemodel.hpp>
 
 #include <QMainWindow>
 #include <QCanBusDevice>
 #include <QTimer>
 
+#include <memory>
+
 namespace Ui {
 class MainWindow;
 }
@@ -51,6 +65,7 @@ private slots:
     void onStateChanged(QCanBusDevice::CanBusDeviceState state);
 
     void onSendTimer();
+    void onSupervisionTimer();
 
     void on_startStopButton_clicked(bool checked);
 
@@ -59,12 +74,42 @@ private slots:
 private:
     Ui::MainWindow *ui;
     void readCANConfig(const QString &path);
+    void updateWidgets(const ConfigDiff &diff);
 
     bool setupCAN(const QString &deviceName, const QString &plugin, QCanBusDevice::Filter filter);
+    void closeCAN();
+    bool isCANOpen() const;
+    qint64 framesAvailable() const;
+    QCanBusFrame readFrame();
+    bool writeFrame(const QCanBusFrame &frame);
+    void dumpFlightRecorder(qint64 timestampUs, const QString &reason);
     QCanBusDevice *m_device = nullptr;
+    TimestampingCanSocket m_socket;
+    SignalRegistry m_registry;
     QVector<CanObject> m_canObjects;
     QVector<CanObjectWidget*> m_canWidgets;
 
+    FrameSnapshotTable m_latestFrames;
+    FrameBatch m_receivedFrames;
+    FrameSupervisor m_supervisor;
+    QVector<quint32> m_timedOutFrames;
+    QTimer m_supervisionTimer;
+
+    FlightRecorder m_flightRecorder;
+    QString m_dumpDirectory;
+    qint64 m_lastDumpUs = 0;
+    BusLoadEstimator m_busLoad;
+    double m_predictedTxLoad = -1.0;   //of the running send schedule, negative while stopped
+    LatencyHistogram m_readDelay;   //kernel receive to read of the newest frame of a batch
+    std::unique_ptr<SharedSignalWriter> m_sharedSignals;
+    std::unique_ptr<CanGateway> m_gateway;
+
+    E2EProtection m_protection;
+    FrameComposer m_composer;
+    TxValueModel m_txValues;
+    QVector<QCanBusFrame> m_outputFrames;
+    qint64 m_sendTicks = 0;
+
     QTimer m_sendTimer;
 };
 